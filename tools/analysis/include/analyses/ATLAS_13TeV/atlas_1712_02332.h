@@ -30,7 +30,12 @@ class Atlas_1712_02332 : public AnalysisBase {
     double dPhi(std::vector<Jet*> jets, int j);
     double M_eff(std::vector<Jet*> jets, int j);
     double HT(std::vector<Jet*> jets);
-    bool Passes_Cuts(std::vector<Jet*> jets, double PT1Cut, double PT2Cut, int NJet, double EtaCut, double dPhiCut1, double dPhiCut2, double METHTCut, double AplanarityCut, double METMeffCut, double MeffCut, bool cutflow, std::string sr); 
+    void addRegion(std::string sr, double PT1Cut, double PT2Cut, int NJet, double EtaCut, double dPhiCut1, double dPhiCut2, double METHTCut, double AplanarityCut, double METMeffCut, double MeffCut, bool boosted);
+
+    static const int maxJets = 6;
+    SignalRegionGrid regionGrid;
+    int varBoosted, varNJets, varDPhi1, varDPhi2, varPT1, varAplanarity, varMETHT, varMeff;
+    int varPTN[maxJets+1], varEtaN[maxJets+1], varMETMeffN[maxJets+1]; // for 2 to maxJets jets
 };
 
 #endif
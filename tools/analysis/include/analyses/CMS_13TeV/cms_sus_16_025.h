@@ -14,9 +14,8 @@ class Cms_sus_16_025 : public AnalysisBase {
     void finalize();
 
   private:
-    ofstream fout1;
-    TH1F *h1, *h2, *h3, *h4, *h5;
-    TFile *f1;
+    int logFile;
+    int h1, h2, h3, h4, h5;
     int i1, i2, i3, i4;
 
 };
@@ -21,12 +21,6 @@ class Cms_1303_2985 : public AnalysisBase {
     static std::string nj[2];
     static std::string nbj[5];
     static std::string binHT[8];
-    
-    struct fabs_less { 
-      bool operator()(const double x, const double y) const { 
-        return fabs(x) < fabs(y); 
-      } 
-    };
 };
 
 
@@ -51,12 +45,6 @@ class Cms_1303_2985_CR : public AnalysisBase {
     static std::string nbj [5];
     static std::string binHT [8];
     static std::string binCr [3];
-    
-    struct fabs_less { 
-      bool operator()(const double x, const double y) const { 
-        return fabs(x) < fabs(y); 
-      } 
-    };
 };
 
 #endif
@@ -5,6 +5,8 @@
 #include <fstream>
 #include <stdio.h>
 #include <map>
+#include <set>
+#include <algorithm>
 #include <math.h>
 #include <typeinfo>
 
@@ -29,6 +31,12 @@
 
 #include "ETMiss.h"
 #include "FinalStateObject.h"
+#include "Histogram.h"
+#include "JetReclustering.h"
+#include "NtupleWriter.h"
+#include "ParticleOwnership.h"
+#include "Selection.h"
+#include "SignalRegionGrid.h"
 #include "Units.h"
 
 #include "mt2_bisect.h"
@@ -36,6 +44,9 @@
 #include "mt2bl_bisect.h"
 #include "mt2w_bisect.h"
 #include "Wrappertopness.h"
+#include "topness_minimiser.h"
+#include "hemisphere_partition.h"
+#include "event_shapes.h"
 
 #include "Global.h"
 
@@ -87,6 +98,40 @@ class AnalysisBase {
     void setup(std::map<std::string, std::vector<int> > whichTagsIn, std::map<std::string, std::string> eventParameters);
     void processEvent(int iEvent);
     void finish();
+    //! Opens a group of correlated passes over the same generated event
+    /** All processEvent() calls until the matching finishEventGroup() count
+     *  as one event in nEvents, and the squared weight sums use the squared
+     *  sum of the weights of the group instead of the sum of squares.
+     *  Groups may be nested, only the outermost one is counted.
+     */
+    void startEventGroup();
+    //! Counts an event that failed the truth or reconstruction level bounds
+    /** The event enters nEvents, the sums of weights and the cutflow entry of
+     *  declareAllEventsCutflow() as usual, but analyze() is not called.
+     *  \sa declareTruthBounds(), declareRecoBounds()
+     */
+    void countVetoedEvent();
+    //! Closes a group opened by startEventGroup()
+    void finishEventGroup();
+    //! Prepares the analysis for the next job of a parameter scan
+    /** All counters and sums of weights are set to zero, keeping the booked regions,
+     *  and the files booked in initialize() are opened again with the new prefix.
+     *  Further state of derived analyses is not reset, so analyses have to keep
+     *  all results in booked regions and files to be used in scans.
+     *  \param prefix output prefix of the next job
+     */
+    void reset(std::string prefix);
+    //! Statistical status of the most sensitive signal region so far
+    /** Used by fritz to stop the event generation early. The most sensitive region is
+     *  the one with the largest expected r if S95 values are known, otherwise the one
+     *  with the largest sum of weights. A region without any events is assigned the
+     *  error of one average event.
+     *  \param r set to signal/S95_obs of the region, -1 if no S95 values are known
+     *  \param rError set to the statistical error of r
+     *  \return relative statistical error of the sum of weights of the region,
+     *   -1 if the region is still empty
+     */
+    double sensitiveRegionPrecision(double& r, double& rError);
 //TODO Texts
 
  protected:
@@ -150,6 +195,17 @@ class AnalysisBase {
      *   - The output does not contain copies but identically the same objects that went in.
      *  @{
      */
+    //! Starts a lazy selection of the given objects
+    /** Cuts are chained and applied in a single pass once the objects are needed, e.g.
+     *  select(jets).pt(20).eta(-2.8, 2.8).notNear(electrons, 0.2).sortedByPT().
+     *  filterPhaseSpace and overlapRemoval are shortcuts for one step of a selection.
+     *  \sa Selection
+     */
+    template <class T>
+    Selection<T> select(const std::vector<T*>& objects) {
+      return Selection<T>(objects);
+    }
+
     //! Require objects to have a certain ptmin and lie within a certain eta range
     /** A given set of objects (electrons, jets, ...) is filtered w.r.t minimum pt and a given eta range.
       * the overlap region 1.37 <= |eta| <= 1.52 is common for many objects and hence it has a seperate parameter to be checked.
@@ -164,30 +220,17 @@ class AnalysisBase {
       * \return A vector containing the objects that passed the filter.
       */ 
     template <class T>
-    std::vector<T*> filterPhaseSpace(std::vector<T*> unfiltered, double pTmin = 0., double etamin = -100, double etamax = 100, bool exclude_overlap = false, bool exclude_higher_pTs = false, double eta1=1.37, double eta2=1.52) {
+    std::vector<T*> filterPhaseSpace(const std::vector<T*>& unfiltered, double pTmin = 0., double etamin = -100, double etamax = 100, bool exclude_overlap = false, bool exclude_higher_pTs = false, double eta1=1.37, double eta2=1.52) {
+    Selection<T> selection(unfiltered);
+    if(!exclude_higher_pTs)
+      selection.pt(pTmin);
+    else
+      selection.ptBelow(pTmin);
+    selection.eta(etamin, etamax);
+    if(exclude_overlap)
+      selection.excludeEta(eta1, eta2);
     std::vector<T*> filtered;
-    if(!exclude_higher_pTs){
-      for (int i = 0; i < unfiltered.size(); i++) {
-          T* cand = unfiltered[i];
-          if((cand->PT > pTmin) && (cand->Eta > etamin) && (cand->Eta < etamax)) {
-                if(!exclude_overlap)
-                  filtered.push_back(cand);
-                else if( (fabs(cand->Eta) < eta1) || (fabs(cand->Eta) > eta2) )
-                  filtered.push_back(cand);
-          }
-      }
-    }
-    else{
-      for (int i = 0; i < unfiltered.size(); i++) {
-          T* cand = unfiltered[i];
-          if((cand->PT < pTmin) && (cand->Eta > etamin) && (cand->Eta < etamax)) {
-                if(!exclude_overlap)
-                  filtered.push_back(cand);
-                else if( (fabs(cand->Eta) < eta1) || (fabs(cand->Eta) > eta2) )
-                  filtered.push_back(cand);
-          }
-      }
-    }
+    selection.release(filtered);
     return filtered;
     }       
     
@@ -202,40 +245,12 @@ class AnalysisBase {
       * \return A vector containing candidates which all are at least dR away from all neighbours.
       */ 
     template <class X, class Y>
-    std::vector<X*> overlapRemoval(std::vector<X*> candidates, std::vector<Y*> neighbours, double dR,std::string pseudorapidity="eta") {
+    std::vector<X*> overlapRemoval(const std::vector<X*>& candidates, const std::vector<Y*>& neighbours, double dR, const std::string& pseudorapidity="eta") {
       // If neighbours are empty, return candidates
-      if(neighbours.size() == 0)
+      if(neighbours.size() == 0 || (pseudorapidity != "eta" && pseudorapidity != "y"))
         return candidates;
       std::vector<X*> passed_candidates;
-      // Loop over candidates
-      for(int i = 0; i < candidates.size(); i++) {
-        bool overlap = false;
-        // If a neighbour is too close, declare overlap, break and don't save candidate
-        for(int j = 0; j < neighbours.size(); j++) {
-          if(pseudorapidity=="eta"){
-            if (candidates[i]->P4().DeltaR(neighbours[j]->P4()) < dR) {
-              overlap = true;
-              break;
-            }
-          }
-          if(pseudorapidity=="y"){
-            double y1   = 1./2.*log(  ((candidates[i]->P4()).E() + (candidates[i]->P4()).Pz())
-            						/((candidates[i]->P4()).E() -(candidates[i]->P4()).Pz()) );
-            double y2   = 1./2.*log(  ((neighbours[j]->P4()).E() + (neighbours[j]->P4()).Pz())
-            						/((neighbours[j]->P4()).E() -(neighbours[j]->P4()).Pz()) );
-        	double dy   = fabs(y1-y2);
-        	double dPhi = candidates[i]->P4().DeltaPhi(neighbours[j]->P4());
-        	double dR_y = sqrt(dy*dy + dPhi*dPhi);
-
-            if (dR_y < dR) {
-              overlap = true;
-              break;
-            }
-          }
-        }
-        if (!overlap)
-          passed_candidates.push_back(candidates[i]);
-      }
+      select(candidates).notNear(neighbours, dR, pseudorapidity == "y").release(passed_candidates);
       return passed_candidates;
     }
   
@@ -250,27 +265,11 @@ class AnalysisBase {
       * \return A vector which contains objects X_i which did not fulfil the removal condition.
       */ 
     template <class X, class Y>
-    std::vector<X*> overlapRemoval_2(std::vector<X*> candidates, std::vector<Y*> neighbours, double dR1, double dR2) {
+    std::vector<X*> overlapRemoval_2(const std::vector<X*>& candidates, const std::vector<Y*>& neighbours, double dR1, double dR2) {
        if(neighbours.size() == 0)
          return candidates;
        std::vector<X*> filtered_candidates;
-       std::vector<bool> delete_candidates;
-       for(int i=0;i<candidates.size();i++){
-         delete_candidates.push_back(false);
-       }
-       for(int i=0;i<candidates.size();i++){
-         for(int j=0;j<neighbours.size();j++){
-           double dR=candidates[i]->P4().DeltaR(neighbours[j]->P4());
-           if(dR1<dR && dR<dR2){
-             delete_candidates[i]=true;//discard candidate
-           }   
-         }
-       }
-       for(int i=0;i<delete_candidates.size();i++){
-         if(delete_candidates[i]==false){
-           filtered_candidates.push_back(candidates[i]);
-         }
-       }
+       select(candidates).notWithin(neighbours, dR1, dR2).release(filtered_candidates);
        return filtered_candidates;
     }
 
@@ -283,12 +282,13 @@ class AnalysisBase {
       *  \sa   overlapRemoval(std::vector<X*> candidates, std::vector<Y*> neighbours, double dR)
       */
     template <class X>
-    std::vector<X*> overlapRemoval(std::vector<X*> candidates, double dR, bool removeBoth = false) {
+    std::vector<X*> overlapRemoval(const std::vector<X*>& candidates, double dR, bool removeBoth = false) {
       // Same as above for the special case that candidates = neighbours. In that case, the removal 
       // can be formulated more effectively as the sum only has to run half as many times
       if(candidates.size() == 0)
         return candidates;
       std::vector<X*> passed_candidates;
+      passed_candidates.reserve(candidates.size());
       std::vector<int> flags;
       // Loop over candidates
       for(int i = 0; i < candidates.size(); i++) {
@@ -332,7 +332,7 @@ class AnalysisBase {
       */
 
     template <class X>
-    std::vector<X*> filter_candidates_in_eta_range(std::vector<X*> candidates,double eta_min,double eta_max,double percent){
+    std::vector<X*> filter_candidates_in_eta_range(const std::vector<X*>& candidates,double eta_min,double eta_max,double percent){
       std::vector<X*> filtered_candidates;
       for(int i=0;i<candidates.size();i++){
         if(candidates[i]->Eta<eta_max && candidates[i]->Eta>eta_min){
@@ -358,7 +358,7 @@ class AnalysisBase {
       */
 
     template <class X>
-    std::vector<X*> filter_candidates_in_pT_range(std::vector<X*> candidates,double pT_min,double pT_max,double percent){
+    std::vector<X*> filter_candidates_in_pT_range(const std::vector<X*>& candidates,double pT_min,double pT_max,double percent){
       std::vector<X*> filtered_candidates;
       for(int i=0;i<candidates.size();i++){
         if(candidates[i]->PT<pT_max && candidates[i]->PT>pT_min){
@@ -388,7 +388,7 @@ class AnalysisBase {
       */
     
     template <class X>
-    std::vector<X*> Isolate_leptons_with_inverse_track_isolation_cone(std::vector<X*> leptons,std::vector<Track*> tracks,std::vector<Tower*> towers,double dR_track_max,double pT_for_inverse_function_track,double dR_tower,double pT_amount_track,double pT_amount_tower,bool checkTower){
+    std::vector<X*> Isolate_leptons_with_inverse_track_isolation_cone(const std::vector<X*>& leptons,const std::vector<Track*>& tracks,const std::vector<Tower*>& towers,double dR_track_max,double pT_for_inverse_function_track,double dR_tower,double pT_amount_track,double pT_amount_tower,bool checkTower){
       std::vector<X*> filtered_leptons;
       for(int i=0;i<leptons.size();i++){
         double dR_track=0;
@@ -398,11 +398,12 @@ class AnalysisBase {
         if(dR_track >dR_track_max){
           dR_track=dR_track_max;
         }
+        Track* ownTrack = ownership->ownTrack(leptons[i]->Particle);
         for (int t = 0; t < tracks.size(); t++) {
           Track* neighbour = tracks[t];
 
 	  // Ignore the lepton's track itself
-          if(neighbour->Particle == leptons[i]->Particle)
+          if(neighbour == ownTrack)
             continue;
           if (neighbour->P4().DeltaR(leptons[i]->P4()) > dR_track)
             continue;
@@ -412,22 +413,16 @@ class AnalysisBase {
           continue;
         }
         if(checkTower){
+          std::vector<Tower*> ownTowers;
+          ownership->addOwnTowers(leptons[i]->Particle, ownTowers);
           for (int t = 0; t < towers.size(); t++) {
             Tower* neighbour = towers[t];
 	    
             // check tower has 'some' momentum and check dR
             if (neighbour->ET < 0.00001 || neighbour->P4().DeltaR(leptons[i]->P4()) > dR_tower)
               continue;
-            // Ignore the lepton's tower
-            bool candidatesTower = false;//This testing is different from the testing in the tracks case, because to one track there corresponds one particle, but for one tower there is not only one particle.
-            for(int p = 0; p < neighbour->Particles.GetEntries(); p++){
-              if (neighbour->Particles.At(p) == leptons[i]->Particle) {
-                // break the loop and ignore the tower
-                candidatesTower = true;
-                break;
-              }
-            }
-            if (candidatesTower)
+            // Ignore the lepton's towers, unlike a track a tower can contain several particles
+            if (std::find(ownTowers.begin(), ownTowers.end(), neighbour) != ownTowers.end())
               continue;
             sumET += neighbour->ET;
           }
@@ -490,22 +485,22 @@ class AnalysisBase {
      *                       If no second parameter is provided, all objects are compared to all existing
      *                       conditions. 
      */
-    std::vector<Electron*> filterIsolation(std::vector<Electron*> unfiltered, std::vector<int> relative_flags = std::vector<int>());
+    std::vector<Electron*> filterIsolation(const std::vector<Electron*>& unfiltered, const std::vector<int>& relative_flags = std::vector<int>());
     
-    //! Remove electrons that are not isolated (simplified function for exactly one condition given as one integer). \sa filterIsolation(std::vector<Electron*> unfiltered, std::vector<int> relative_flags = std::vector<int>())
-    std::vector<Electron*> filterIsolation(std::vector<Electron*> unfiltered, int relative_flag);
+    //! Remove electrons that are not isolated (simplified function for exactly one condition given as one integer). \sa filterIsolation(const std::vector<Electron*>& unfiltered, const std::vector<int>& relative_flags = std::vector<int>())
+    std::vector<Electron*> filterIsolation(const std::vector<Electron*>& unfiltered, int relative_flag);
     
-    //! Remove muons that are not isolated \sa filterIsolation(std::vector<Electron*> unfiltered, std::vector<int> relative_flags = std::vector<int>())
-    std::vector<Muon*> filterIsolation(std::vector<Muon*> unfiltered, std::vector<int> relative_flags = std::vector<int>());
+    //! Remove muons that are not isolated \sa filterIsolation(const std::vector<Electron*>& unfiltered, const std::vector<int>& relative_flags = std::vector<int>())
+    std::vector<Muon*> filterIsolation(const std::vector<Muon*>& unfiltered, const std::vector<int>& relative_flags = std::vector<int>());
     
-    //! Remove muons that are not isolated (simplified function for exactly one condition given as one integer) \sa filterIsolation(std::vector<Electron*> unfiltered, int relative_flag)
-    std::vector<Muon*> filterIsolation(std::vector<Muon*> unfiltered, int relative_flag);
+    //! Remove muons that are not isolated (simplified function for exactly one condition given as one integer) \sa filterIsolation(const std::vector<Electron*>& unfiltered, int relative_flag)
+    std::vector<Muon*> filterIsolation(const std::vector<Muon*>& unfiltered, int relative_flag);
     
-    //! Remove photons that are not isolated \sa filterIsolation(std::vector<Electron*> unfiltered, std::vector<int> relative_flags = std::vector<int>())
-    std::vector<Photon*> filterIsolation(std::vector<Photon*> unfiltered, std::vector<int> relative_flags = std::vector<int>());
+    //! Remove photons that are not isolated \sa filterIsolation(const std::vector<Electron*>& unfiltered, const std::vector<int>& relative_flags = std::vector<int>())
+    std::vector<Photon*> filterIsolation(const std::vector<Photon*>& unfiltered, const std::vector<int>& relative_flags = std::vector<int>());
     
-    //! Remove photons that are not isolated (simplified function for exactly one condition given as one integer) \sa filterIsolation(std::vector<Electron*> unfiltered, int relative_flag)
-    std::vector<Photon*> filterIsolation(std::vector<Photon*> unfiltered, int relative_flag);
+    //! Remove photons that are not isolated (simplified function for exactly one condition given as one integer) \sa filterIsolation(const std::vector<Electron*>& unfiltered, int relative_flag)
+    std::vector<Photon*> filterIsolation(const std::vector<Photon*>& unfiltered, int relative_flag);
     
     //! Checks if candidate jet fulfills given tau identification cut 
     /** If tau tagging was activated in the AnalysisManager, a given jet candidate
@@ -625,6 +620,12 @@ class AnalysisBase {
      *  For more information, see Phys.Rev.Lett. 111 (2013) no.12, 121802 
      */   
     double topness(const TLorentzVector&, const TLorentzVector&, const TLorentzVector&, const TLorentzVector&, const double & sigmat = 15., const double & sigmaW = 5., const double & sigmas = 1000.);        
+
+    //! Evaluates topness for each of the given (lepton, b1, b2, invisible) tuples.
+    /** Same as calling topness() for every tuple. Pairings of the lepton and
+     *  the jets which already occurred in this event are not minimised again.
+     */
+    std::vector<double> topness(const std::vector<topness_tuple>& tuples, const double & sigmat = 15., const double & sigmaW = 5., const double & sigmas = 1000.);
   
     //! Evaluates super razor.
     /** The definition is
@@ -641,6 +642,52 @@ class AnalysisBase {
      *  Phys.Rev.D85 (2012) 034007, arXiv:1112.2567
      */       
     double aplanarity(const std::vector<Jet*> input_jets);     
+
+    //! Clusters the given objects into large radius jets, shared between all analyses of an event.
+    /** Identical calls within an event, also by other analyses, return the
+     *  jets of the first one. The jets stay valid until the end of the event.
+     *  \param objects jets (or other objects with P4()) to be clustered
+     *  \param algorithm jet algorithm, e.g. fastjet::antikt_algorithm
+     *  \param R jet radius
+     *  \param trimRadius radius of the subjets for trimming, no trimming if 0
+     *  \param trimFraction subjets below this fraction of the jet pT are removed by trimming
+     *  \returns all inclusive jets, in order of decreasing pT before trimming
+     */
+    template <class X>
+    const std::vector<fastjet::PseudoJet>& reclusteredJets(const std::vector<X*>& objects, fastjet::JetAlgorithm algorithm, double R, double trimRadius = 0., double trimFraction = 0.) {
+      std::vector<fastjet::PseudoJet> inputs;
+      for (int i = 0; i < objects.size(); i++) {
+        TLorentzVector p = objects[i]->P4();
+        inputs.push_back(fastjet::PseudoJet(p.Px(), p.Py(), p.Pz(), p.E()));
+      }
+      return reclustering->recluster(inputs, algorithm, R, trimRadius, trimFraction);
+    }
+
+    //! Clusters the given pseudojets into large radius jets, see reclusteredJets() above.
+    const std::vector<fastjet::PseudoJet>& reclusteredJets(const std::vector<fastjet::PseudoJet>& inputs, fastjet::JetAlgorithm algorithm, double R, double trimRadius = 0., double trimFraction = 0.) {
+      return reclustering->recluster(inputs, algorithm, R, trimRadius, trimFraction);
+    }
+
+    //! Evaluates sphericity, aplanarity, transverse sphericity, thrust and Fox-Wolfram moments.
+    /** All shapes are taken from the three-momenta of the given objects in
+     *  one call, see event_shapes::event_shape for their definitions.
+     */
+    template <class X>
+    event_shapes::event_shape eventShapes(const std::vector<X*>& objects) {
+      eventShapeMomenta.resize(3*objects.size());
+      for (int i = 0; i < objects.size(); i++) {
+        TVector3 p = objects[i]->P4().Vect();
+        eventShapeMomenta[3*i] = p.X();
+        eventShapeMomenta[3*i+1] = p.Y();
+        eventShapeMomenta[3*i+2] = p.Z();
+      }
+      event_shapes::event_shape shape;
+      event_shapes::evaluate(objects.empty() ? NULL : &eventShapeMomenta[0], objects.size(), shape);
+      return shape;
+    }
+
+    //! Evaluates the event shapes of the three-momenta of the given four-vectors.
+    event_shapes::event_shape eventShapes(const std::vector<TLorentzVector>& objects);
     
     /** @} */    
     
@@ -679,6 +726,57 @@ class AnalysisBase {
     void bookSignalRegions(std::string listOfRegions);  //!< Function to book signal regions.
     void bookControlRegions(std::string listOfRegions); //!< Function to book control regions. \sa bookSignalRegions()
     void bookCutflowRegions(std::string listOfRegions); //!< Function to book cutflow regions. \sa bookSignalRegions()
+    //! Books a grid of signal regions, whose values are then reset after every event. \sa countSignalRegions()
+    void bookSignalRegionGrid(SignalRegionGrid& grid);
+
+    //! Declares truth level bounds which every event in any signal or control region fulfils.
+    /** If the DelphesHandler runs with autoveto, events failing the loosest bounds of all
+     *  analyses skip the detector simulation and are only counted in the sums of weights.
+     *  The bounds are compared with generator level quantities and therefore have to be
+     *  well below the respective reconstructed cuts. Without a call in initialize(), the
+     *  analysis has no bounds and autoveto keeps every event, also for the other analyses
+     *  of the run. Vetoed events still enter the cutflow entry of declareAllEventsCutflow(),
+     *  all other entries counted before the first cut will miss them.
+     *  A bound of 0 (the default) means no constraint.
+     * \param metMin truth missing transverse momentum from invisible particles
+     * \param leadingPTMin pT of the leading lepton or jet
+     * \param htMin scalar pT sum of all visible particles
+     */
+    void declareTruthBounds(double metMin, double leadingPTMin, double htMin) {
+      truthMETMin = metMin;
+      truthLeadingPTMin = leadingPTMin;
+      truthHTMin = htMin;
+    }
+
+    //! Declares reconstruction level bounds which every event in any signal or control region fulfils.
+    /** The AnalysisHandler compares the bounds of all analyses with one summary of each
+     *  reconstructed event. Analyses whose bounds fail are not linked to the event, their
+     *  analyze() is skipped and the event only enters the sums of weights. The bounds refer to
+     *  the objects of the handler, i.e. before any selection of the analysis and before muons are
+     *  added to the missing ET, and therefore have to be at least as loose as the first cuts of
+     *  the analysis. Vetoed events still enter the cutflow entry of declareAllEventsCutflow(),
+     *  all other entries counted before the first cut will miss them.
+     *  A bound of 0 (the default) means no constraint.
+     * \param metMin missing transverse momentum without muons
+     * \param nJetsMin minimum number of jets with pT >= jetPTMin
+     * \param jetPTMin pT threshold of the jets counted in nJetsMin and htMin
+     * \param htMin scalar pT sum of the jets with pT >= jetPTMin
+     */
+    void declareRecoBounds(double metMin, int nJetsMin, double jetPTMin, double htMin) {
+      recoMETMin = metMin;
+      recoNJetsMin = nJetsMin;
+      recoJetPTMin = jetPTMin;
+      recoHTMin = htMin;
+    }
+
+    //! Declares the cutflow entry which analyze() counts for every event before any cut.
+    /** Events vetoed by the truth or reconstruction level bounds skip analyze(), but are
+     *  counted into this entry, such that it keeps all events of the published cutflow.
+     *  \param region name of the cutflow entry, e.g. "00_all"
+     */
+    void declareAllEventsCutflow(const std::string& region) {
+      allEventsCutflow = region;
+    }
     
     //! Function to count a given event for a signal region.
     /** Whenever an event within the analyze() function fulfills all properties to consider it for a 
@@ -686,20 +784,34 @@ class AnalysisBase {
      *  internally and consider it for the final output.
      *  \param region The name of the region the event shoud be counted for. This region should be booked using bookSignalRegions().
      */
-    inline void countSignalEvent(std::string region) {      
+    inline void countSignalEvent(const std::string& region) {      
       signalRegions[region] += weight;
-      signalRegions2[region] += weight*weight;
+      countSquared(signalRegions2[region], weight);
+      if (!weights.empty())
+        countVariations(signalRegionsVariations[region], signalRegionsVariations2[region]);
     }
     //! Function to count a given event for a control region. \sa countSignalEvent
-    inline void countControlEvent(std::string region) {      
+    inline void countControlEvent(const std::string& region) {      
       controlRegions[region] += weight;
-      controlRegions2[region] += weight*weight;
+      countSquared(controlRegions2[region], weight);
+      if (!weights.empty())
+        countVariations(controlRegionsVariations[region], controlRegionsVariations2[region]);
     }
     //! Function to count a given event for a cutflow region. \sa countSignalEvent
-    inline void countCutflowEvent(std::string region) {
+    inline void countCutflowEvent(const std::string& region) {
       cutflowRegions[region] += weight;
-      cutflowRegions2[region] += weight*weight;
+      countSquared(cutflowRegions2[region], weight);
+      if (!weights.empty())
+        countVariations(cutflowRegionsVariations[region], cutflowRegionsVariations2[region]);
     }    
+    //! Counts the event for all regions of a grid that it passes.
+    /** All regions are compared with the variable values the analysis set for the current event.
+     *  The grid has to be booked with bookSignalRegionGrid() in initialize().
+     *  Passing regions are counted with countSignalEvent(). The cutflow entries of the stages each
+     *  region passed are counted with countCutflowEvent(). \sa SignalRegionGrid
+     *  \param grid The grid with the values of the current event.
+     */
+    void countSignalRegions(SignalRegionGrid& grid);
     /** @} */
     
      
@@ -733,6 +845,53 @@ class AnalysisBase {
      *  \return An integer corresponding to the associated object within the fStreams and fNames vectors.
      */
     int bookFile(std::string name, bool noheader = false); 
+
+    //! Function to book a histogram that is filled with the event weights and written at the end of the run.
+    /** @ingroup streams
+     *  Unlike ROOT objects created by the analysis itself, the histogram is stored in the
+     *  run-specific output directory like the files of bookFile(), such that parallel runs do not
+     *  overwrite each other's output. The bins are kept in fixed arrays, filling costs one
+     *  division and two additions. After the run, the histogram is written to
+     *  \<prefix\>_\<analysis\>_name.hist with the standard header and one line per bin, including
+     *  under- and overflow. tools/python/merge_outputs.py adds up the histograms of several runs.
+     *  Histograms must be booked in initialize(), weight variations are not histogrammed.
+     *  \param name Name of the histogram used in the output file name.
+     *  \param nBins Number of equally sized bins between low and high.
+     *  \return An integer identifying the histogram in fillHistogram() and histogram().
+     */
+    int bookHistogram(std::string name, int nBins, double low, double high);
+
+    //! Adds the current event weight to the bin containing x. \sa bookHistogram()
+    inline void fillHistogram(int id, double x) {
+      Histogram& h = *histograms[id];
+      int b = h.bin(x);
+      h.sumW(b) += weight;
+      countSquared(h.sumW2(b), weight);
+    }
+
+    //! Access to a booked histogram, e.g. to evaluate its integral in finalize(). \sa bookHistogram()
+    inline const Histogram& histogram(int id) const {
+      return *histograms[id];
+    }
+
+    //! Function to book a table of per event values written to a compact binary file.
+    /** @ingroup streams
+     *  Replaces writing per event values to text files via fStreams. Rows are buffered
+     *  in memory and written in blocks to \<prefix\>_\<analysis\>_name.ntuple. The event weight
+     *  is added as first column, and the sum of weights of all events as well as cross section
+     *  times luminosity are stored in the header at the end of the run, such that the rows can be
+     *  normalised. tools/python/merge_outputs.py concatenates the ntuples of several runs.
+     *  Ntuples must be booked in initialize().
+     *  \param name Name of the ntuple used in the output file name.
+     *  \param listOfColumns A string of the form "Column1;Column2;..." naming the values of each row.
+     *  \return An integer identifying the ntuple in fillNtuple().
+     */
+    int bookNtuple(std::string name, std::string listOfColumns);
+
+    //! Adds a row with the current event weight and one value per booked column. \sa bookNtuple()
+    inline void fillNtuple(int id, const std::vector<double>& values) {
+      ntuples[id]->fill(weight, values);
+    }
         
     
     //! Other useful helper functions and variables
@@ -761,6 +920,11 @@ class AnalysisBase {
     inline void setAnalysisName(std::string name) {
       analysis = name;
     };
+
+    //! Returns the analysis name set with setAnalysisName().
+    inline std::string getAnalysisName() const {
+      return analysis;
+    };
         
     //! Normalises number to luminosity and cross section.
     /** This function is useful if one stores data beyond the signal/cutflow/control region data which is normalised automatically.
@@ -774,26 +938,40 @@ class AnalysisBase {
     };
 
     //! Returns a pointer to a new FinalStateObject that is automatically cleaned at the end of an event loop
+    /** The objects are kept after the event and overwritten in the following events, such that
+     *  they are only allocated while the number of objects per event grows. The pointer must
+     *  therefore not be used after the event.
+     */
     template <class X>
     FinalStateObject* newFinalStateObject(X* particle) {
-    // allocate a final state particle pointer and store it before returning it
-    FinalStateObject* fso = new FinalStateObject(particle);
-    finalStateObjects.push_back(fso);
-    return fso;
+    // reuse an object of a previous event if there is one, otherwise allocate and store it
+    if (nFinalStateObjects < finalStateObjects.size())
+      *finalStateObjects[nFinalStateObjects] = FinalStateObject(particle);
+    else
+      finalStateObjects.push_back(new FinalStateObject(particle));
+    return finalStateObjects[nFinalStateObjects++];
     }
     
     //! Object to ExRootAnalysis for internal studies
     ExRootResult *result;
     
     //! Does not read out unneeded ROOT information.
-    /** If needed, this function should be called within initialize().
+    /** If needed, this function should be called within initialize(). If no analysis
+     *  of a run reads "tracks" or "towers", the Delphes modules that only produce them are
+     *  removed from the detector simulation. As analyses can read the towers in their own
+     *  code, an analysis which does not call ignore("towers") always keeps the towers, even
+     *  if none of its isolations uses the calorimeter.
      *  \param ignore_what Which information should not be stored? (possible options:
      *   "electrons", "electrons_looseIsolation","electronsMedium","electronsTight","muons",
      *   "muons_looseIsolation","muonsCombinedPlus","muonsCombined","photons","photons_looseIsolation",
      *   "tracks","towers"
      */
-    void ignore(std::string ignore_what) {}; // TODO Remove everywhere
+    void ignore(std::string ignore_what) { ignoredObjects.insert(ignore_what); };
     double weight; //!< Current event weight usable for e.g. histograms
+    //! Weight variations (scale, PDF, ...) of the current event, empty if the input provides none.
+    /** Every region counts each variation separately, and the sums are written as additional
+     *  Sum_W_<name> and Sum_W2_<name> columns behind the nominal ones in the output files. */
+    std::vector<double> weights;
     /** @} */
 
  private:
@@ -820,6 +998,88 @@ class AnalysisBase {
     std::map<std::string, double> controlRegions2;
     std::map<std::string, double> signalRegions2;    
     std::map<std::string, double> cutflowRegions2;
+
+    // The same for every weight variation, indexed as weightNames
+    std::map<std::string, std::vector<double> > controlRegionsVariations;
+    std::map<std::string, std::vector<double> > signalRegionsVariations;
+    std::map<std::string, std::vector<double> > cutflowRegionsVariations;
+    std::map<std::string, std::vector<double> > controlRegionsVariations2;
+    std::map<std::string, std::vector<double> > signalRegionsVariations2;
+    std::map<std::string, std::vector<double> > cutflowRegionsVariations2;
+    std::vector<double> sumOfWeightsVariations;
+    std::vector<double> sumOfWeights2Variations;
+    // Column names of the weight variations, set by the AnalysisHandler
+    std::vector<std::string> weightNames;
+
+    // Name and noheader flag of every bookFile() call, the first nInitialFiles
+    //  ones from initialize() are booked again by reset()
+    std::vector<std::pair<std::string, bool> > bookings;
+    int nInitialFiles;
+
+    // Histograms and ntuples of bookHistogram() and bookNtuple()
+    std::vector<Histogram*> histograms;
+    std::vector<NtupleWriter*> ntuples;
+    std::vector<std::string> ntupleNames;
+    std::vector<std::vector<std::string> > ntupleColumns;
+    // Opens the file of a booked ntuple for the current prefix
+    NtupleWriter* openNtuple(int id);
+
+    // Adds the weight variations of the current event to the given sums
+    void countVariations(std::vector<double>& sumW, std::vector<double>& sumW2);
+
+    // Model independent upper limits on the signal, see sensitiveRegionPrecision()
+    std::map<std::string, double> s95Observed;
+    std::map<std::string, double> s95Expected;
+
+    // Tracks and towers of the generator particles of the current event, set by the AnalysisHandler
+    const ParticleOwnership* ownership;
+
+    // Large radius jets of the current event, shared with the other analyses, set by the AnalysisHandler
+    JetReclustering* reclustering;
+
+    // Minimises topness, caching the pairings evaluated in the current event
+    topness_minimiser topnessMinimiser;
+
+    // Momenta passed to event_shapes::evaluate(), kept to reuse the memory
+    std::vector<double> eventShapeMomenta;
+
+    // Final state object containers passed to ignore()
+    std::set<std::string> ignoredObjects;
+
+    // Truth level bounds of the analysis, see declareTruthBounds()
+    double truthMETMin;
+    double truthLeadingPTMin;
+    double truthHTMin;
+
+    // Reconstruction level bounds of the analysis, see declareRecoBounds()
+    double recoMETMin;
+    int recoNJetsMin;
+    double recoJetPTMin;
+    double recoHTMin;
+    // Cutflow entry counted for every event, see declareAllEventsCutflow()
+    std::string allEventsCutflow;
+
+    // Adds the current event to nEvents and the sums of weights
+    void countEvent();
+
+    // Nesting depth of the currently open event groups
+    int eventGroupDepth;
+    // Weight sums of the open event group, keyed by the squared sum they go to
+    std::map<double*, double> eventGroupSums;
+    // Adds w^2 to sumW2, or remembers w until the event group is finished
+    inline void countSquared(double& sumW2, double w) {
+      if (eventGroupDepth == 0)
+        sumW2 += w*w;
+      else
+        eventGroupSums[&sumW2] += w;
+    }
+    // Writes one of the _cutflow, _signal or _control output files
+    void writeRegions(std::string name,
+                      std::string firstColumn,
+                      std::map<std::string, double>& regions,
+                      std::map<std::string, double>& regions2,
+                      std::map<std::string, std::vector<double> >& variations,
+                      std::map<std::string, std::vector<double> >& variations2);
     
     // There might be N tag conditions in total, but this analysis only
     // tests K out of them. This map tells for a given condition, which of the N entries
@@ -834,15 +1094,12 @@ class AnalysisBase {
     std::map<Jet*, std::vector<bool> > jetBTags;
     std::map<Jet*, std::vector<bool> > jetTauTags;
     
-    // Used by alphaT code
-    struct fabs_less { 
-      bool operator()(const double x, const double y) const { 
-        return fabs(x) < fabs(y); 
-      } 
-    };
-
     // keeps track of all loaded FinalStateParticles and properly frees them 
     std::vector<FinalStateObject*> finalStateObjects;
+    // number of entries of finalStateObjects in use in the current event
+    int nFinalStateObjects;
+    // grids of bookSignalRegionGrid(), reset after every event
+    std::vector<SignalRegionGrid*> signalRegionGrids;
 
 };
 
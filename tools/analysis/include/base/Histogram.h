@@ -0,0 +1,89 @@
+#ifndef _HISTOGRAM
+#define _HISTOGRAM
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+//! Fixed binning histogram of sums of weights, booked via AnalysisBase::bookHistogram().
+/** The sums of weights and of squared weights of all bins are stored in two
+ *  contiguous arrays, bin 0 being the underflow and bin nBins+1 the overflow.
+ *  The arrays are allocated once, such that the AnalysisBase can refer to
+ *  the bins while event groups are open. The histogram is written as a text
+ *  table whose bins can be summed between files of different runs.
+ */
+class Histogram {
+ public:
+    //! \brief Constructor, all bins are empty
+    //!
+    //! \param name name of the histogram, part of the output file name
+    //! \param nBins number of bins between low and high
+    //! \param low lower edge of the first bin
+    //! \param high upper edge of the last bin
+    Histogram(const std::string& name, int nBins, double low, double high);
+
+    //! Name of the histogram
+    inline const std::string& name() const {
+        return histogramName;
+    }
+
+    //! Number of bins without under- and overflow
+    inline int nBins() const {
+        return bins;
+    }
+
+    //! Bin containing x, 0 for x < low (or NaN) and nBins+1 for x >= high
+    inline int bin(double x) const {
+        if (!(x >= low))
+            return 0;
+        if (x >= high)
+            return bins+1;
+        int b = 1+(int)((x-low)*inverseWidth);
+        // rounding can push values right below high out of the last bin
+        return b > bins ? bins : b;
+    }
+
+    //! Lower edge of a bin
+    double lowEdge(int bin) const;
+
+    //! Upper edge of a bin
+    double highEdge(int bin) const;
+
+    //! Sum of weights in a bin
+    inline double& sumW(int bin) {
+        return sumsW[bin];
+    }
+    inline double sumW(int bin) const {
+        return sumsW[bin];
+    }
+
+    //! Sum of squared weights in a bin
+    inline double& sumW2(int bin) {
+        return sumsW2[bin];
+    }
+    inline double sumW2(int bin) const {
+        return sumsW2[bin];
+    }
+
+    //! Sum of weights of the bins firstBin to lastBin, both included
+    double integral(int firstBin, int lastBin) const;
+
+    //! Sets all bins to zero
+    void clear();
+
+    //! \brief Writes one line per bin, including under- and overflow
+    //!
+    //! \param normalisation factor from sums of weights to expected events
+    void write(std::ostream& out, double normalisation) const;
+
+ private:
+    std::string histogramName;
+    int bins;
+    double low;
+    double high;
+    double inverseWidth;
+    std::vector<double> sumsW;
+    std::vector<double> sumsW2;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef _JETRECLUSTERING
+#define _JETRECLUSTERING
+
+#include <vector>
+
+#include "external/fastjet/JetDefinition.hh"
+#include "external/fastjet/ClusterSequence.hh"
+
+//! Per event cache of large radius jets clustered from other jets.
+/** Several analyses recluster their small radius jets into large radius
+ *  jets with the same algorithm, radius and trimming. The handler shares
+ *  one instance between all analyses and clears it for every event, such
+ *  that each distinct reclustering only runs once per event. The cache
+ *  owns the cluster sequences, the returned jets and their constituents
+ *  stay valid until the end of the event.
+ */
+class JetReclustering {
+ public:
+    //! Constructor
+    JetReclustering();
+
+    //! Destructor, deletes the cluster sequences
+    ~JetReclustering();
+
+    //! Forgets the jets of the previous event
+    void clear();
+
+    //! \brief Clusters the inputs, or returns the jets of an identical earlier call in this event
+    //!
+    //! Inputs are identical if their four-momenta and user indices are.
+    //! \param inputs objects to be clustered
+    //! \param algorithm jet algorithm
+    //! \param R jet radius
+    //! \param trimRadius radius of the subjets for trimming, no trimming if 0
+    //! \param trimFraction subjets below this fraction of the jet pT are removed by trimming
+    //! \return all inclusive jets, trimmed if requested, in order of decreasing pT before trimming
+    const std::vector<fastjet::PseudoJet>& recluster(const std::vector<fastjet::PseudoJet>& inputs,
+                                                      fastjet::JetAlgorithm algorithm,
+                                                      double R,
+                                                      double trimRadius,
+                                                      double trimFraction);
+
+ private:
+    JetReclustering(const JetReclustering&);
+    JetReclustering& operator=(const JetReclustering&);
+
+    struct reclustering {
+        fastjet::JetAlgorithm algorithm;
+        double R;
+        double trimRadius;
+        double trimFraction;
+        std::vector<double> signature; // px, py, pz, E, user index of every input
+        fastjet::ClusterSequence* sequence;
+        std::vector<fastjet::PseudoJet> jets;
+    };
+    std::vector<reclustering*> reclusterings;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef _NTUPLEWRITER
+#define _NTUPLEWRITER
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+//! Buffered binary writer of one row of doubles per call, booked via AnalysisBase::bookNtuple().
+/** The file starts with a fixed header
+ *   - 8 characters "CMNTUPLE",
+ *   - int32 format version, int32 number of columns,
+ *   - int64 number of rows, double sum of weights of all events, double cross section times luminosity,
+ *   - the column names, each terminated by '\\0',
+ *
+ *  followed by the rows in native byte order. The first column always is the event
+ *  weight. Rows are collected in memory and written in blocks. The number of rows
+ *  and the sums are only known at close(), which writes them into the header, such that
+ *  files of several runs can be concatenated and normalised together.
+ */
+class NtupleWriter {
+ public:
+    //! \brief Opens the file and writes the header
+    //!
+    //! \param filename absolute path of the output file
+    //! \param columns names of the columns following the weight column
+    NtupleWriter(const std::string& filename, const std::vector<std::string>& columns);
+
+    //! Destructor, closes the file if that did not happen yet
+    ~NtupleWriter();
+
+    //! Number of columns without the weight column
+    inline int nColumns() const {
+        return columnNames.size()-1;
+    }
+
+    //! \brief Adds a row
+    //!
+    //! \param weight event weight
+    //! \param values one value per column, aborts if the number does not match
+    void fill(double weight, const std::vector<double>& values);
+
+    //! \brief Writes the remaining rows and the totals into the header and closes the file
+    //!
+    //! \param sumOfWeights sum of the weights of all events of the run, not only those of the rows
+    //! \param normalisation cross section times luminosity
+    void close(double sumOfWeights, double normalisation);
+
+ private:
+    NtupleWriter(const NtupleWriter&);
+    NtupleWriter& operator=(const NtupleWriter&);
+
+    void flush();
+
+    std::string filename;
+    std::vector<std::string> columnNames;
+    std::ofstream file;
+    std::vector<double> buffer;
+    long long nRows;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef _PARTICLEOWNERSHIP
+#define _PARTICLEOWNERSHIP
+
+#include <vector>
+
+#include <TRef.h>
+#include <TRefArray.h>
+
+#include "classes/DelphesClasses.h"
+
+//! Per event index of the tracks and towers every generator particle ended up in.
+/** Isolation conditions have to ignore the track and the towers of the
+ *  candidate itself. Instead of resolving the TRefArray of every tower in
+ *  the cone, the index is built once per event from the unique IDs of the
+ *  references and answers which tracks and towers a particle belongs to in
+ *  constant time.
+ */
+class ParticleOwnership {
+ public:
+    //! Constructor
+    ParticleOwnership();
+
+    //! Rebuilds the index for the tracks and towers of a new event
+    void build(const std::vector<Track*>& tracks, const std::vector<Tower*>& towers);
+
+    //! Returns the track of the given particle, NULL if there is none
+    Track* ownTrack(const TRef& particle) const;
+
+    //! Adds the towers the given particle deposited energy in to result
+    void addOwnTowers(const TRef& particle, std::vector<Tower*>& result) const;
+
+    //! Adds the towers any of the given particles deposited energy in to result
+    void addOwnTowers(const TRefArray& particles, std::vector<Tower*>& result) const;
+
+ private:
+    // object number of a reference, the process ID is the same within an event
+    static inline UInt_t key(UInt_t uid) { return uid & 0xffffff; }
+    // slot of an object number in the dense vectors, -1 if not indexed
+    inline int slot(UInt_t uid) const {
+        UInt_t k = key(uid);
+        if (k < minKey || k >= minKey+tracksBySlot.size())
+            return -1;
+        return k-minKey;
+    }
+    void addTowers(int s, std::vector<Tower*>& result) const;
+
+    UInt_t minKey; // smallest object number of the event
+    std::vector<Track*> tracksBySlot; // track of each particle slot
+    std::vector<int> towerOffsets; // towers of slot s are towerList[towerOffsets[s]...towerOffsets[s+1]-1]
+    std::vector<Tower*> towerList;
+};
+
+#endif
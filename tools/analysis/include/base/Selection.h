@@ -0,0 +1,243 @@
+#ifndef _SELECTION
+#define _SELECTION
+
+#include <algorithm>
+#include <math.h>
+#include <vector>
+
+#include <TLorentzVector.h>
+
+//! Lazy selection of physics objects that applies all its cuts in one pass.
+/** Cuts are collected by chaining, e.g.
+ *  \code
+ *  std::vector<Jet*> signalJets = select(jets).pt(20).eta(-2.8, 2.8).notNear(electrons, 0.2).sortedByPT();
+ *  \endcode
+ *  and only evaluated once the objects are needed, such that each object is
+ *  tested against all cuts in a single loop and no intermediate lists are
+ *  created. The order of the cuts does not matter. Sorting or passing the
+ *  selection as neighbours to another selection evaluates the cuts collected
+ *  so far, further cuts are then applied to the selected objects.
+ *
+ *  The selection refers to the input vector and to the neighbours of
+ *  notNear(), which must not change before the objects are evaluated.
+ *  Objects must provide PT, Eta and P4(), as Electron, Muon, Photon, Jet,
+ *  Track and FinalStateObject do.
+ */
+template <class T>
+class Selection {
+ public:
+    //! Starts a selection of all given objects
+    explicit Selection(const std::vector<T*>& objects) : source(&objects) {
+        reset();
+    }
+
+    Selection(const Selection& other) {
+        *this = other;
+    }
+
+    Selection& operator=(const Selection& other) {
+        if (this == &other)
+            return *this;
+        selected = other.selected;
+        // a selection that was evaluated before refers to its own objects
+        source = (other.source == &other.selected) ? &selected : other.source;
+        pTmin = other.pTmin;
+        pTmax = other.pTmax;
+        etamin = other.etamin;
+        etamax = other.etamax;
+        etaGaps = other.etaGaps;
+        neighbourCuts = other.neighbourCuts;
+        pending = other.pending;
+        return *this;
+    }
+
+    //! Keeps objects with PT > pTmin
+    Selection& pt(double pTmin_) {
+        pTmin = std::max(pTmin, pTmin_);
+        pending = true;
+        return *this;
+    }
+
+    //! Keeps objects with PT < pTmax
+    Selection& ptBelow(double pTmax_) {
+        pTmax = std::min(pTmax, pTmax_);
+        pending = true;
+        return *this;
+    }
+
+    //! Keeps objects with etamin < Eta < etamax
+    Selection& eta(double etamin_, double etamax_) {
+        etamin = std::max(etamin, etamin_);
+        etamax = std::min(etamax, etamax_);
+        pending = true;
+        return *this;
+    }
+
+    //! Removes objects with eta1 <= |Eta| <= eta2, e.g. the calorimeter crack 1.37 <= |eta| <= 1.52
+    Selection& excludeEta(double eta1, double eta2) {
+        etaGaps.push_back(eta1);
+        etaGaps.push_back(eta2);
+        pending = true;
+        return *this;
+    }
+
+    //! \brief Removes objects closer than dR to any of the neighbours
+    //!
+    //! \param neighbours objects of any type with P4()
+    //! \param dR minimum separation to all neighbours
+    //! \param rapidity if true, the separation is evaluated with the rapidity instead of the pseudorapidity
+    template <class Y>
+    Selection& notNear(const std::vector<Y*>& neighbours, double dR, bool rapidity = false) {
+        return notWithin(neighbours, -1., dR, rapidity);
+    }
+
+    //! Removes objects closer than dR to any of the objects of another selection, which is evaluated for that
+    template <class Y>
+    Selection& notNear(Selection<Y>& neighbours, double dR, bool rapidity = false) {
+        return notWithin(neighbours.objects(), -1., dR, rapidity);
+    }
+
+    //! Removes objects with dRmin < dR < dRmax to any of the neighbours
+    template <class Y>
+    Selection& notWithin(const std::vector<Y*>& neighbours, double dRmin, double dRmax, bool rapidity = false) {
+        neighbourCut cut;
+        cut.dRmin = dRmin;
+        cut.dRmax = dRmax;
+        cut.rapidity = rapidity;
+        neighbourCuts.push_back(cut);
+        // the neighbours' four-momenta are evaluated once instead of for every candidate
+        std::vector<TLorentzVector>& momenta = neighbourCuts.back().momenta;
+        momenta.reserve(neighbours.size());
+        for (int j = 0; j < neighbours.size(); j++)
+            momenta.push_back(neighbours[j]->P4());
+        pending = true;
+        return *this;
+    }
+
+    //! Evaluates the cuts and orders the selected objects by decreasing PT
+    Selection& sortedByPT() {
+        evaluate();
+        if (source != &selected) {
+            selected.assign(source->begin(), source->end());
+            source = &selected;
+        }
+        std::stable_sort(selected.begin(), selected.end(), higherPT);
+        return *this;
+    }
+
+    //! Evaluates the cuts and returns the selected objects
+    const std::vector<T*>& objects() {
+        evaluate();
+        return *source;
+    }
+
+    //! Evaluates the cuts and returns a copy of the selected objects
+    operator std::vector<T*>() {
+        return objects();
+    }
+
+    //! Evaluates the cuts and moves the selected objects into target, leaving the selection empty
+    void release(std::vector<T*>& target) {
+        evaluate();
+        if (source == &selected)
+            target.swap(selected);
+        else
+            target = *source;
+        selected.clear();
+        source = &selected;
+    }
+
+    //! Number of selected objects
+    int size() {
+        return objects().size();
+    }
+
+    //! The i-th selected object
+    T* operator[](int i) {
+        return objects()[i];
+    }
+
+ private:
+    struct neighbourCut {
+        double dRmin;
+        double dRmax;
+        bool rapidity;
+        std::vector<TLorentzVector> momenta;
+    };
+
+    //! Forgets the cuts once they are applied
+    void reset() {
+        pTmin = -HUGE_VAL;
+        pTmax = HUGE_VAL;
+        etamin = -HUGE_VAL;
+        etamax = HUGE_VAL;
+        etaGaps.clear();
+        neighbourCuts.clear();
+        pending = false;
+    }
+
+    static double rapidity(const TLorentzVector& p) {
+        return 1./2.*log((p.E()+p.Pz())/(p.E()-p.Pz()));
+    }
+
+    bool passes(T* candidate) const {
+        if (!(candidate->PT > pTmin && candidate->PT < pTmax && candidate->Eta > etamin && candidate->Eta < etamax))
+            return false;
+        for (int g = 0; g < etaGaps.size(); g += 2)
+            if (fabs(candidate->Eta) >= etaGaps[g] && fabs(candidate->Eta) <= etaGaps[g+1])
+                return false;
+        if (neighbourCuts.empty())
+            return true;
+        TLorentzVector p4 = candidate->P4();
+        for (int c = 0; c < neighbourCuts.size(); c++) {
+            const neighbourCut& cut = neighbourCuts[c];
+            for (int j = 0; j < cut.momenta.size(); j++) {
+                double dR;
+                if (cut.rapidity) {
+                    double dy = fabs(rapidity(p4)-rapidity(cut.momenta[j]));
+                    double dPhi = p4.DeltaPhi(cut.momenta[j]);
+                    dR = sqrt(dy*dy + dPhi*dPhi);
+                } else {
+                    dR = p4.DeltaR(cut.momenta[j]);
+                }
+                if (cut.dRmin < dR && dR < cut.dRmax)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    //! Applies all collected cuts in one pass, in place once the selection owns its objects
+    void evaluate() {
+        if (!pending)
+            return;
+        if (source == &selected) {
+            int n = 0;
+            for (int i = 0; i < selected.size(); i++)
+                if (passes(selected[i]))
+                    selected[n++] = selected[i];
+            selected.resize(n);
+        } else {
+            selected.clear();
+            selected.reserve(source->size());
+            for (int i = 0; i < source->size(); i++)
+                if (passes((*source)[i]))
+                    selected.push_back((*source)[i]);
+            source = &selected;
+        }
+        reset();
+    }
+
+    static bool higherPT(const T* lhs, const T* rhs) {
+        return lhs->PT > rhs->PT;
+    }
+
+    const std::vector<T*>* source; // the input, or selected once the cuts were evaluated
+    std::vector<T*> selected;
+    double pTmin, pTmax, etamin, etamax;
+    std::vector<double> etaGaps; // pairs of |eta| boundaries
+    std::vector<neighbourCut> neighbourCuts;
+    bool pending; // whether there are cuts which were not yet applied
+};
+
+#endif
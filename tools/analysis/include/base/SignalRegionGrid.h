@@ -0,0 +1,111 @@
+#ifndef _SIGNALREGIONGRID
+#define _SIGNALREGIONGRID
+
+#include <string>
+#include <vector>
+
+//! Table of cut thresholds of many signal regions on the same per event variables.
+/** Analyses with many signal regions often apply the same sequence of cuts with
+ *  different thresholds. Instead of evaluating all variables again for every region,
+ *  the grid is set up once in initialize():
+ *   - addStage() opens a cut stage, optionally with a cutflow entry,
+ *   - addVariable() adds a lower or upper bound cut on a named variable to the last stage,
+ *   - addRegion() and setThreshold() fill in the thresholds of every region.
+ *
+ *  For every event the analysis computes each variable once with setValue() and
+ *  AnalysisBase::countSignalRegions() compares all regions with one loop per
+ *  variable and counts the passing regions and their cutflows. An event fails a lower bound
+ *  if value < threshold and an upper bound if value > threshold, regions without a
+ *  threshold for a variable are not cut on it. The grid has to be booked with
+ *  AnalysisBase::bookSignalRegionGrid(), which resets the values after every event:
+ *  variables not set in an event fail every region with a threshold on them.
+ */
+class SignalRegionGrid {
+ public:
+    //! Constructor
+    SignalRegionGrid();
+
+    //! \brief Adds a stage of cuts, the following variables are part of it
+    //!
+    //! \param cutflowSuffix if not empty, regions passing all cuts up to this stage
+    //!                      count the cutflow entry region+cutflowSuffix
+    void addStage(const std::string& cutflowSuffix = "");
+
+    //! \brief Adds a variable to the last stage
+    //!
+    //! \param name name of the variable, unique within the grid
+    //! \param upperBound if true, the thresholds are upper bounds, otherwise lower bounds
+    //! \return index of the variable for setValue() and setThreshold()
+    int addVariable(const std::string& name, bool upperBound = false);
+
+    //! \brief Adds a region without any cuts, variables must not be added afterwards
+    //!
+    //! \return index of the region for setThreshold()
+    int addRegion(const std::string& name);
+
+    //! Sets the threshold of a region on a variable
+    void setThreshold(int region, int variable, double threshold);
+
+    //! Sets the threshold of a region on a variable given by its name
+    void setThreshold(int region, const std::string& variable, double threshold);
+
+    //! Returns the index of a variable, aborts if it does not exist
+    int variable(const std::string& name) const;
+
+    //! Sets the value of a variable in the current event
+    inline void setValue(int variable, double value) {
+        values[variable] = value;
+    }
+
+    //! Compares the values of the current event with the thresholds of all regions
+    void evaluate();
+
+    //! Marks the values of all variables as not set
+    void reset();
+
+    //! Number of regions
+    inline int nRegions() const {
+        return regionNames.size();
+    }
+
+    //! Name of a region
+    inline const std::string& regionName(int region) const {
+        return regionNames[region];
+    }
+
+    //! Number of stages
+    inline int nStages() const {
+        return stageSuffixes.size();
+    }
+
+    //! Name of the cutflow entry of a region after a stage, empty if the stage has none
+    inline const std::string& cutflowName(int region, int stage) const {
+        return cutflowNames[region*stageSuffixes.size()+stage];
+    }
+
+    //! Number of leading stages the region passed in the last evaluated event
+    inline int stagesPassed(int region) const {
+        return passedStages[region];
+    }
+
+    //! Whether the region passed all cuts in the last evaluated event
+    inline bool passed(int region) const {
+        return passedStages[region] == stageSuffixes.size();
+    }
+
+ private:
+    std::vector<std::string> stageSuffixes;
+    std::vector<int> firstVariables; // first variable of every stage
+    std::vector<std::string> variableNames;
+    std::vector<bool> upperBounds;
+    std::vector<std::string> regionNames;
+    std::vector<std::string> cutflowNames; // region-major, one per region and stage
+
+    // variable-major, such that each variable is compared with all regions in one loop
+    std::vector<std::vector<double> > thresholds;
+    std::vector<double> values;
+    std::vector<char> alive;
+    std::vector<int> passedStages;
+};
+
+#endif
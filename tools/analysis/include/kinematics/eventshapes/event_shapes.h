@@ -0,0 +1,57 @@
+#ifndef EVENT_SHAPES_H
+#define EVENT_SHAPES_H
+
+/* Event shapes of a set of three-momenta, evaluated together in one call.
+ *
+ * The sphericity tensor is summed in a single pass over the objects and
+ * diagonalised in closed form (Cardano's formula for symmetric 3x3
+ * matrices), such that no matrix objects are allocated. Thrust is found
+ * exactly for few objects by testing every axis orthogonal to two of the
+ * momenta, and approximately for many objects by iterating the axis from
+ * the hardest momenta.
+ *
+ * The momenta are passed as a flat array px, py, pz of object 0, then of
+ * object 1 and so on, no memory is allocated.
+ */
+namespace event_shapes
+{
+    //! Up to this many objects thrust is evaluated exactly
+    static const int maxExactThrustObjects = 24;
+
+    //! Highest order of the Fox-Wolfram moments
+    static const int maxFoxWolframOrder = 4;
+
+    //! Event shapes of one set of momenta
+    struct event_shape {
+        //! Eigenvalues of sum_i p_i^a p_i^b / sum_i |p_i|^2, in decreasing order
+        double eigenvalues[3];
+        //! 3/2 (lambda_2 + lambda_3)
+        double sphericity;
+        //! 3/2 lambda_3
+        double aplanarity;
+        //! 2 lambda_2 / (lambda_1 + lambda_2) of the transverse tensor
+        double transverse_sphericity;
+        //! max_n sum_i |p_i . n| / sum_i |p_i|
+        double thrust;
+        //! Unit vector along which the thrust is reached
+        double thrust_axis[3];
+        //! sum_ij |p_i| |p_j| P_l(cos theta_ij) / (sum_i |p_i|)^2 for l = 0...maxFoxWolframOrder
+        double fox_wolfram[maxFoxWolframOrder+1];
+    };
+
+    //! \brief Eigenvalues of a real symmetric 3x3 matrix in decreasing order
+    //!
+    //! \param tensor the elements xx, yy, zz, xy, xz, yz
+    //! \param eigenvalues set to the eigenvalues, largest first
+    void symmetric_eigenvalues(const double tensor[6], double eigenvalues[3]);
+
+    //! \brief Evaluates all event shapes of the given momenta
+    //!
+    //! All shapes are 0 if there are no momenta or all of them vanish.
+    //! \param momenta px, py, pz of every object, 3*n numbers
+    //! \param n number of objects
+    //! \param shape set to the event shapes
+    void evaluate(const double* momenta, int n, event_shape& shape);
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef HEMISPHERE_PARTITION_H
+#define HEMISPHERE_PARTITION_H
+
+#include <vector>
+
+#include <TLorentzVector.h>
+
+/* Searches over all splits of a set of objects into two hemispheres, as
+ * needed for alphaT and the razor megajets.
+ *
+ * Instead of summing every split from scratch, the splits are walked in
+ * Gray code order, such that neighbouring splits differ by one object and
+ * the hemisphere sums are updated in constant time. For many objects the
+ * signed sums of alphaT are found by meet in the middle and the megajets by
+ * a depth first search which drops branches whose masses can only grow
+ * beyond the best split found so far.
+ *
+ * The fast sums differ from the original ones by rounding, therefore every
+ * split within a rounding bound of the minimum is evaluated again exactly
+ * like the original brute force code did. The results, including the
+ * choice between degenerate splits, are the same as before.
+ */
+namespace hemisphere_partition
+{
+    //! \brief Smallest absolute value of a signed sum of the given values
+    //!
+    //! Equal to the minimum of |sum_j values[j]*(1-2*s_j)| over all s_j in {0,1}
+    //! with the last s_j being 0, summed in the order of the values.
+    //! Returns 0 if there are no values.
+    double min_signed_sum(const std::vector<double>& values);
+
+    //! \brief Splits objects into two hemispheres of minimal sum of squared masses
+    //!
+    //! Both hemispheres contain at least one object. Of degenerate splits the
+    //! one found first by the original enumeration is taken, in which the
+    //! first object corresponds to the highest bit and lies in the second
+    //! hemisphere.
+    //! \param objects four-vectors to be split
+    //! \param first sum of the objects in the first hemisphere, set if a split exists
+    //! \param second sum of the objects in the second hemisphere, set if a split exists
+    //! \return first.M2()+second.M2(), the largest double if there are less than two objects
+    double min_mass_split(const std::vector<TLorentzVector>& objects,
+                          TLorentzVector& first,
+                          TLorentzVector& second);
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef TOPNESS_MINIMISER_H
+#define TOPNESS_MINIMISER_H
+
+#include <vector>
+
+#include <TLorentzVector.h>
+
+/* Deterministic minimisation of the topness statistic S of
+ *
+ *   Hunting Mixed Top Squark Decays
+ *   Michael L. Graesser, Jessie Shelton
+ *   Phys.Rev.Lett. 111 (2013) 12, 121802, arXiv:1212.4495
+ *
+ * S is the same function as my_func in topness_struct.h. It is minimised
+ * by Newton steps with analytic first and second derivatives, damped like
+ * in the Levenberg-Marquardt method. Instead of random starting points, the
+ * neutrino transverse momentum is scanned on a fixed grid, with the z
+ * momenta putting the W of the leptonic and the top of the hadronic side on
+ * shell, and the minimisation starts from the best local minima of the grid.
+ * The result therefore does not depend on rand() and is reproducible.
+ *
+ * Both pairings of the lepton with the jets are minimised separately and
+ * cached, such that evaluating the same jets again in an event is free.
+ */
+
+//! Input of one topness evaluation, see topness_minimiser::minimum
+struct topness_tuple {
+    TLorentzVector lepton; //!< visible lepton
+    TLorentzVector b1; //!< first b (or other) jet
+    TLorentzVector b2; //!< second b (or other) jet
+    TLorentzVector invis; //!< missing transverse momentum, only x and y are used
+};
+
+class topness_minimiser {
+public:
+    //! Constructor
+    topness_minimiser();
+
+    //! \brief Minimum of S over both pairings of the lepton with the jets
+    //!
+    //! Arrays are (px, py, pz, E), only px and py of MET are used.
+    //! \param xbest set to the minimising neutrino px, py, pz and W pz
+    //! \return min S, the topness is log(min S)
+    double minimum(const double pb1[4], const double pb2[4], const double pl[4], const double MET[4],
+                   double sigmat, double sigmaW, double sigmas, double xbest[4]);
+
+    //! Minimum of S for each of the given tuples
+    std::vector<double> minimum(const std::vector<topness_tuple>& tuples,
+                                double sigmat, double sigmaW, double sigmas);
+
+    //! Forgets the cached pairings, e.g. at the start of a new event
+    void clear();
+
+private:
+    // result of one pairing, bW forming the top with the W, bl with the lepton
+    struct pairing_result {
+        double key[17]; // bW, bl, l, MET x and y, sigmat, sigmaW, sigmas
+        double value;
+        double x[4];
+    };
+
+    // Minimises S for one pairing, via the cache
+    double pairing(const double bW[4], const double bl[4], const double pl[4], const double MET[4],
+                   double sigmat, double sigmaW, double sigmas, double xbest[4]);
+
+    std::vector<pairing_result> cache;
+};
+
+#endif
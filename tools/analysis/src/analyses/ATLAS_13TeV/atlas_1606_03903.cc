@@ -236,35 +236,8 @@ void Atlas_1606_03903::analyze() {
 //  if ( jetsBSig.size() > 0 ) histo_top->Fill(top_ness[0]);
   
 // do fatjets
-  std::vector<fastjet::PseudoJet> particles;
-  for ( int i = 0; i < jetsSig.size(); i++ ) {
-    double tmppx = jetsSig[i]->P4().Px(); 
-    double tmppy = jetsSig[i]->P4().Py(); 
-    double tmppz = jetsSig[i]->P4().Pz(); 
-    double tmpe  = jetsSig[i]->P4().E(); 
-    particles.push_back( fastjet::PseudoJet(tmppx, tmppy, tmppz, tmpe) );
-  }  
-  
-  fastjet::JetDefinition jet_def_1(fastjet::antikt_algorithm, 1.0);
-  fastjet::JetDefinition jet_def_12(fastjet::antikt_algorithm, 1.2);
-  
-  fastjet::ClusterSequence cs1(particles, jet_def_1);
-  fastjet::ClusterSequence cs12(particles, jet_def_12);
-  std::vector<fastjet::PseudoJet> compjets1 = sorted_by_pt(cs1.inclusive_jets());
-  std::vector<fastjet::PseudoJet> compjets12 = sorted_by_pt(cs12.inclusive_jets());
-  
-  fastjet::Filter trimmer1(0.4, fastjet::SelectorPtFractionMin(0.05));
-  fastjet::Filter trimmer12(0.4, fastjet::SelectorPtFractionMin(0.05));
-  
-  std::vector<fastjet::PseudoJet> temp1;
-  std::vector<fastjet::PseudoJet> temp12;
-  for ( int i = 0; i < compjets1.size(); i++ ) 
-    temp1.push_back(trimmer1(compjets1[i]));
-  for ( int i = 0; i < compjets12.size(); i++ ) 
-    temp12.push_back(trimmer12(compjets12[i]));  
-  
-  std::vector<fastjet::PseudoJet> large_jets1 = sorted_by_pt(temp1);
-  std::vector<fastjet::PseudoJet> large_jets12 = sorted_by_pt(temp12);  
+  std::vector<fastjet::PseudoJet> large_jets1 = sorted_by_pt(reclusteredJets(jetsSig, fastjet::antikt_algorithm, 1.0, 0.4, 0.05));
+  std::vector<fastjet::PseudoJet> large_jets12 = sorted_by_pt(reclusteredJets(jetsSig, fastjet::antikt_algorithm, 1.2, 0.4, 0.05));  
   
 // now signal regions
   if ( jetsSig[0]->PT > 80.) { //SR1
@@ -115,17 +115,8 @@ void Atlas_1709_04183::analyze() {
   if (jets[3]->PT < 40.) return;
   countCutflowEvent("08b_jets_pT");    
   
-  std::vector<fastjet::PseudoJet> particles;
-  for ( int i = 0; i < jets.size(); i++ ) 
-    particles.push_back( fastjet::PseudoJet(jets[i]->P4().Px(), jets[i]->P4().Py(), jets[i]->P4().Pz(), jets[i]->P4().E()) );
-
-  fastjet::JetDefinition jet_def12(fastjet::antikt_algorithm, 1.2);
-  fastjet::JetDefinition jet_def08(fastjet::antikt_algorithm, 0.8);  
- 
-  fastjet::ClusterSequence cs12(particles, jet_def12);
-  fastjet::ClusterSequence cs08(particles, jet_def08);
-  std::vector<fastjet::PseudoJet> largeR12 = sorted_by_pt(cs12.inclusive_jets());  
-  std::vector<fastjet::PseudoJet> largeR08 = sorted_by_pt(cs08.inclusive_jets());  
+  const std::vector<fastjet::PseudoJet>& largeR12 = reclusteredJets(jets, fastjet::antikt_algorithm, 1.2);
+  const std::vector<fastjet::PseudoJet>& largeR08 = reclusteredJets(jets, fastjet::antikt_algorithm, 0.8);
   
   if ( SRA( jets, bjets, nonbjets, largeR12, largeR08, 120., 10000., 1., 400., 400., "SRA-TT") ) countSignalEvent("SRA-TT");
   if ( SRA( jets, bjets, nonbjets, largeR12, largeR08,  60.,   120., 0., 400., 500., "SRA-TW") ) countSignalEvent("SRA-TW");
@@ -15,7 +15,58 @@ void Atlas_1712_02332::initialize() {
   // You can also book cutflow regions with bookCutflowRegions("CR1;CR2;..."). Note that the regions are
   //  always ordered alphabetically in the cutflow output files.
 
-  // You should initialize any declared variables here
+  // One stage per cutflow step, variables that depend on the jet multiplicity
+  //  exist once for every multiplicity
+  bookSignalRegionGrid(regionGrid);
+  regionGrid.addStage();
+  varBoosted = regionGrid.addVariable("boosted");
+  regionGrid.addStage("_06_jetmulti");
+  varNJets = regionGrid.addVariable("nJets");
+  regionGrid.addStage("_07_dPhilow");
+  varDPhi1 = regionGrid.addVariable("dPhi1");
+  regionGrid.addStage("_08_dPhihigh");
+  varDPhi2 = regionGrid.addVariable("dPhi2");
+  regionGrid.addStage("_09_PTjets");
+  varPT1 = regionGrid.addVariable("PT1");
+  for (int n = 2; n <= maxJets; n++)
+    varPTN[n] = regionGrid.addVariable("PT"+Global::intToStr(n));
+  regionGrid.addStage("_10_Etajets");
+  for (int n = 2; n <= maxJets; n++)
+    varEtaN[n] = regionGrid.addVariable("EtaMax"+Global::intToStr(n), true);
+  regionGrid.addStage("_11_aplanarity");
+  varAplanarity = regionGrid.addVariable("aplanarity");
+  regionGrid.addStage("_12_METrelative");
+  for (int n = 2; n <= maxJets; n++)
+    varMETMeffN[n] = regionGrid.addVariable("METMeff"+Global::intToStr(n));
+  varMETHT = regionGrid.addVariable("METHT");
+  regionGrid.addStage("_13_Meff");
+  varMeff = regionGrid.addVariable("Meff");
+
+//                      PTj1  PTj2  Nj  Eta Phi1 Phi2 ET/HT Apl ET/meff Meff   boosted
+  addRegion("2j-1200",  250., 250., 2, 0.8, 0.8, 0.4, 14., 0.,   0.,   1200., false);
+  addRegion("2j-1600",  300., 300., 2, 1.2, 0.8, 0.4, 18., 0.,   0.,   1600., false);
+  addRegion("2j-2000",  350., 350., 2, 1.2, 0.8, 0.4, 18., 0.,   0.,   2000., false);
+  addRegion("2j-2400",  350., 350., 2, 1.2, 0.8, 0.4, 18., 0.,   0.,   2400., false);
+  addRegion("2j-2800",  350., 350., 2, 1.2, 0.8, 0.4, 18., 0.,   0.,   2800., false);
+  addRegion("2j-3600",  350., 350., 2, 5.0, 0.8, 0.4, 18., 0.,   0.,   3600., false);
+  addRegion("2j-2100",  600., 50.,  2, 5.0, 0.4, 0.2, 26., 0.,   0.,   2100., false);
+  addRegion("3j-1300",  700., 50.,  3, 5.0, 0.4, 0.2, 16., 0.,   0.,   1300., false);
+  addRegion("4j-1000",  200., 100., 4, 1.2, 0.4, 0.4, 0.,  0.04, 0.3,  1000., false);
+  addRegion("4j-1400",  200., 100., 4, 2.0, 0.4, 0.4, 0.,  0.04, 0.25, 1400., false);
+  addRegion("4j-1800",  200., 100., 4, 2.0, 0.4, 0.4, 0.,  0.04, 0.25, 1800., false);
+  addRegion("4j-2200",  200., 100., 4, 2.0, 0.4, 0.4, 0.,  0.04, 0.25, 2200., false);
+  addRegion("4j-2600",  200., 150., 4, 2.0, 0.4, 0.4, 0.,  0.04, 0.2,  2600., false);
+  addRegion("4j-3000",  200., 150., 4, 2.0, 0.4, 0.4, 0.,  0.04, 0.2,  3000., false);
+  addRegion("5j-1700",  700., 50.,  5, 5.0, 0.4, 0.2, 0.,  0.,   0.3,  1700., false);
+  addRegion("5j-1600",  200., 50.,  5, 5.0, 0.4, 0.2, 0.,  0.08, 0.15, 1600., false);
+  addRegion("5j-2000",  200., 50.,  5, 5.0, 0.4, 0.4, 15,  0.,   0.,   2000., false);
+  addRegion("5j-2600",  200., 50.,  5, 5.0, 0.8, 0.4, 18,  0.,   0.,   2600., false);
+  addRegion("6j-1200",  200., 50.,  6, 2.0, 0.4, 0.2, 0.,  0.,   0.25, 1200., false);
+  addRegion("6j-1800",  200., 100., 6, 2.0, 0.4, 0.2, 0.,  0.04, 0.2,  1800., false);
+  addRegion("6j-2200",  200., 100., 6, 5.0, 0.4, 0.2, 0.,  0.08, 0.2,  2200., false);
+  addRegion("6j-2600",  200., 100., 6, 5.0, 0.4, 0.2, 0.,  0.08, 0.15, 2600., false);
+  addRegion("2j-B1600", 25.,  25.,  2, 5.0, 0.6, 0.4, 20., 0.,   0.,   1600., true);
+  addRegion("2j-B2400", 25.,  25.,  2, 5.0, 0.6, 0.4, 20., 0.,   0.,   2400., true);
 }
 
 void Atlas_1712_02332::analyze() {
@@ -75,57 +126,39 @@ void Atlas_1712_02332::analyze() {
   
   countCutflowEvent("05_2j_pt>50");
  
-//                        PTj1  PTj2  Nj  Eta Phi1 Phi2 ET/HT Apl ET/meff Meff
-  if (Passes_Cuts(sigjets, 250., 250., 2, 0.8, 0.8, 0.4, 14., 0.,   0.,   1200., true, "2j-1200") ) countSignalEvent("2j-1200");
-  if (Passes_Cuts(sigjets, 300., 300., 2, 1.2, 0.8, 0.4, 18., 0.,   0.,   1600., true, "2j-1600") ) countSignalEvent("2j-1600");
-  if (Passes_Cuts(sigjets, 350., 350., 2, 1.2, 0.8, 0.4, 18., 0.,   0.,   2000., true, "2j-2000") ) countSignalEvent("2j-2000");
-  if (Passes_Cuts(sigjets, 350., 350., 2, 1.2, 0.8, 0.4, 18., 0.,   0.,   2400., true, "2j-2400") ) countSignalEvent("2j-2400");
-  if (Passes_Cuts(sigjets, 350., 350., 2, 1.2, 0.8, 0.4, 18., 0.,   0.,   2800., true, "2j-2800") ) countSignalEvent("2j-2800");  
-  if (Passes_Cuts(sigjets, 350., 350., 2, 5.0, 0.8, 0.4, 18., 0.,   0.,   3600., true, "2j-3600") ) countSignalEvent("2j-3600");
-  if (Passes_Cuts(sigjets, 600., 50.,  2, 5.0, 0.4, 0.2, 26., 0.,   0.,   2100., true, "2j-2100") ) countSignalEvent("2j-2100");  
-  if (Passes_Cuts(sigjets, 700., 50.,  3, 5.0, 0.4, 0.2, 16., 0.,   0.,   1300., true, "3j-1300") ) countSignalEvent("3j-1300");
-  if (Passes_Cuts(sigjets, 200., 100., 4, 1.2, 0.4, 0.4, 0.,  0.04, 0.3,  1000., true, "4j-1000") ) countSignalEvent("4j-1000");
-  if (Passes_Cuts(sigjets, 200., 100., 4, 2.0, 0.4, 0.4, 0.,  0.04, 0.25, 1400., true, "4j-1400") ) countSignalEvent("4j-1400");
-  if (Passes_Cuts(sigjets, 200., 100., 4, 2.0, 0.4, 0.4, 0.,  0.04, 0.25, 1800., true, "4j-1800") ) countSignalEvent("4j-1800");
-  if (Passes_Cuts(sigjets, 200., 100., 4, 2.0, 0.4, 0.4, 0.,  0.04, 0.25, 2200., true, "4j-2200") ) countSignalEvent("4j-2200");
-  if (Passes_Cuts(sigjets, 200., 150., 4, 2.0, 0.4, 0.4, 0.,  0.04, 0.2,  2600., true, "4j-2600") ) countSignalEvent("4j-2600");
-  if (Passes_Cuts(sigjets, 200., 150., 4, 2.0, 0.4, 0.4, 0.,  0.04, 0.2,  3000., true, "4j-3000") ) countSignalEvent("4j-3000");  
-  if (Passes_Cuts(sigjets, 700., 50.,  5, 5.0, 0.4, 0.2, 0.,  0.,   0.3,  1700., true, "5j-1700") ) countSignalEvent("5j-1700");
-  if (Passes_Cuts(sigjets, 200., 50.,  5, 5.0, 0.4, 0.2, 0.,  0.08, 0.15, 1600., true, "5j-1600") ) countSignalEvent("5j-1600");  
-  if (Passes_Cuts(sigjets, 200., 50.,  5, 5.0, 0.4, 0.4, 15,  0.,   0.,   2000., true, "5j-2000") ) countSignalEvent("5j-2000");
-  if (Passes_Cuts(sigjets, 200., 50.,  5, 5.0, 0.8, 0.4, 18,  0.,   0.,   2600., true, "5j-2600") ) countSignalEvent("5j-2600");
-  if (Passes_Cuts(sigjets, 200., 50.,  6, 2.0, 0.4, 0.2, 0.,  0.,   0.25, 1200., true, "6j-1200") ) countSignalEvent("6j-1200");  
-  if (Passes_Cuts(sigjets, 200., 100., 6, 2.0, 0.4, 0.2, 0.,  0.04, 0.2,  1800., true, "6j-1800") ) countSignalEvent("6j-1800");
-  if (Passes_Cuts(sigjets, 200., 100., 6, 5.0, 0.4, 0.2, 0.,  0.08, 0.2,  2200., true, "6j-2200") ) countSignalEvent("6j-2200");
-  if (Passes_Cuts(sigjets, 200., 100., 6, 5.0, 0.4, 0.2, 0.,  0.08, 0.15, 2600., true, "6j-2600") ) countSignalEvent("6j-2600");  
-  
-// boosted channels separately
-  std::vector<fastjet::PseudoJet> particles;
+  // every variable of the signal regions is evaluated once
+  regionGrid.setValue(varNJets, sigjets.size());
+  regionGrid.setValue(varDPhi1, dPhi(sigjets, 0));
+  regionGrid.setValue(varDPhi2, dPhi(sigjets, 1));
+  regionGrid.setValue(varPT1, sigjets[0]->PT);
+  double etaMax = 0.;
+  // values for more jets than there are would not be compared, as the multiplicity cut comes first
+  for (int n = 1; n <= maxJets && n <= sigjets.size(); n++) {
+    etaMax = std::max(etaMax, (double)fabs(sigjets[n-1]->Eta));
+    if (n < 2) continue;
+    regionGrid.setValue(varPTN[n], sigjets[n-1]->PT);
+    regionGrid.setValue(varEtaN[n], etaMax);
+    regionGrid.setValue(varMETMeffN[n], met/M_eff(sigjets, n));
+  }
+  regionGrid.setValue(varAplanarity, aplanarity(sigjets));
+  regionGrid.setValue(varMETHT, met/sqrt( HT(sigjets) ));
+  regionGrid.setValue(varMeff, M_eff(sigjets, 0));
+  
+// boosted channels additionally require two W-like large radius jets
+  std::vector<Jet*> particles;
   for ( int i = 0; i < sigjets.size() && sigjets[i]->PT > 25. ; i++ ) 
-    particles.push_back( fastjet::PseudoJet(sigjets[i]->P4().Px(), sigjets[i]->P4().Py(), sigjets[i]->P4().Pz(), sigjets[i]->P4().E()) );
+    particles.push_back(sigjets[i]);
 
-
-  fastjet::JetDefinition jet_def(fastjet::antikt_algorithm, 1.0);
- 
-  fastjet::ClusterSequence cs(particles, jet_def);
-  std::vector<fastjet::PseudoJet> largeRJets = sorted_by_pt(cs.inclusive_jets());
-  std::vector<fastjet::PseudoJet> largeRJets_trimmed;
- 
   double Rfilt = 0.4;
-  fastjet::Selector selector_trimmer = fastjet::SelectorPtFractionMin(0.05);
-  fastjet::Filter trimmer(Rfilt, selector_trimmer);
-  for(int i=0; i<largeRJets.size(); i++) {
-    fastjet::PseudoJet trimmed_jet = trimmer(largeRJets[i]);
-    largeRJets_trimmed.push_back(trimmed_jet);
-  }    
+  const std::vector<fastjet::PseudoJet>& largeRJets_trimmed = reclusteredJets(particles, fastjet::antikt_algorithm, 1.0, Rfilt, 0.05);
   
-  if ( largeRJets_trimmed.size() < 2 or largeRJets_trimmed[1].pt() < 200. ) return;
-  countCutflowEvent("2j-B0000_00_2LRjets");
-  if ( fabs(largeRJets_trimmed[0].m() - 85.) > 25. or fabs(largeRJets_trimmed[1].m() - 85.) > 25. ) return; 
-  countCutflowEvent("2j-B0000_01_LRjets_mass");
+  bool boosted = !( largeRJets_trimmed.size() < 2 or largeRJets_trimmed[1].pt() < 200. );
+  if (boosted) countCutflowEvent("2j-B0000_00_2LRjets");
+  boosted = boosted and !( fabs(largeRJets_trimmed[0].m() - 85.) > 25. or fabs(largeRJets_trimmed[1].m() - 85.) > 25. ); 
+  if (boosted) countCutflowEvent("2j-B0000_01_LRjets_mass");
+  regionGrid.setValue(varBoosted, boosted ? 1. : 0.);
   
-  if (Passes_Cuts(sigjets, 25., 25., 2, 5.0, 0.6, 0.4, 20., 0.,   0.,   1600., true, "2j-B1600") ) countSignalEvent("2j-B1600");
-  if (Passes_Cuts(sigjets, 25., 25., 2, 5.0, 0.6, 0.4, 20., 0.,   0.,   2400., true, "2j-B2400") ) countSignalEvent("2j-B2400");
+  countSignalRegions(regionGrid);
   
   return;  
   
@@ -294,37 +327,18 @@ double Atlas_1712_02332::HT(std::vector<Jet*> jets) {
   return PTSum;
 }
     
-bool Atlas_1712_02332::Passes_Cuts(std::vector<Jet*> jets, double PT1Cut, double PT2Cut, int NJet, double EtaCut, double dPhiCut1, double dPhiCut2, double METHTCut, double AplanarityCut, double METMeffCut, double MeffCut, bool cutflow, std::string sr) {
-  
-  if ( jets.size() < NJet ) return false;
-  if (cutflow) countCutflowEvent(sr+"_06_jetmulti");  
-  
-  if( dPhi(jets, 0) < dPhiCut1 ) return false;
-  if (cutflow) countCutflowEvent(sr+"_07_dPhilow");  
-  
-  if( dPhi(jets, 1) < dPhiCut2 ) return false;
-  if (cutflow) countCutflowEvent(sr+"_08_dPhihigh");    
-  
-  if ( jets[0]->PT < PT1Cut || jets[NJet-1]->PT < PT2Cut ) return false;
-  
-  if (cutflow) countCutflowEvent(sr+"_09_PTjets");
-  
-  for (int i = 0; i < NJet; i++)
-    if ( fabs(jets[i]->Eta) > EtaCut ) return false;
-    
-  if (cutflow) countCutflowEvent(sr+"_10_Etajets");  
-  
-//  if ( !Aplanarity_Cut(jets, AplanarityCut) ) return false;
-  if ( AplanarityCut > 0. and  aplanarity(jets) < AplanarityCut ) return false;
-  if (cutflow) countCutflowEvent(sr+"_11_aplanarity");  
-  
-  if( missingET->P4().Et()/M_eff(jets, NJet) < METMeffCut) return false;
-  if( missingET->P4().Et()/sqrt( HT(jets) ) < METHTCut ) return false;
-  
-  if (cutflow) countCutflowEvent(sr+"_12_METrelative");  
-  
-  if( M_eff(jets, 0) < MeffCut) return false;
-  if (cutflow) countCutflowEvent(sr+"_13_Meff");  
-  
-  return true;
-}
\ No newline at end of file
+void Atlas_1712_02332::addRegion(std::string sr, double PT1Cut, double PT2Cut, int NJet, double EtaCut, double dPhiCut1, double dPhiCut2, double METHTCut, double AplanarityCut, double METMeffCut, double MeffCut, bool boosted) {
+  
+  int r = regionGrid.addRegion(sr);
+  if (boosted) regionGrid.setThreshold(r, varBoosted, 1.);
+  regionGrid.setThreshold(r, varNJets, NJet);
+  regionGrid.setThreshold(r, varDPhi1, dPhiCut1);
+  regionGrid.setThreshold(r, varDPhi2, dPhiCut2);
+  regionGrid.setThreshold(r, varPT1, PT1Cut);
+  regionGrid.setThreshold(r, varPTN[NJet], PT2Cut);
+  regionGrid.setThreshold(r, varEtaN[NJet], EtaCut);
+  if ( AplanarityCut > 0. ) regionGrid.setThreshold(r, varAplanarity, AplanarityCut);
+  regionGrid.setThreshold(r, varMETMeffN[NJet], METMeffCut);
+  regionGrid.setThreshold(r, varMETHT, METHTCut);
+  regionGrid.setThreshold(r, varMeff, MeffCut);
+}
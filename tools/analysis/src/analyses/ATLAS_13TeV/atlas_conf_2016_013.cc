@@ -461,17 +461,10 @@ static fastjet::PseudoJet trim_jet(fastjet::PseudoJet jet, double fcut, double l
     return trimmed;
 }
 
-// Perform jet reclustering as defined in
-// B. Nachman et al., Jets from Jets: Re-clustering as a tool for large radius jet reconstruction and
-// grooming at the LHC, JHEP 02 (2015) 075, arXiv: 1407.2922 [hep-ph].
-static std::vector<fastjet::PseudoJet> recluster_jets(std::vector<Jet*> jets, double R, double fcut) {
-    std::vector<fastjet::PseudoJet> pjets = convertJets(jets);
-    fastjet::JetDefinition jet_def(fastjet::antikt_algorithm, R);
-    fastjet::ClusterSequence cs(pjets, jet_def);
-    std::vector<fastjet::PseudoJet> largeJets = fastjet::sorted_by_pt(cs.inclusive_jets());
-
+// Trims the reclustered jets, see trim_jet()
+static std::vector<fastjet::PseudoJet> trim_jets(const std::vector<fastjet::PseudoJet>& largeJets, double fcut) {
     std::vector<fastjet::PseudoJet> trimmedJets;
-    for (std::vector<fastjet::PseudoJet>::iterator it = largeJets.begin(); it!=largeJets.end(); it++) {
+    for (std::vector<fastjet::PseudoJet>::const_iterator it = largeJets.begin(); it!=largeJets.end(); it++) {
         trimmedJets.push_back(trim_jet(*it, fcut, it->pt()));
     }
 //    // ask for more than 1 subjet
@@ -482,7 +475,10 @@ static std::vector<fastjet::PseudoJet> recluster_jets(std::vector<Jet*> jets, do
 }
 
 void Atlas_conf_2016_013::recluster_top_jets() {
-    std::vector<fastjet::PseudoJet> reclustered_jets = recluster_jets(jets, 1.0, 0.05);
+    // Perform jet reclustering as defined in
+    // B. Nachman et al., Jets from Jets: Re-clustering as a tool for large radius jet reconstruction and
+    // grooming at the LHC, JHEP 02 (2015) 075, arXiv: 1407.2922 [hep-ph].
+    std::vector<fastjet::PseudoJet> reclustered_jets = trim_jets(reclusteredJets(convertJets(jets), fastjet::antikt_algorithm, 1.0), 0.05);
     masstagged=0;
 //    masslargeRjet=0;
     for (std::vector<fastjet::PseudoJet>::iterator it=reclustered_jets.begin(); it!=reclustered_jets.end(); it++) {
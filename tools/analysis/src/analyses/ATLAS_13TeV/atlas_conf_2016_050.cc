@@ -271,29 +271,8 @@ void Atlas_conf_2016_050::analyze() {
   //ref: atlas_1308_1841.cc
   //     fastjet.fr/repo/fastjet-doc-3.2.1.pdf
   //     iopscience.iop.org/article/10.1088/0954-3899/39/6/063001
-  std::vector<fastjet::PseudoJet> particles;
-  for ( int i = 0; i < signalJets.size(); i++ ) {
-    double tmppx = signalJets[i]->P4().Px();
-    double tmppy = signalJets[i]->P4().Py();
-    double tmppz = signalJets[i]->P4().Pz();
-    double tmpe  = signalJets[i]->P4().E();
-    particles.push_back( fastjet::PseudoJet(tmppx, tmppy, tmppz, tmpe) );
-  }
-
-  fastjet::JetDefinition jet_def(fastjet::antikt_algorithm, 1.0);
-  //fastjet::JetDefinition jet_def(fastjet::antikt_algorithm, 1.2);
- 
-  fastjet::ClusterSequence cs(particles, jet_def);
-  std::vector<fastjet::PseudoJet> largeRJets = sorted_by_pt(cs.inclusive_jets());
-  std::vector<fastjet::PseudoJet> largeRJets_trimmed;
- 
   double Rfilt = 0.3;
-  fastjet::Selector selector_trimmer = fastjet::SelectorPtFractionMin(0.05);
-  fastjet::Filter trimmer(Rfilt, selector_trimmer);
-  for(int i=0; i<largeRJets.size(); i++) {
-    fastjet::PseudoJet trimmed_jet = trimmer(largeRJets[i]);
-    largeRJets_trimmed.push_back(trimmed_jet);
-  }
+  const std::vector<fastjet::PseudoJet>& largeRJets_trimmed = reclusteredJets(signalJets, fastjet::antikt_algorithm, 1.0, Rfilt, 0.05);
 
 /*    //mass of large radius jet in this analysis
   double LRJET_PT = 0., LRJET_M = 0.;
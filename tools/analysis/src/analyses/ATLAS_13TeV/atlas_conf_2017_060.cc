@@ -17,7 +17,10 @@ void Atlas_conf_2017_060::initialize() {
   // You can also book cutflow regions with bookCutflowRegions("CR1;CR2;..."). Note that the regions are
   //  always ordered alphabetically in the cutflow output files.
 
-  // You should initialize any declared variables here
+  // all regions need a jet above 20 GeV after the overlap removal, the
+  //  missing ET cut can not be used as muons are only added in analyze()
+  declareRecoBounds(0., 1, 20., 0.);
+  declareAllEventsCutflow("0_nocuts");
 }
 
 void Atlas_conf_2017_060::analyze() {
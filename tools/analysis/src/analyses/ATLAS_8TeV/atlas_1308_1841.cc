@@ -202,20 +202,7 @@ void Atlas_1308_1841::analyze() {
 
 //for multi-jet + M_J^Sigma steam
   //for composite jets
-  std::vector<fastjet::PseudoJet> particles;
-  for ( int i = 0; i < jets.size(); i++ ) {
-    double tmppx = jets[i]->P4().Px(); 
-    double tmppy = jets[i]->P4().Py(); 
-    double tmppz = jets[i]->P4().Pz(); 
-    double tmpe  = jets[i]->P4().E(); 
-    particles.push_back( fastjet::PseudoJet(tmppx, tmppy, tmppz, tmpe) );
-  }
-
-
-  fastjet::JetDefinition jet_def(fastjet::antikt_algorithm, 1.0);
-
-  fastjet::ClusterSequence cs(particles, jet_def);
-  std::vector<fastjet::PseudoJet> compjets = sorted_by_pt(cs.inclusive_jets());
+  const std::vector<fastjet::PseudoJet>& compjets = reclusteredJets(jets, fastjet::antikt_algorithm, 1.0);
 
   //std::vector<Jet*> compjets = birthCompJets(jets, 1.);
   double MJS = 0.;
@@ -222,37 +222,13 @@ void Atlas_conf_2013_089_CR::analyze() {
           finalStateObj.push_back(muonsCombinedIso[e]->P4());
     }   
     TLorentzVector j1, j2;
-    bool foundGood = false;
-    int N_comb = 1;
-    for(int i = 0; i < finalStateObj.size(); i++){
-        N_comb *= 2;
-    }
+    // the two megajets of smallest sum of squared masses
+    TLorentzVector j_temp1, j_temp2;
     double M_min = 9999999999.0;
-    int j_count;
-    for(int i = 1; i < N_comb-1; i++){
-        TLorentzVector j_temp1, j_temp2;
-        int itemp = i;
-        j_count = N_comb/2;
-        int count = 0;
-        while (j_count > 0) {
-            if (itemp/j_count == 1) {
-            j_temp1 += finalStateObj[count];
-            } 
-            else {
-              j_temp2 += finalStateObj[count];
-            }
-           itemp -= j_count*(itemp/j_count);
-          j_count /= 2;
-          count++;
-        }
-        double M_temp = j_temp1.M2()+j_temp2.M2();
-        // smallest mass
-        if (M_temp < M_min) {
-            M_min = M_temp;
-            j1 = j_temp1;
-            j2 = j_temp2;
-        }
-    }  
+    if (hemisphere_partition::min_mass_split(finalStateObj, j_temp1, j_temp2) < M_min) {
+        j1 = j_temp1;
+        j2 = j_temp2;
+    }
     if (j2.Pt() > j1.Pt()) {
         TLorentzVector temp = j1;
         j1 = j2;
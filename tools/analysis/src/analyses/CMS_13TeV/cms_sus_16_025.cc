@@ -14,16 +14,13 @@ void Cms_sus_16_025::initialize() {
 
   bookSignalRegions("SR1_weakino_1low_mll_1;SR1_weakino_1low_mll_2;SR1_weakino_1low_mll_3;SR1_weakino_1low_mll_4;SR1_weakino_2high_mll_1;SR1_weakino_2high_mll_2;SR1_weakino_2high_mll_3;SR1_weakino_2high_mll_4;SR2_stop_1low_pt_1;SR2_stop_1low_pt_2;SR2_stop_1low_pt_3;SR2_stop_2high_pt_1;SR2_stop_2high_pt_2;SR2_stop_2high_pt_3");
 
-  fout1.open("log");
+  logFile = bookFile(getAnalysisName()+"_log.txt", true);
 
-  h1 = new TH1F("h1", "mll", 100, 0, 100);
-  h2 = new TH1F("h2", "leading lepton pt", 100, 0, 100);
-  h3 = new TH1F("h3", "ht", 100, 0, 500);
-  h4 = new TH1F("h4", "misset", 100, 0, 500);
-  h5 = new TH1F("h5", "mll_met>200", 100, 0, 100);
-
-  f1 = new TFile("log.root", "RECREATE");
-  //f1 = new TFile("bin/log.root", "UPDATE");
+  h1 = bookHistogram("mll", 100, 0, 100);
+  h2 = bookHistogram("leading_lepton_pt", 100, 0, 100);
+  h3 = bookHistogram("ht", 100, 0, 500);
+  h4 = bookHistogram("missET", 100, 0, 500);
+  h5 = bookHistogram("mll_met200", 100, 0, 100);
   
   i1 = i2 = i3 = i4 = 0;
   
@@ -85,9 +82,9 @@ void Cms_sus_16_025::analyze() {
 
   double mET = missingET->PT;
   
-  h4->Fill(mET);
-  fout1 << "muon.size()=" << muons.size() << std::endl;
-  fout1 << mET << ", " << mET_no_muon << std::endl;
+  fillHistogram(h4, mET);
+  *fStreams[logFile] << "muon.size()=" << muons.size() << "\n";
+  *fStreams[logFile] << mET << ", " << mET_no_muon << "\n";
   
   //reconstruction
   //muonsCombined could not be used in CMS
@@ -135,7 +132,7 @@ void Cms_sus_16_025::analyze() {
     ht += jets[i]->PT;
   }
 
-  h3->Fill(ht);
+  fillHistogram(h3, ht);
 /*  //trick for 10.1fb^-1 for low mET and 12.9fb^-1 for high mET regions
   double triggerRatio = (double) rand() / (double) (RAND_MAX + 1.);
   if(mET->PT<200) {
@@ -157,12 +154,12 @@ void Cms_sus_16_025::analyze() {
   //for two leptons at the trigger level
   if(leptons.size() < 2) return;
 
-  h2->Fill(leptons[0]->PT);
+  fillHistogram(h2, leptons[0]->PT);
 
   if(leptons[0]->PT < 3. or leptons[1]->PT < 3.) return;
 
   for(int i=0; i<2; i++) {
-    fout1 << leptons[i]->Type << std::endl;
+    *fStreams[logFile] << leptons[i]->Type << "\n";
   }
 
   //for two opposite-sign leptons 
@@ -217,7 +214,7 @@ void Cms_sus_16_025::analyze() {
   if (leptons.size() != 2) return;
   double mll = ( leptons[0]->P4()+leptons[1]->P4() ).M();
 
-  h1->Fill(mll);
+  fillHistogram(h1, mll);
 
   if ( mll > 50.) return;
 
@@ -296,7 +293,7 @@ void Cms_sus_16_025::analyze() {
       }
 
     } else {
-      h5->Fill(mll);
+      fillHistogram(h5, mll);
       if (mll < 10.) {
         countCutflowEvent("SR1_weakino_2high_mll_1");
         countSignalEvent("SR1_weakino_2high_mll_1");
@@ -347,26 +344,17 @@ void Cms_sus_16_025::analyze() {
 void Cms_sus_16_025::finalize() {
   // Whatever should be done after the run goes here
 
-    int n4 = h1->FindBin(4);
-  int n10 = h1->FindBin(10);
-  int n20 = h1->FindBin(20);
-  int n30 = h1->FindBin(30);
-  int n50 = h1->FindBin(50);
-  double NT0410 = h1->Integral(n4,n10);
-  double NT1020 = h1->Integral(n10,n20);
-  double NT2030 = h1->Integral(n20,n30);
-  double NT3050 = h1->Integral(n30,n50);
-
-  fout1 << "NT1, 2, 3, 4: " << NT0410 << ", "<< NT1020 << ", "<< NT2030 << ", "<< NT3050 << std::endl;
-
-  h1->Write();
-  h2->Write();
-  h3->Write();
-  h4->Write();
-  h5->Write();
-
-  f1->Write();
-
-  fout1.close();
+  const Histogram& mllHistogram = histogram(h1);
+  int n4 = mllHistogram.bin(4);
+  int n10 = mllHistogram.bin(10);
+  int n20 = mllHistogram.bin(20);
+  int n30 = mllHistogram.bin(30);
+  int n50 = mllHistogram.bin(50);
+  double NT0410 = mllHistogram.integral(n4,n10);
+  double NT1020 = mllHistogram.integral(n10,n20);
+  double NT2030 = mllHistogram.integral(n20,n30);
+  double NT3050 = mllHistogram.integral(n30,n50);
+
+  *fStreams[logFile] << "NT1, 2, 3, 4: " << NT0410 << ", "<< NT1020 << ", "<< NT2030 << ", "<< NT3050 << "\n";
   
 }       
@@ -88,13 +88,10 @@ void Cms_1303_2985::analyze() {
   // Now calculate alpha_T separately for each region, use code supplied by cms, tested against self-written code.
   // HT275 region
   cut325 = cutNorm = false;
-  std::vector<double> diff275( 1<<(jets275.size()-1) , 0. );
-  for (unsigned i=0; i < diff275.size(); i++) {
-    for (unsigned j=0; j < jets275.size(); j++) {
-      diff275[i] += jets275[j]->P4().Et() * ( 1 - 2 * (int(i>>j)&1) ) ;
-    }
-  }
-  double DHT275 = fabs( *min_element( diff275.begin(), diff275.end(), fabs_less() ) );
+  std::vector<double> ET275;
+  for (unsigned j=0; j < jets275.size(); j++)
+    ET275.push_back(jets275[j]->P4().Et());
+  double DHT275 = hemisphere_partition::min_signed_sum(ET275);
   alphaT275 = 0.5 * ( HT275 - DHT275 ) / sqrt( HT275*HT275 - mHT275*mHT275 );
   
  
@@ -102,13 +99,10 @@ void Cms_1303_2985::analyze() {
   // HT325 region
   if ( (HT325 > 300.0) && (jets325.size() > 1)) {  //use 300GeV because this is the trigger condition
     cut325 = true;
-    std::vector<double> diff325( 1<<(jets325.size()-1) , 0. );
-    for (unsigned i=0; i < diff325.size(); i++) {
-      for (unsigned j=0; j < jets325.size(); j++) {
-        diff325[i] += jets325[j]->P4().Et() * ( 1 - 2 * (int(i>>j)&1) ) ;
-      }
-    }
-    double DHT325 = fabs( *min_element( diff325.begin(), diff325.end(), fabs_less() ) );
+    std::vector<double> ET325;
+    for (unsigned j=0; j < jets325.size(); j++)
+      ET325.push_back(jets325[j]->P4().Et());
+    double DHT325 = hemisphere_partition::min_signed_sum(ET325);
     alphaT325 = 0.5 * ( HT325 - DHT325 ) / sqrt( HT325*HT325 - mHT325*mHT325 );
   }
   
@@ -116,13 +110,10 @@ void Cms_1303_2985::analyze() {
   // 'Normal' HT region
   if ( (HT > 350.0) && (jetsNorm.size() > 1)) {  //use 300GeV because this is the trigger condition
     cutNorm = true;
-    std::vector<double> diff( 1<<(jetsNorm.size()-1) , 0. );
-    for (unsigned i=0; i < diff.size(); i++) {
-      for (unsigned j=0; j < jetsNorm.size(); j++) {
-        diff[i] += jetsNorm[j]->P4().Et() * ( 1 - 2 * (int(i>>j)&1) ) ;
-      }
-    }
-    double DHT = fabs( *min_element( diff.begin(), diff.end(), fabs_less() ) );
+    std::vector<double> ETNorm;
+    for (unsigned j=0; j < jetsNorm.size(); j++)
+      ETNorm.push_back(jetsNorm[j]->P4().Et());
+    double DHT = hemisphere_partition::min_signed_sum(ETNorm);
     alphaT = 0.5 * ( HT - DHT ) / sqrt( HT*HT - mHTNorm*mHTNorm );
   }
   
@@ -1,5 +1,11 @@
 #include "AnalysisBase.h"
 
+// keys of whichTags, constructed once instead of in every call
+static const std::string keyElectronIsolation = "ElectronIsolation";
+static const std::string keyMuonIsolation = "MuonIsolation";
+static const std::string keyPhotonIsolation = "PhotonIsolation";
+static const std::string keyBJetTagging = "BJetTagging";
+
 AnalysisBase::AnalysisBase() {
     outputFolder = "";
     outputPrefix = "";
@@ -8,12 +14,24 @@ AnalysisBase::AnalysisBase() {
     nEvents = 0;
     sumOfWeights = 0;
     sumOfWeights2 = 0;
+    eventGroupDepth = 0;
+    truthMETMin = 0;
+    truthLeadingPTMin = 0;
+    truthHTMin = 0;
+    recoMETMin = 0;
+    recoNJetsMin = 0;
+    recoJetPTMin = 0;
+    recoHTMin = 0;
+    nInitialFiles = 0;
+    ownership = NULL;
+    reclustering = NULL;
     xsect = 0;
     xsecterr = 0;
     luminosity = 0;
     weight = 0;
     missingET = NULL;
     result = NULL;
+    nFinalStateObjects = 0;
 }
 
 AnalysisBase::~AnalysisBase() {
@@ -21,6 +39,13 @@ AnalysisBase::~AnalysisBase() {
         fStreams[i]->close();
         delete fStreams[i];
     }
+    for (int i = 0; i < finalStateObjects.size(); i++)
+        delete finalStateObjects[i];
+    delete missingET;
+    for (int i = 0; i < histograms.size(); i++)
+        delete histograms[i];
+    for (int i = 0; i < ntuples.size(); i++)
+        delete ntuples[i];
 }
 
 
@@ -52,45 +77,198 @@ void AnalysisBase::setup(std::map<std::string, std::vector<int> > whichTagsIn, s
 
     whichTags = whichTagsIn;
     initialize(); // specified by derived analysis classes
+    nInitialFiles = bookings.size();
 }
 
 void AnalysisBase::processEvent(int iEvent) {
-    sumOfWeights += weight;
-    sumOfWeights2 += weight*weight;
-    nEvents++;
+    countEvent();
     analyze(); // specified by derived analysis classes
     
-    // deletes pointers created by final state objects
-    for (int i = 0; i < finalStateObjects.size(); i++)
-      delete finalStateObjects[i];
-    finalStateObjects.clear(); 
+    // final state objects are overwritten in the next event instead of being deleted
+    nFinalStateObjects = 0;
+    topnessMinimiser.clear();
+    for (int g = 0; g < signalRegionGrids.size(); g++)
+        signalRegionGrids[g]->reset();
 }
 
-void AnalysisBase::finish() {
-    finalize(); // specified by derived analysis classes
-    if(!cutflowRegions.empty()) {
-      int cutflowOutput = bookFile(analysis+"_cutflow.dat");
-      *fStreams[cutflowOutput] << "Cut  Sum_W  Sum_W2  Acc  N_Norm\n";
-      for(std::map<std::string, double>::iterator cutflow_iter=cutflowRegions.begin(); cutflow_iter!=cutflowRegions.end(); ++cutflow_iter)
-        *fStreams[cutflowOutput] << cutflow_iter->first << "  " << cutflow_iter->second << "  " << cutflowRegions2[cutflow_iter->first] << "  " << cutflow_iter->second/sumOfWeights << "  " << normalize(cutflow_iter->second) << "\n";
+void AnalysisBase::bookSignalRegionGrid(SignalRegionGrid& grid) {
+    signalRegionGrids.push_back(&grid);
+}
+
+void AnalysisBase::countSignalRegions(SignalRegionGrid& grid) {
+    if (std::find(signalRegionGrids.begin(), signalRegionGrids.end(), &grid) == signalRegionGrids.end())
+        Global::abort("AnalysisHandler", "The signal region grid has to be booked in initialize() of "+analysis+"!");
+    grid.evaluate();
+    for (int r = 0; r < grid.nRegions(); r++) {
+        for (int s = 0; s < grid.stagesPassed(r); s++)
+            if (!grid.cutflowName(r, s).empty())
+                countCutflowEvent(grid.cutflowName(r, s));
+        if (grid.passed(r))
+            countSignalEvent(grid.regionName(r));
     }
-    if(!signalRegions.empty()) {
-      int signalOutput = bookFile(analysis+"_signal.dat");
-      *fStreams[signalOutput] << "SR  Sum_W  Sum_W2  Acc  N_Norm\n";
-      for(std::map<std::string, double>::iterator signal_iter=signalRegions.begin(); signal_iter!=signalRegions.end(); ++signal_iter)
-        *fStreams[signalOutput] << signal_iter->first << "  " << signal_iter->second << "  " << signalRegions2[signal_iter->first] << "  " << signal_iter->second/sumOfWeights << "  " << normalize(signal_iter->second) << "\n";
+}
+
+void AnalysisBase::countVetoedEvent() {
+    countEvent();
+    if (allEventsCutflow != "")
+        countCutflowEvent(allEventsCutflow);
+}
+
+void AnalysisBase::countEvent() {
+    sumOfWeights += weight;
+    countSquared(sumOfWeights2, weight);
+    if (!weights.empty())
+        countVariations(sumOfWeightsVariations, sumOfWeights2Variations);
+    if (eventGroupDepth == 0)
+        nEvents++;
+}
+
+double AnalysisBase::sensitiveRegionPrecision(double& r, double& rError) {
+    r = -1;
+    rError = 0;
+    if (nEvents == 0 || sumOfWeights <= 0 || signalRegions.empty())
+        return -1;
+    bool haveS95 = !s95Expected.empty();
+    std::string best = "";
+    double bestSensitivity = -1;
+    for (std::map<std::string, double>::iterator it = signalRegions.begin(); it != signalRegions.end(); ++it) {
+        double sensitivity = it->second;
+        if (haveS95) {
+            std::map<std::string, double>::iterator s95 = s95Expected.find(it->first);
+            if (s95 == s95Expected.end() || s95->second <= 0)
+                continue;
+            sensitivity /= s95->second;
+        }
+        if (best == "" || sensitivity > bestSensitivity) {
+            best = it->first;
+            bestSensitivity = sensitivity;
+        }
     }
-    if(!controlRegions.empty()) {
-      int controlOutput = bookFile(analysis+"_control.dat");
-      *fStreams[controlOutput] << "CR  Sum_W  Sum_W2  Acc  N_Norm\n";
-      for(std::map<std::string, double>::iterator control_iter=controlRegions.begin(); control_iter!=controlRegions.end(); ++control_iter)
-        *fStreams[controlOutput] << control_iter->first << "  " << control_iter->second << "  " << controlRegions2[control_iter->first] << "  " << control_iter->second/sumOfWeights << "  " << normalize(control_iter->second) << "\n";
+    if (best == "")
+        return -1;
+    double sumW = signalRegions[best];
+    double error = std::max(sqrt(signalRegions2[best]), sumOfWeights/nEvents);
+    if (haveS95 && s95Observed[best] > 0) {
+        r = normalize(sumW)/s95Observed[best];
+        rError = normalize(error)/s95Observed[best];
     }
+    return sumW > 0 ? error/sumW : -1;
+}
+
+void AnalysisBase::finish() {
+    finalize(); // specified by derived analysis classes
+    writeRegions(analysis+"_cutflow.dat", "Cut", cutflowRegions, cutflowRegions2, cutflowRegionsVariations, cutflowRegionsVariations2);
+    writeRegions(analysis+"_signal.dat", "SR", signalRegions, signalRegions2, signalRegionsVariations, signalRegionsVariations2);
+    writeRegions(analysis+"_control.dat", "CR", controlRegions, controlRegions2, controlRegionsVariations, controlRegionsVariations2);
+    for (int i = 0; i < histograms.size(); i++) {
+        int output = bookFile(analysis+"_"+histograms[i]->name()+".hist");
+        histograms[i]->write(*fStreams[output], normalize(1.0));
+    }
+    for (int i = 0; i < ntuples.size(); i++)
+        ntuples[i]->close(sumOfWeights, xsect*luminosity);
 
     for (int i = 0; i < fStreams.size(); i++)
         fStreams[i]->close();
 }
 
+// sets all sums of the given regions to zero
+static void resetRegions(std::map<std::string, double>& regions,
+                         std::map<std::string, double>& regions2,
+                         std::map<std::string, std::vector<double> >& variations,
+                         std::map<std::string, std::vector<double> >& variations2) {
+    for (std::map<std::string, double>::iterator it = regions.begin(); it != regions.end(); ++it)
+        it->second = regions2[it->first] = 0.0;
+    variations.clear();
+    variations2.clear();
+}
+
+void AnalysisBase::reset(std::string prefix) {
+    nEvents = 0;
+    sumOfWeights = 0;
+    sumOfWeights2 = 0;
+    sumOfWeightsVariations.clear();
+    sumOfWeights2Variations.clear();
+    weightNames.clear();
+    eventGroupDepth = 0;
+    eventGroupSums.clear();
+    resetRegions(signalRegions, signalRegions2, signalRegionsVariations, signalRegionsVariations2);
+    resetRegions(controlRegions, controlRegions2, controlRegionsVariations, controlRegionsVariations2);
+    resetRegions(cutflowRegions, cutflowRegions2, cutflowRegionsVariations, cutflowRegionsVariations2);
+
+    // files booked in initialize() keep their index in fStreams
+    for (int i = 0; i < fStreams.size(); i++) {
+        fStreams[i]->close();
+        delete fStreams[i];
+    }
+    fStreams.clear();
+    fNames.clear();
+    std::vector<std::pair<std::string, bool> > initialFiles(bookings.begin(), bookings.begin()+nInitialFiles);
+    bookings.clear();
+    outputPrefix = prefix;
+    for (int i = 0; i < initialFiles.size(); i++)
+        bookFile(initialFiles[i].first, initialFiles[i].second);
+
+    // histograms and ntuples keep their booking, the ntuples are opened for the new prefix
+    for (int i = 0; i < histograms.size(); i++)
+        histograms[i]->clear();
+    for (int i = 0; i < ntuples.size(); i++) {
+        delete ntuples[i];
+        ntuples[i] = openNtuple(i);
+    }
+}
+
+void AnalysisBase::countVariations(std::vector<double>& sumW, std::vector<double>& sumW2) {
+    if (sumW.size() < weights.size()) {
+        sumW.resize(weights.size(), 0.0);
+        sumW2.resize(weights.size(), 0.0);
+    }
+    for (int w = 0; w < weights.size(); w++) {
+        sumW[w] += weights[w];
+        countSquared(sumW2[w], weights[w]);
+    }
+}
+
+void AnalysisBase::startEventGroup() {
+    if (eventGroupDepth == 0)
+        nEvents++;
+    eventGroupDepth++;
+}
+
+void AnalysisBase::finishEventGroup() {
+    if (eventGroupDepth == 0)
+        return;
+    eventGroupDepth--;
+    if (eventGroupDepth > 0)
+        return;
+    for (std::map<double*, double>::iterator it = eventGroupSums.begin(); it != eventGroupSums.end(); ++it)
+        *(it->first) += it->second*it->second;
+    eventGroupSums.clear();
+}
+
+void AnalysisBase::writeRegions(std::string name,
+                                std::string firstColumn,
+                                std::map<std::string, double>& regions,
+                                std::map<std::string, double>& regions2,
+                                std::map<std::string, std::vector<double> >& variations,
+                                std::map<std::string, std::vector<double> >& variations2) {
+    if(regions.empty())
+      return;
+    int output = bookFile(name);
+    *fStreams[output] << firstColumn << "  Sum_W  Sum_W2  Acc  N_Norm";
+    // weight variations are appended such that the standard columns keep their position
+    for(int w = 0; w < weightNames.size(); w++)
+      *fStreams[output] << "  Sum_W_" << weightNames[w] << "  Sum_W2_" << weightNames[w];
+    *fStreams[output] << "\n";
+    for(std::map<std::string, double>::iterator iter=regions.begin(); iter!=regions.end(); ++iter) {
+      *fStreams[output] << iter->first << "  " << iter->second << "  " << regions2[iter->first] << "  " << iter->second/sumOfWeights << "  " << normalize(iter->second);
+      std::vector<double>& sumW = variations[iter->first];
+      std::vector<double>& sumW2 = variations2[iter->first];
+      for(int w = 0; w < weightNames.size(); w++)
+        *fStreams[output] << "  " << (w < sumW.size() ? sumW[w] : 0.0) << "  " << (w < sumW2.size() ? sumW2[w] : 0.0);
+      *fStreams[output] << "\n";
+    }
+}
+
 void AnalysisBase::bookSignalRegions(std::string listOfRegions) {
   std::string currKey = "";
   // Sum letter by letter and define map-key as soon as ; is reached
@@ -157,21 +335,63 @@ int AnalysisBase::bookFile(std::string name, bool noheader) {
       *file << "@MCEvents:        " << nEvents << "\n";
       *file << "@ SumOfWeights:   " << sumOfWeights << "\n";
       *file << "@ SumOfWeights2:  " << sumOfWeights2 << "\n";
-      *file << "@ NormEvents:     " << normalize(sumOfWeights) << "\n\n";
+      *file << "@ NormEvents:     " << normalize(sumOfWeights) << "\n";
+      for (int w = 0; w < weightNames.size() && w < sumOfWeightsVariations.size(); w++)
+        *file << "@ SumOfWeights_" << weightNames[w] << ":  " << sumOfWeightsVariations[w] << "\n";
+      *file << "\n";
     }
     fStreams.push_back(file);
     fNames.push_back(filename);
+    bookings.push_back(std::make_pair(name, noheader));
     // The returned number denotes the corresponding index for the fStreams vector
     return fStreams.size()-1;
 }
 
-std::vector<Photon*> AnalysisBase::filterIsolation(std::vector<Photon*> unfiltered, int relative_tag) {
+int AnalysisBase::bookHistogram(std::string name, int nBins, double low, double high) {
+    if (nEvents > 0)
+        Global::abort("AnalysisHandler", "Histogram "+name+" has to be booked in initialize() of "+analysis+"!");
+    histograms.push_back(new Histogram(name, nBins, low, high));
+    return histograms.size()-1;
+}
+
+int AnalysisBase::bookNtuple(std::string name, std::string listOfColumns) {
+    if (nEvents > 0)
+        Global::abort("AnalysisHandler", "Ntuple "+name+" has to be booked in initialize() of "+analysis+"!");
+    std::vector<std::string> columns;
+    std::string currKey = "";
+    // Sum letter by letter and define a column as soon as ; is reached
+    for (int i = 0; i < listOfColumns.size(); i++) {
+        char c = listOfColumns[i];
+        if (c == ';') {
+            columns.push_back(currKey);
+            currKey = "";
+        }
+        else
+            currKey += c;
+    }
+    // The last column might not be separated by ;
+    if (currKey != "")
+        columns.push_back(currKey);
+    ntupleNames.push_back(name);
+    ntupleColumns.push_back(columns);
+    ntuples.push_back(NULL);
+    ntuples.back() = openNtuple(ntuples.size()-1);
+    return ntuples.size()-1;
+}
+
+NtupleWriter* AnalysisBase::openNtuple(int id) {
+    std::string filename = outputFolder+"/"+outputPrefix+"_"+analysis+"_"+ntupleNames[id]+".ntuple";
+    return new NtupleWriter(filename, ntupleColumns[id]);
+}
+
+std::vector<Photon*> AnalysisBase::filterIsolation(const std::vector<Photon*>& unfiltered, int relative_tag) {
     if(relative_tag < 0)
         Global::abort("AnalysisHandler", "You cannot ask for a photon isolation tag with index smaller than 0! ("+analysis+")");
-    std::vector<int> analysisSpecificFlags = whichTags["PhotonIsolation"];
+    const std::vector<int>& analysisSpecificFlags = whichTags[keyPhotonIsolation];
     if (relative_tag+2 > analysisSpecificFlags.size())
         Global::abort("AnalysisHandler", "You cannot ask for a photon isolation tag with index larger than "+Global::intToStr((int)analysisSpecificFlags.size()-2)+" in "+analysis);
     std::vector<Photon*> isolatedPhotons;
+    isolatedPhotons.reserve(unfiltered.size());
     for (int p = 0; p < unfiltered.size(); p++) {
         if (photonIsolationTags[unfiltered[p]][analysisSpecificFlags[relative_tag+1]]) // note that the 0th condition is reserved for the internal superloose condition
             isolatedPhotons.push_back(unfiltered[p]);
@@ -179,26 +399,27 @@ std::vector<Photon*> AnalysisBase::filterIsolation(std::vector<Photon*> unfilter
     return isolatedPhotons;
 }
 
-std::vector<Photon*> AnalysisBase::filterIsolation(std::vector<Photon*> unfiltered, std::vector<int> relative_tags) {
+std::vector<Photon*> AnalysisBase::filterIsolation(const std::vector<Photon*>& unfiltered, const std::vector<int>& relative_tags) {
     std::vector<Photon*> isolatedPhotons = unfiltered;
     // run filterIsolation on all reltags in the vector
     for(int t = 0; t < relative_tags.size(); t++)
         isolatedPhotons = filterIsolation(isolatedPhotons, relative_tags[t]);
     // If no flags are given then all should be checked
     if (relative_tags.size() == 0) {
-        for(int reltag = 0; reltag+2 <= whichTags["PhotonIsolation"].size(); reltag++)
+        for(int reltag = 0; reltag+2 <= whichTags[keyPhotonIsolation].size(); reltag++)
             isolatedPhotons = filterIsolation(isolatedPhotons, reltag);
     }
     return isolatedPhotons;
 }
 
-std::vector<Muon*> AnalysisBase::filterIsolation(std::vector<Muon*> unfiltered, int relative_tag) {
+std::vector<Muon*> AnalysisBase::filterIsolation(const std::vector<Muon*>& unfiltered, int relative_tag) {
     if(relative_tag < 0)
         Global::abort("AnalysisHandler", "You cannot ask for a muon isolation tag with index than 0! ("+analysis+")");
-    std::vector<int> analysisSpecificFlags = whichTags["MuonIsolation"];
+    const std::vector<int>& analysisSpecificFlags = whichTags[keyMuonIsolation];
     if (relative_tag+2 > analysisSpecificFlags.size())
         Global::abort("AnalysisHandler", "You cannot ask for a muon isolation tag with index larger than "+Global::intToStr((int)analysisSpecificFlags.size()-2)+" in "+analysis);
     std::vector<Muon*> isolatedMuons;
+    isolatedMuons.reserve(unfiltered.size());
     for (int p = 0; p < unfiltered.size(); p++) {
         if (muonIsolationTags[unfiltered[p]][analysisSpecificFlags[relative_tag+1]]) // note that the 0th condition is reserved for the internal superloose condition
             isolatedMuons.push_back(unfiltered[p]);
@@ -206,26 +427,27 @@ std::vector<Muon*> AnalysisBase::filterIsolation(std::vector<Muon*> unfiltered,
     return isolatedMuons;
 }
 
-std::vector<Muon*> AnalysisBase::filterIsolation(std::vector<Muon*> unfiltered, std::vector<int> relative_tags) {
+std::vector<Muon*> AnalysisBase::filterIsolation(const std::vector<Muon*>& unfiltered, const std::vector<int>& relative_tags) {
     std::vector<Muon*> isolatedMuons = unfiltered;
     // run filterIsolation on all reltags in the vector
     for(int t = 0; t < relative_tags.size(); t++)
         isolatedMuons = filterIsolation(isolatedMuons, relative_tags[t]);
     // If no flags are given then all should be checked
     if (relative_tags.size() == 0) {
-        for(int reltag = 0; reltag+2 <= whichTags["MuonIsolation"].size(); reltag++)
+        for(int reltag = 0; reltag+2 <= whichTags[keyMuonIsolation].size(); reltag++)
             isolatedMuons = filterIsolation(isolatedMuons, reltag);
     }
     return isolatedMuons;
 }
 
-std::vector<Electron*> AnalysisBase::filterIsolation(std::vector<Electron*> unfiltered, int relative_tag) {
+std::vector<Electron*> AnalysisBase::filterIsolation(const std::vector<Electron*>& unfiltered, int relative_tag) {
     if(relative_tag < 0)
         Global::abort("AnalysisHandler", "You cannot ask for an electron isolation tag with index smaller than 0! ("+analysis+")");
-    std::vector<int> analysisSpecificFlags = whichTags["ElectronIsolation"];
+    const std::vector<int>& analysisSpecificFlags = whichTags[keyElectronIsolation];
     if (relative_tag+2 > analysisSpecificFlags.size())
         Global::abort("AnalysisHandler", "You cannot ask for an electron isolation tag with index larger than "+Global::intToStr((int)analysisSpecificFlags.size()-2)+" in "+analysis);
     std::vector<Electron*> isolatedElectrons;
+    isolatedElectrons.reserve(unfiltered.size());
     for (int p = 0; p < unfiltered.size(); p++) {
         if (electronIsolationTags[unfiltered[p]][analysisSpecificFlags[relative_tag+1]]) // note that the 0th condition is reserved for the internal superloose condition
             isolatedElectrons.push_back(unfiltered[p]);
@@ -233,14 +455,14 @@ std::vector<Electron*> AnalysisBase::filterIsolation(std::vector<Electron*> unfi
     return isolatedElectrons;
 }
 
-std::vector<Electron*> AnalysisBase::filterIsolation(std::vector<Electron*> unfiltered, std::vector<int> relative_tags) {
+std::vector<Electron*> AnalysisBase::filterIsolation(const std::vector<Electron*>& unfiltered, const std::vector<int>& relative_tags) {
     std::vector<Electron*> isolatedElectrons = unfiltered;
     // run filterIsolation on all reltags in the vector
     for(int t = 0; t < relative_tags.size(); t++)
         isolatedElectrons = filterIsolation(isolatedElectrons, relative_tags[t]);
     // If no flags are given then all should be checked
     if (relative_tags.size() == 0) {
-        for(int reltag = 0; reltag+2 <= whichTags["ElectronIsolation"].size(); reltag++)
+        for(int reltag = 0; reltag+2 <= whichTags[keyElectronIsolation].size(); reltag++)
             isolatedElectrons = filterIsolation(isolatedElectrons, reltag);
     }
     return isolatedElectrons;
@@ -259,7 +481,7 @@ bool AnalysisBase::checkTauTag(Jet* candidate, std::string efficiency) {
 bool AnalysisBase::checkBTag(Jet* candidate, int relative_tag) {
     if(relative_tag < 0)
         Global::abort("AnalysisHandler", "You cannot ask for a btag with index smaller than 0! ("+analysis+")");
-    std::vector<int> analysisSpecificFlags = whichTags["BJetTagging"];
+    const std::vector<int>& analysisSpecificFlags = whichTags[keyBJetTagging];
     if (relative_tag+1 > analysisSpecificFlags.size())
         Global::abort("AnalysisHandler", "You cannot ask for a btag with index larger than "+Global::intToStr((int)analysisSpecificFlags.size()-1)+" in "+analysis);
     return (jetBTags.find(candidate)->second)[analysisSpecificFlags[relative_tag]];
@@ -392,14 +614,12 @@ double AnalysisBase::alphaT(const std::vector<Jet*> & jets, const double thresh_
       }
     }
     double mHT = vecHT.Pt();
-   
-    std::vector<double> diff( 1<<(jetsThresh.size()-1) , 0. );
-    for (unsigned i=0; i < diff.size(); i++) {
-      for (unsigned j=0; j < jetsThresh.size(); j++) {
-        diff[i] += jetsThresh[j]->P4().Et() * ( 1 - 2 * (int(i>>j)&1) ) ;
-      }
-    }
-    double DHT = fabs( *min_element( diff.begin(), diff.end(), fabs_less() ) );
+
+    // smallest ET difference of two pseudo jets
+    std::vector<double> ETs;
+    for (int j = 0; j < jetsThresh.size(); j++)
+      ETs.push_back(jetsThresh[j]->P4().Et());
+    double DHT = hemisphere_partition::min_signed_sum(ETs);
     double alphaT = 0.5 * ( HT - DHT ) / sqrt( HT*HT - mHT*mHT );
    
     return alphaT;
@@ -411,35 +631,13 @@ std::vector<double> AnalysisBase::razor(const std::vector<TLorentzVector> & fina
     // Result is a 2 dimensional vector, [0] = MR, [1] = R
 
     TLorentzVector j1, j2;
-    bool foundGood = false;
-    int N_comb = 1;
-    for(int i = 0; i < finalStateObj.size(); i++)
-      N_comb *= 2;
- 
+    // the two megajets of smallest sum of squared masses
+    TLorentzVector j_temp1, j_temp2;
     double M_min = 9999999999.0;
-    int j_count;
-    for(int i = 1; i < N_comb-1; i++) {
-      TLorentzVector j_temp1, j_temp2;
-      int itemp = i;
-      j_count = N_comb/2;
-      int count = 0;
-      while(j_count > 0){
-        if(itemp/j_count == 1)
-          j_temp1 += finalStateObj[count];
-        else
-          j_temp2 += finalStateObj[count];
-        itemp -= j_count*(itemp/j_count);
-        j_count /= 2;
-        count++;
-      }
-      double M_temp = j_temp1.M2()+j_temp2.M2();
-      // smallest mass
-      if (M_temp < M_min) {
-        M_min = M_temp;
-        j1 = j_temp1;
-        j2 = j_temp2;
-      }
-    }  
+    if (hemisphere_partition::min_mass_split(finalStateObj, j_temp1, j_temp2) < M_min) {
+      j1 = j_temp1;
+      j2 = j_temp2;
+    }
     if (j2.Pt() > j1.Pt()) {
       TLorentzVector temp = j1;
       j1 = j2;
@@ -485,11 +683,18 @@ double AnalysisBase::topness(const TLorentzVector & pl_in, const TLorentzVector
     double MET[4] = {invis.Px(), invis.Py(), 0.0, 0.0 };
   
     double xbest[4];
-    double topness = log(topnesscompute(pb1, pb2, pl, MET, sigmat, sigmaW, sigmas, xbest));      
+    double topness = log(topnessMinimiser.minimum(pb1, pb2, pl, MET, sigmat, sigmaW, sigmas, xbest));
     
     return topness;
 }
 
+std::vector<double> AnalysisBase::topness(const std::vector<topness_tuple>& tuples, const double & sigmat, const double & sigmaW, const double & sigmas) {
+    std::vector<double> topnesses = topnessMinimiser.minimum(tuples, sigmat, sigmaW, sigmas);
+    for (int i = 0; i < topnesses.size(); i++)
+        topnesses[i] = log(topnesses[i]);
+    return topnesses;
+}
+
 std::vector<double> AnalysisBase::superRazor(TLorentzVector l0, TLorentzVector l1, const TLorentzVector & met) {
   
     // ==========================================================================
@@ -587,22 +792,18 @@ std::vector<double> AnalysisBase::superRazor(TLorentzVector l0, TLorentzVector l
 }
 
 double AnalysisBase::aplanarity(const std::vector<Jet*> input_jets) {
-  
-  TMatrixD MomentumMatrix(3,3);
-  double PAbs=0.;
-  for (int i = 0; i < jets.size(); i++) PAbs+=jets[i]->P4().Vect().Mag2();
-
-  for (int i=0;i<3;i++) {
-    for(int j=0;j<3;j++) {
-      double PSum = 0.;
-      for(int k=0;k<jets.size();k++) PSum+=jets[k]->P4().Vect()[i]*jets[k]->P4().Vect()[j]/PAbs;
-      MomentumMatrix[i][j] = PSum;
+    return eventShapes(input_jets).aplanarity;
+}
+
+event_shapes::event_shape AnalysisBase::eventShapes(const std::vector<TLorentzVector>& objects) {
+    eventShapeMomenta.resize(3*objects.size());
+    for (int i = 0; i < objects.size(); i++) {
+        eventShapeMomenta[3*i] = objects[i].Px();
+        eventShapeMomenta[3*i+1] = objects[i].Py();
+        eventShapeMomenta[3*i+2] = objects[i].Pz();
     }
-  }
-  
-  TMatrixDEigen Eval(MomentumMatrix);
-  TVectorD Eigenval = Eval.GetEigenValuesRe();
-  return 1.5*Eigenval.Min();
-  
+    event_shapes::event_shape shape;
+    event_shapes::evaluate(objects.empty() ? NULL : &eventShapeMomenta[0], objects.size(), shape);
+    return shape;
 }
 
@@ -0,0 +1,55 @@
+#include "Histogram.h"
+
+#include <math.h>
+
+#include "Global.h"
+
+Histogram::Histogram(const std::string& name, int nBins, double low_, double high_) {
+    if (nBins < 1 || !(high_ > low_))
+        Global::abort("Histogram", "Histogram "+name+" needs at least one bin and an upper edge above the lower one!");
+    histogramName = name;
+    bins = nBins;
+    low = low_;
+    high = high_;
+    inverseWidth = nBins/(high_-low_);
+    sumsW.assign(nBins+2, 0.0);
+    sumsW2.assign(nBins+2, 0.0);
+}
+
+double Histogram::lowEdge(int bin) const {
+    if (bin <= 0)
+        return -HUGE_VAL;
+    if (bin > bins)
+        return high;
+    return low+(bin-1)*(high-low)/bins;
+}
+
+double Histogram::highEdge(int bin) const {
+    if (bin <= 0)
+        return low;
+    if (bin >= bins)
+        return bin == bins ? high : HUGE_VAL;
+    return low+bin*(high-low)/bins;
+}
+
+double Histogram::integral(int firstBin, int lastBin) const {
+    if (firstBin < 0)
+        firstBin = 0;
+    if (lastBin > bins+1)
+        lastBin = bins+1;
+    double sum = 0;
+    for (int b = firstBin; b <= lastBin; b++)
+        sum += sumsW[b];
+    return sum;
+}
+
+void Histogram::clear() {
+    for (int b = 0; b < sumsW.size(); b++)
+        sumsW[b] = sumsW2[b] = 0.0;
+}
+
+void Histogram::write(std::ostream& out, double normalisation) const {
+    out << "Low  High  Sum_W  Sum_W2  N_Norm\n";
+    for (int b = 0; b < sumsW.size(); b++)
+        out << lowEdge(b) << "  " << highEdge(b) << "  " << sumsW[b] << "  " << sumsW2[b] << "  " << sumsW[b]*normalisation << "\n";
+}
@@ -0,0 +1,66 @@
+#include "JetReclustering.h"
+
+#include "fastjet/tools/Filter.hh"
+
+// Up to this many inputs the plain N^2 clustering is the fastest for large
+//  radii, the choice FastJet's Best strategy makes as well
+static const int maxPlainInputs = 30;
+
+JetReclustering::JetReclustering() {
+}
+
+JetReclustering::~JetReclustering() {
+    clear();
+}
+
+void JetReclustering::clear() {
+    for (int r = 0; r < reclusterings.size(); r++) {
+        // the jets refer to the sequence and have to go first
+        reclusterings[r]->jets.clear();
+        delete reclusterings[r]->sequence;
+        delete reclusterings[r];
+    }
+    reclusterings.clear();
+}
+
+const std::vector<fastjet::PseudoJet>& JetReclustering::recluster(const std::vector<fastjet::PseudoJet>& inputs,
+                                                                   fastjet::JetAlgorithm algorithm,
+                                                                   double R,
+                                                                   double trimRadius,
+                                                                   double trimFraction) {
+    std::vector<double> signature;
+    signature.reserve(5*inputs.size());
+    for (int i = 0; i < inputs.size(); i++) {
+        signature.push_back(inputs[i].px());
+        signature.push_back(inputs[i].py());
+        signature.push_back(inputs[i].pz());
+        signature.push_back(inputs[i].E());
+        signature.push_back(inputs[i].user_index());
+    }
+    for (int r = 0; r < reclusterings.size(); r++) {
+        reclustering* known = reclusterings[r];
+        if (known->algorithm == algorithm && known->R == R && known->trimRadius == trimRadius &&
+            known->trimFraction == trimFraction && known->signature == signature)
+            return known->jets;
+    }
+
+    reclustering* result = new reclustering();
+    result->algorithm = algorithm;
+    result->R = R;
+    result->trimRadius = trimRadius;
+    result->trimFraction = trimFraction;
+    result->signature.swap(signature);
+    fastjet::Strategy strategy = (inputs.size() <= maxPlainInputs) ? fastjet::N2Plain : fastjet::Best;
+    fastjet::JetDefinition definition(algorithm, R, fastjet::E_scheme, strategy);
+    result->sequence = new fastjet::ClusterSequence(inputs, definition);
+    std::vector<fastjet::PseudoJet> jets = fastjet::sorted_by_pt(result->sequence->inclusive_jets());
+    if (trimRadius > 0.) {
+        fastjet::Filter trimmer(trimRadius, fastjet::SelectorPtFractionMin(trimFraction));
+        for (int j = 0; j < jets.size(); j++)
+            result->jets.push_back(trimmer(jets[j]));
+    } else {
+        result->jets.swap(jets);
+    }
+    reclusterings.push_back(result);
+    return result->jets;
+}
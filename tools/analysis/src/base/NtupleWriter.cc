@@ -0,0 +1,66 @@
+#include "NtupleWriter.h"
+
+#include "Global.h"
+
+static const char magic[8] = {'C', 'M', 'N', 'T', 'U', 'P', 'L', 'E'};
+static const int formatVersion = 1;
+// the totals follow the magic, version and number of columns
+static const std::streamoff totalsOffset = sizeof(magic)+2*sizeof(int);
+// rows are written in blocks of about this many values
+static const int bufferValues = 8192;
+
+NtupleWriter::NtupleWriter(const std::string& filename_, const std::vector<std::string>& columns) {
+    filename = filename_;
+    columnNames.push_back("weight");
+    columnNames.insert(columnNames.end(), columns.begin(), columns.end());
+    nRows = 0;
+    buffer.reserve(bufferValues+columnNames.size());
+
+    file.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        Global::abort("NtupleWriter", "Could not open "+filename+"!");
+    int n = columnNames.size();
+    double zero = 0;
+    file.write(magic, sizeof(magic));
+    file.write((const char*)&formatVersion, sizeof(int));
+    file.write((const char*)&n, sizeof(int));
+    file.write((const char*)&nRows, sizeof(long long));
+    file.write((const char*)&zero, sizeof(double));
+    file.write((const char*)&zero, sizeof(double));
+    for (int c = 0; c < columnNames.size(); c++)
+        file.write(columnNames[c].c_str(), columnNames[c].size()+1);
+}
+
+NtupleWriter::~NtupleWriter() {
+    if (file.is_open())
+        close(0, 0);
+}
+
+void NtupleWriter::fill(double weight, const std::vector<double>& values) {
+    if (values.size()+1 != columnNames.size())
+        Global::abort("NtupleWriter", "Row with "+Global::intToStr((int)values.size())+" values filled into "+filename+" with "+Global::intToStr((int)columnNames.size()-1)+" columns!");
+    buffer.push_back(weight);
+    buffer.insert(buffer.end(), values.begin(), values.end());
+    nRows++;
+    if (buffer.size() >= bufferValues)
+        flush();
+}
+
+void NtupleWriter::flush() {
+    if (!buffer.empty())
+        file.write((const char*)&buffer[0], buffer.size()*sizeof(double));
+    buffer.clear();
+}
+
+void NtupleWriter::close(double sumOfWeights, double normalisation) {
+    if (!file.is_open())
+        return;
+    flush();
+    file.seekp(totalsOffset);
+    file.write((const char*)&nRows, sizeof(long long));
+    file.write((const char*)&sumOfWeights, sizeof(double));
+    file.write((const char*)&normalisation, sizeof(double));
+    file.close();
+    if (file.fail())
+        Global::warn("NtupleWriter", "Writing "+filename+" failed!");
+}
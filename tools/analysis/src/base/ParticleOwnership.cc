@@ -0,0 +1,92 @@
+#include "ParticleOwnership.h"
+
+ParticleOwnership::ParticleOwnership() {
+    minKey = 0;
+}
+
+void ParticleOwnership::build(const std::vector<Track*>& tracks, const std::vector<Tower*>& towers) {
+    tracksBySlot.clear();
+    towerOffsets.clear();
+    towerList.clear();
+
+    // range of the object numbers of all referenced particles, 0 is an empty reference
+    UInt_t lo = 0, hi = 0;
+    for (int t = 0; t < tracks.size(); t++) {
+        UInt_t k = key(tracks[t]->Particle.GetUniqueID());
+        if (k == 0)
+            continue;
+        if (lo == 0 || k < lo)
+            lo = k;
+        if (k > hi)
+            hi = k;
+    }
+    for (int t = 0; t < towers.size(); t++) {
+        const TRefArray& particles = towers[t]->Particles;
+        for (int p = 0; p < particles.GetEntriesFast(); p++) {
+            UInt_t k = key(particles.GetUID(p));
+            if (k == 0)
+                continue;
+            if (lo == 0 || k < lo)
+                lo = k;
+            if (k > hi)
+                hi = k;
+        }
+    }
+    minKey = lo;
+    if (lo == 0)
+        return;
+    int size = hi-lo+1;
+
+    tracksBySlot.assign(size, (Track*)NULL);
+    for (int t = 0; t < tracks.size(); t++) {
+        UInt_t k = key(tracks[t]->Particle.GetUniqueID());
+        if (k != 0)
+            tracksBySlot[k-lo] = tracks[t];
+    }
+
+    // towers sorted by the slots of their particles
+    towerOffsets.assign(size+1, 0);
+    for (int t = 0; t < towers.size(); t++) {
+        const TRefArray& particles = towers[t]->Particles;
+        for (int p = 0; p < particles.GetEntriesFast(); p++) {
+            UInt_t k = key(particles.GetUID(p));
+            if (k != 0)
+                towerOffsets[k-lo+1]++;
+        }
+    }
+    for (int s = 0; s < size; s++)
+        towerOffsets[s+1] += towerOffsets[s];
+    towerList.resize(towerOffsets[size]);
+    std::vector<int> next(towerOffsets.begin(), towerOffsets.end()-1);
+    for (int t = 0; t < towers.size(); t++) {
+        const TRefArray& particles = towers[t]->Particles;
+        for (int p = 0; p < particles.GetEntriesFast(); p++) {
+            UInt_t k = key(particles.GetUID(p));
+            if (k != 0)
+                towerList[next[k-lo]++] = towers[t];
+        }
+    }
+}
+
+Track* ParticleOwnership::ownTrack(const TRef& particle) const {
+    int s = slot(particle.GetUniqueID());
+    if (s < 0)
+        return NULL;
+    return tracksBySlot[s];
+}
+
+void ParticleOwnership::addTowers(int s, std::vector<Tower*>& result) const {
+    if (s < 0)
+        return;
+    for (int i = towerOffsets[s]; i < towerOffsets[s+1]; i++)
+        result.push_back(towerList[i]);
+}
+
+void ParticleOwnership::addOwnTowers(const TRef& particle, std::vector<Tower*>& result) const {
+    addTowers(slot(particle.GetUniqueID()), result);
+}
+
+void ParticleOwnership::addOwnTowers(const TRefArray& particles, std::vector<Tower*>& result) const {
+    for (int p = 0; p < particles.GetEntriesFast(); p++)
+        addTowers(slot(particles.GetUID(p)), result);
+}
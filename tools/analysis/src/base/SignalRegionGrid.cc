@@ -0,0 +1,92 @@
+#include "SignalRegionGrid.h"
+
+#include <math.h>
+
+#include "Global.h"
+
+SignalRegionGrid::SignalRegionGrid() {
+}
+
+void SignalRegionGrid::addStage(const std::string& cutflowSuffix) {
+    if (!regionNames.empty())
+        Global::abort("SignalRegionGrid", "Stages have to be added before the first region!");
+    stageSuffixes.push_back(cutflowSuffix);
+    firstVariables.push_back(variableNames.size());
+}
+
+int SignalRegionGrid::addVariable(const std::string& name, bool upperBound) {
+    if (stageSuffixes.empty())
+        Global::abort("SignalRegionGrid", "Variable "+name+" has to be added to a stage!");
+    if (!regionNames.empty())
+        Global::abort("SignalRegionGrid", "Variable "+name+" has to be added before the first region!");
+    for (int v = 0; v < variableNames.size(); v++)
+        if (variableNames[v] == name)
+            Global::abort("SignalRegionGrid", "Variable "+name+" was added twice!");
+    variableNames.push_back(name);
+    upperBounds.push_back(upperBound);
+    thresholds.push_back(std::vector<double>());
+    values.push_back(upperBound ? HUGE_VAL : -HUGE_VAL);
+    return variableNames.size()-1;
+}
+
+int SignalRegionGrid::addRegion(const std::string& name) {
+    regionNames.push_back(name);
+    for (int s = 0; s < stageSuffixes.size(); s++)
+        cutflowNames.push_back(stageSuffixes[s].empty() ? std::string() : name+stageSuffixes[s]);
+    // a threshold at infinity never cuts
+    for (int v = 0; v < variableNames.size(); v++)
+        thresholds[v].push_back(upperBounds[v] ? HUGE_VAL : -HUGE_VAL);
+    alive.push_back(0);
+    passedStages.push_back(0);
+    return regionNames.size()-1;
+}
+
+void SignalRegionGrid::setThreshold(int region, int variable, double threshold) {
+    thresholds[variable][region] = threshold;
+}
+
+void SignalRegionGrid::setThreshold(int region, const std::string& name, double threshold) {
+    setThreshold(region, variable(name), threshold);
+}
+
+int SignalRegionGrid::variable(const std::string& name) const {
+    for (int v = 0; v < variableNames.size(); v++)
+        if (variableNames[v] == name)
+            return v;
+    Global::abort("SignalRegionGrid", "Unknown variable "+name+"!");
+    return -1;
+}
+
+void SignalRegionGrid::reset() {
+    // beyond every threshold, but not beyond the infinite ones of regions without a cut
+    for (int v = 0; v < values.size(); v++)
+        values[v] = upperBounds[v] ? HUGE_VAL : -HUGE_VAL;
+}
+
+void SignalRegionGrid::evaluate() {
+    const int n = regionNames.size();
+    if (n == 0)
+        return;
+    for (int r = 0; r < n; r++) {
+        alive[r] = 1;
+        passedStages[r] = 0;
+    }
+    for (int s = 0; s < stageSuffixes.size(); s++) {
+        int lastVariable = (s+1 < stageSuffixes.size()) ? firstVariables[s+1] : variableNames.size();
+        for (int v = firstVariables[s]; v < lastVariable; v++) {
+            // branch free, such that the comparison vectorises over the regions
+            const double value = values[v];
+            const double* threshold = &thresholds[v][0];
+            char* pass = &alive[0];
+            if (upperBounds[v]) {
+                for (int r = 0; r < n; r++)
+                    pass[r] &= !(value > threshold[r]);
+            } else {
+                for (int r = 0; r < n; r++)
+                    pass[r] &= !(value < threshold[r]);
+            }
+        }
+        for (int r = 0; r < n; r++)
+            passedStages[r] += alive[r];
+    }
+}
@@ -0,0 +1,293 @@
+#include "eventshapes/event_shapes.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace event_shapes
+{
+
+// number of hardest momenta whose directions seed the approximate thrust search
+static const int thrustSeeds = 4;
+static const int maxThrustIterations = 32;
+// squared sine of the angle below which a momentum counts as lying in a
+//  plane or along a direction
+static const double alignedTolerance = 1e-18;
+
+static inline double dot(const double* a, const double* b) {
+    return a[0]*b[0]+a[1]*b[1]+a[2]*b[2];
+}
+
+static inline void cross(const double* a, const double* b, double* c) {
+    c[0] = a[1]*b[2]-a[2]*b[1];
+    c[1] = a[2]*b[0]-a[0]*b[2];
+    c[2] = a[0]*b[1]-a[1]*b[0];
+}
+
+void symmetric_eigenvalues(const double tensor[6], double eigenvalues[3]) {
+    double xx = tensor[0], yy = tensor[1], zz = tensor[2];
+    double xy = tensor[3], xz = tensor[4], yz = tensor[5];
+    double q = (xx+yy+zz)/3;
+    double p2 = (xx-q)*(xx-q)+(yy-q)*(yy-q)+(zz-q)*(zz-q)+2*(xy*xy+xz*xz+yz*yz);
+    if (p2 <= 0.) {
+        eigenvalues[0] = eigenvalues[1] = eigenvalues[2] = q;
+        return;
+    }
+    // Cardano: det((tensor - q) / p) / 2 = cos(3 phi)
+    double p = sqrt(p2/6);
+    double a = (xx-q)/p, b = (yy-q)/p, c = (zz-q)/p;
+    double d = xy/p, e = xz/p, f = yz/p;
+    double r = (a*(b*c-f*f)-d*(d*c-f*e)+e*(d*f-b*e))/2;
+    r = std::max(-1., std::min(1., r));
+    double phi = acos(r)/3;
+
+    // Only the eigenvalue further away from the other two is accurate, the
+    //  other two are those of the tensor in the plane orthogonal to its
+    //  eigenvector, which is orthogonal to two rows of tensor - isolated.
+    double isolated = (r >= 0.) ? q+2*p*cos(phi) : q+2*p*cos(phi+2*M_PI/3);
+    double rows[3][3] = {{xx-isolated, xy, xz},
+                         {xy, yy-isolated, yz},
+                         {xz, yz, zz-isolated}};
+    double v[3] = {0., 0., 0.}, v2 = 0.;
+    for (int i = 0; i < 3; i++) {
+        double candidate[3];
+        cross(rows[i], rows[(i+1)%3], candidate);
+        double length2 = dot(candidate, candidate);
+        if (length2 > v2) {
+            v2 = length2;
+            for (int m = 0; m < 3; m++)
+                v[m] = candidate[m];
+        }
+    }
+    double pair[2];
+    if (v2 > 0.) {
+        for (int m = 0; m < 3; m++)
+            v[m] /= sqrt(v2);
+        // orthonormal u, w with u x w = v
+        double u[3], w[3];
+        double axis[3] = {0., 0., 0.};
+        axis[(fabs(v[0]) < fabs(v[1])) ? (fabs(v[0]) < fabs(v[2]) ? 0 : 2) : (fabs(v[1]) < fabs(v[2]) ? 1 : 2)] = 1.;
+        cross(v, axis, u);
+        double lengthU = sqrt(dot(u, u));
+        for (int m = 0; m < 3; m++)
+            u[m] /= lengthU;
+        cross(v, u, w);
+        double tu[3] = {xx*u[0]+xy*u[1]+xz*u[2], xy*u[0]+yy*u[1]+yz*u[2], xz*u[0]+yz*u[1]+zz*u[2]};
+        double tw[3] = {xx*w[0]+xy*w[1]+xz*w[2], xy*w[0]+yy*w[1]+yz*w[2], xz*w[0]+yz*w[1]+zz*w[2]};
+        double uu = dot(u, tu), ww = dot(w, tw), uw = dot(u, tw);
+        double mean = (uu+ww)/2, half = sqrt((uu-ww)*(uu-ww)/4+uw*uw);
+        pair[0] = mean+half;
+        pair[1] = mean-half;
+    } else {
+        // all rows parallel, the other two eigenvalues are degenerate
+        pair[0] = pair[1] = (3*q-isolated)/2;
+    }
+    eigenvalues[0] = isolated;
+    eigenvalues[1] = pair[0];
+    eigenvalues[2] = pair[1];
+    std::sort(eigenvalues, eigenvalues+3);
+    std::swap(eigenvalues[0], eigenvalues[2]);
+}
+
+// sum_k |p_k . axis| and the corresponding signed sum of the momenta
+static double projectedSum(const double* momenta, int n, const double* axis, double* sum) {
+    sum[0] = sum[1] = sum[2] = 0.;
+    for (int k = 0; k < n; k++) {
+        const double* p = momenta+3*k;
+        double sign = (dot(p, axis) >= 0.) ? 1. : -1.;
+        for (int m = 0; m < 3; m++)
+            sum[m] += sign*p[m];
+    }
+    return dot(sum, sum);
+}
+
+// Keeps the longer of the signed sums, the thrust axis is along it
+static inline void updateThrust(const double* sum, double& best, double* axis) {
+    double length2 = dot(sum, sum);
+    if (length2 > best) {
+        best = length2;
+        for (int m = 0; m < 3; m++)
+            axis[m] = sum[m];
+    }
+}
+
+// Squared length of the longest signed sum of the momenta. The optimal
+//  signs are those of the projections onto some axis, which can be tilted
+//  until its orthogonal plane contains two of the momenta. The momenta in
+//  that plane, which are two unless several are coplanar, get the signs of
+//  a small tilt within the plane, the others those of the plane's normal.
+//  Any signs give a lower bound, so trying too many is harmless.
+static double exactThrust(const double* momenta, int n, double* axis) {
+    double best = -1.;
+    double sum[3];
+    // collinear momenta have no orthogonal axes
+    for (int i = 0; i < n; i++) {
+        projectedSum(momenta, n, momenta+3*i, sum);
+        updateThrust(sum, best, axis);
+    }
+    int inPlane[maxExactThrustObjects];
+    for (int i = 0; i < n; i++) {
+        const double* pi = momenta+3*i;
+        for (int j = i+1; j < n; j++) {
+            const double* pj = momenta+3*j;
+            double normal[3];
+            cross(pi, pj, normal);
+            double normal2 = dot(normal, normal);
+            if (normal2 == 0.)
+                continue;
+            double rest[3] = {0., 0., 0.};
+            int nInPlane = 0;
+            for (int k = 0; k < n; k++) {
+                const double* p = momenta+3*k;
+                double projection = dot(p, normal);
+                if (k == i || k == j || projection*projection <= alignedTolerance*normal2*dot(p, p)) {
+                    inPlane[nInPlane++] = k;
+                    continue;
+                }
+                double sign = (projection > 0.) ? 1. : -1.;
+                for (int m = 0; m < 3; m++)
+                    rest[m] += sign*p[m];
+            }
+            // tilts within the plane towards +-t flip the momenta along p_a,
+            //  those opposite to p_a get the other sign
+            for (int a = 0; a < nInPlane; a++) {
+                const double* pa = momenta+3*inPlane[a];
+                double t[3];
+                cross(normal, pa, t);
+                double t2 = dot(t, t);
+                for (int s = 0; s < 4; s++) {
+                    double st = (s & 1) ? -1. : 1., sa = (s & 2) ? -1. : 1.;
+                    for (int m = 0; m < 3; m++)
+                        sum[m] = rest[m];
+                    for (int b = 0; b < nInPlane; b++) {
+                        const double* p = momenta+3*inPlane[b];
+                        double side = st*dot(p, t);
+                        if (b == a || side*side <= alignedTolerance*t2*dot(p, p))
+                            side = sa*dot(p, pa);
+                        double sign = (side >= 0.) ? 1. : -1.;
+                        for (int m = 0; m < 3; m++)
+                            sum[m] += sign*p[m];
+                    }
+                    updateThrust(sum, best, axis);
+                }
+            }
+            // every further pair spans the same plane
+            if (nInPlane == n)
+                return best;
+        }
+    }
+    return best;
+}
+
+// Iterates axis -> sum_k sign(p_k . axis) p_k from the directions of the
+//  hardest momenta and of their signed sums, stops when the signs are stable
+static double approximateThrust(const double* momenta, int n, double* axis) {
+    int hardest[thrustSeeds];
+    int nSeeds = 0;
+    for (int k = 0; k < n; k++) {
+        double p2 = dot(momenta+3*k, momenta+3*k);
+        int pos = nSeeds;
+        while (pos > 0 && dot(momenta+3*hardest[pos-1], momenta+3*hardest[pos-1]) < p2) {
+            if (pos < thrustSeeds)
+                hardest[pos] = hardest[pos-1];
+            pos--;
+        }
+        if (pos < thrustSeeds) {
+            hardest[pos] = k;
+            nSeeds = std::min(nSeeds+1, thrustSeeds);
+        }
+    }
+
+    double best = -1.;
+    for (int signs = 0; signs < (1 << (nSeeds-1)); signs++) {
+        double seed[3] = {0., 0., 0.};
+        for (int s = 0; s < nSeeds; s++) {
+            double sign = ((signs >> s) & 1) ? -1. : 1.;
+            for (int m = 0; m < 3; m++)
+                seed[m] += sign*momenta[3*hardest[s]+m];
+        }
+        double value = dot(seed, seed);
+        if (value == 0.)
+            continue;
+        double sum[3];
+        for (int iteration = 0; iteration < maxThrustIterations; iteration++) {
+            double next = projectedSum(momenta, n, seed, sum);
+            if (next <= value)
+                break;
+            for (int m = 0; m < 3; m++)
+                seed[m] = sum[m];
+            value = next;
+        }
+        updateThrust(seed, best, axis);
+    }
+    return best;
+}
+
+void evaluate(const double* momenta, int n, event_shape& shape) {
+    shape.sphericity = shape.aplanarity = shape.transverse_sphericity = shape.thrust = 0.;
+    for (int m = 0; m < 3; m++)
+        shape.eigenvalues[m] = shape.thrust_axis[m] = 0.;
+    for (int l = 0; l <= maxFoxWolframOrder; l++)
+        shape.fox_wolfram[l] = 0.;
+
+    // tensor xx, yy, zz, xy, xz, yz and the normalisations in one pass
+    double tensor[6] = {0., 0., 0., 0., 0., 0.};
+    double sumP = 0.;
+    for (int k = 0; k < n; k++) {
+        const double* p = momenta+3*k;
+        tensor[0] += p[0]*p[0];
+        tensor[1] += p[1]*p[1];
+        tensor[2] += p[2]*p[2];
+        tensor[3] += p[0]*p[1];
+        tensor[4] += p[0]*p[2];
+        tensor[5] += p[1]*p[2];
+        sumP += sqrt(dot(p, p));
+    }
+    double sumP2 = tensor[0]+tensor[1]+tensor[2];
+    if (sumP2 <= 0.)
+        return;
+
+    for (int m = 0; m < 6; m++)
+        tensor[m] /= sumP2;
+    symmetric_eigenvalues(tensor, shape.eigenvalues);
+    shape.sphericity = 1.5*(shape.eigenvalues[1]+shape.eigenvalues[2]);
+    shape.aplanarity = 1.5*shape.eigenvalues[2];
+
+    // the transverse 2x2 block has eigenvalues (t +- sqrt((xx-yy)^2+4xy^2))/2
+    double transverse = tensor[0]+tensor[1];
+    if (transverse > 0.) {
+        double root = sqrt((tensor[0]-tensor[1])*(tensor[0]-tensor[1])+4*tensor[3]*tensor[3]);
+        shape.transverse_sphericity = 2*std::max(0., (transverse-root)/2)/transverse;
+    }
+
+    double axis[3];
+    double thrust2 = (n <= maxExactThrustObjects) ? exactThrust(momenta, n, axis)
+                                                  : approximateThrust(momenta, n, axis);
+    double length = sqrt(thrust2);
+    shape.thrust = length/sumP;
+    for (int m = 0; m < 3; m++)
+        shape.thrust_axis[m] = axis[m]/length;
+
+    // Legendre polynomials by their recursion
+    for (int i = 0; i < n; i++) {
+        const double* pi = momenta+3*i;
+        double absPi = sqrt(dot(pi, pi));
+        for (int j = 0; j < n; j++) {
+            const double* pj = momenta+3*j;
+            double absPj = sqrt(dot(pj, pj));
+            if (absPi == 0. || absPj == 0.)
+                continue;
+            double x = (i == j) ? 1. : dot(pi, pj)/(absPi*absPj);
+            double weight = absPi*absPj/(sumP*sumP);
+            double previous = 1., current = x;
+            shape.fox_wolfram[0] += weight;
+            for (int l = 1; l <= maxFoxWolframOrder; l++) {
+                shape.fox_wolfram[l] += weight*current;
+                double next = ((2*l+1)*x*current-l*previous)/(l+1);
+                previous = current;
+                current = next;
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,274 @@
+#include "hemisphere_partition.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+namespace hemisphere_partition
+{
+
+// up to these numbers of free objects all splits are walked in Gray code order
+static const int maxGraySigns = 16;
+static const int maxGrayObjects = 14;
+
+typedef std::pair<double, ULong64_t> split_value;
+
+// index of the bit in which the Gray codes of k-1 and k differ
+static inline int flippedBit(ULong64_t k) {
+    int b = 0;
+    while (((k >> b) & 1) == 0)
+        b++;
+    return b;
+}
+
+// signed sum of a split, exactly as the original alphaT code computes it
+static double exactSignedSum(const std::vector<double>& values, ULong64_t signs) {
+    double sum = 0.;
+    for (int j = 0; j < values.size(); j++)
+        sum += values[j] * (1 - 2 * (int(signs >> j) & 1));
+    return sum;
+}
+
+// Signed sums for all signs of values[first...first+nSigns-1], the other values
+//  being fixed to +. start is the sum with all of them positive.
+static void graySums(const std::vector<double>& values,
+                     int first,
+                     int nSigns,
+                     double start,
+                     std::vector<split_value>& sums) {
+    ULong64_t count = (ULong64_t)1 << nSigns;
+    sums.resize(count);
+    double sum = start;
+    ULong64_t signs = 0;
+    sums[0] = split_value(sum, signs);
+    for (ULong64_t k = 1; k < count; k++) {
+        int j = first+flippedBit(k);
+        signs ^= (ULong64_t)1 << j;
+        if ((signs >> j) & 1)
+            sum -= 2*values[j];
+        else
+            sum += 2*values[j];
+        sums[k] = split_value(sum, signs);
+    }
+}
+
+double min_signed_sum(const std::vector<double>& values) {
+    int n = values.size();
+    if (n == 0)
+        return 0.;
+    double scale = 0., total = 0.;
+    for (int j = 0; j < n; j++) {
+        scale += fabs(values[j]);
+        total += values[j];
+    }
+    // the sign of the last value is fixed
+    int nFree = n-1;
+
+    std::vector<ULong64_t> candidates;
+    if (nFree <= maxGraySigns) {
+        std::vector<split_value> sums;
+        graySums(values, 0, nFree, total, sums);
+        // every step changes the sum by one rounding error of at most DBL_EPSILON*scale
+        double tolerance = 2*(sums.size()+2*n)*DBL_EPSILON*scale;
+        double best = DBL_MAX;
+        for (int k = 0; k < sums.size(); k++)
+            best = std::min(best, fabs(sums[k].first));
+        for (int k = 0; k < sums.size(); k++)
+            if (fabs(sums[k].first) <= best+4*tolerance)
+                candidates.push_back(sums[k].second);
+    } else {
+        // meet in the middle: each sum is the sum of a low and a high part,
+        //  for each high part only the low parts around its negative matter
+        int nLow = nFree/2;
+        double lowTotal = 0.;
+        for (int j = 0; j < nLow; j++)
+            lowTotal += values[j];
+        std::vector<split_value> low, high;
+        graySums(values, 0, nLow, lowTotal, low);
+        graySums(values, nLow, nFree-nLow, total-lowTotal, high);
+        std::sort(low.begin(), low.end());
+        double tolerance = 2*(low.size()+high.size()+2*n)*DBL_EPSILON*scale;
+        double best = DBL_MAX;
+        for (int h = 0; h < high.size(); h++) {
+            std::vector<split_value>::iterator it =
+                    std::lower_bound(low.begin(), low.end(), split_value(-high[h].first, 0));
+            if (it != low.end())
+                best = std::min(best, fabs(it->first+high[h].first));
+            if (it != low.begin())
+                best = std::min(best, fabs((it-1)->first+high[h].first));
+        }
+        double window = best+4*tolerance;
+        for (int h = 0; h < high.size(); h++) {
+            std::vector<split_value>::iterator it =
+                    std::lower_bound(low.begin(), low.end(), split_value(-high[h].first-2*window, 0));
+            for (; it != low.end() && it->first+high[h].first <= 2*window; it++)
+                if (fabs(it->first+high[h].first) <= window)
+                    candidates.push_back(it->second | high[h].second);
+        }
+    }
+
+    // the original code takes the first of the minimal sums
+    double best = -1;
+    ULong64_t bestSigns = 0;
+    for (int c = 0; c < candidates.size(); c++) {
+        double sum = fabs(exactSignedSum(values, candidates[c]));
+        if (best < 0 || sum < best || (sum == best && candidates[c] < bestSigns)) {
+            best = sum;
+            bestSigns = candidates[c];
+        }
+    }
+    return best;
+}
+
+// four-vectors as px, py, pz, E
+static inline double massSquared(const double* p) {
+    return p[3]*p[3]-(p[0]*p[0]+p[1]*p[1]+p[2]*p[2]);
+}
+
+// Depth first search over the objects not fixed to a hemisphere. Adding an
+//  object with E >= |p| never decreases the mass of a hemisphere, such that
+//  branches already heavier than the best split can be dropped.
+struct split_search {
+    std::vector<double> momenta; // 4 per object
+    std::vector<int> order; // free objects, most energetic first
+    double tolerance;
+    double slack; // how much lighter a hemisphere may get by objects with E < |p|
+    double best;
+    std::vector<split_value> found;
+
+    void search(int depth, const double* first, const double* second, ULong64_t mask) {
+        double value = massSquared(first)+massSquared(second);
+        if (depth == order.size()) {
+            if (mask == 0)
+                return;
+            if (value <= best+4*tolerance)
+                found.push_back(split_value(value, mask));
+            best = std::min(best, value);
+            return;
+        }
+        if (value-slack > best+8*tolerance)
+            return;
+        int c = order[depth];
+        const double* p = &momenta[4*c];
+        double next[4];
+        for (int i = 0; i < 4; i++)
+            next[i] = first[i]+p[i];
+        search(depth+1, next, second, mask | ((ULong64_t)1 << c));
+        for (int i = 0; i < 4; i++)
+            next[i] = second[i]+p[i];
+        search(depth+1, first, next, mask);
+    }
+};
+
+// sorts the free objects by decreasing energy
+struct energy_greater {
+    const std::vector<double>* momenta;
+    bool operator()(int a, int b) const {
+        return (*momenta)[4*a+3] > (*momenta)[4*b+3];
+    }
+};
+
+double min_mass_split(const std::vector<TLorentzVector>& objects,
+                      TLorentzVector& first,
+                      TLorentzVector& second) {
+    int n = objects.size();
+    if (n < 2)
+        return DBL_MAX;
+
+    std::vector<double> momenta(4*n);
+    double total[4] = {0., 0., 0., 0.};
+    double scale = 0., energy = 0., deficit = 0.;
+    bool negativeEnergy = false;
+    for (int c = 0; c < n; c++) {
+        double* p = &momenta[4*c];
+        p[0] = objects[c].Px();
+        p[1] = objects[c].Py();
+        p[2] = objects[c].Pz();
+        p[3] = objects[c].E();
+        for (int i = 0; i < 4; i++) {
+            total[i] += p[i];
+            scale += fabs(p[i]);
+        }
+        double absP = sqrt(p[0]*p[0]+p[1]*p[1]+p[2]*p[2]);
+        energy += std::max(p[3], absP);
+        deficit += std::max(0., absP-p[3]);
+        if (p[3] < 0)
+            negativeEnergy = true;
+    }
+
+    // bit c of a mask is set if object c is in the first hemisphere, the
+    //  first object always is in the second one like in the original
+    //  enumeration; the complementary splits give the same masses
+    std::vector<split_value> splits;
+    double tolerance;
+    if (n-1 <= maxGrayObjects) {
+        ULong64_t count = (ULong64_t)1 << (n-1);
+        tolerance = 32*(count+2*n+1)*DBL_EPSILON*scale*scale;
+        splits.reserve(count-1);
+        double h1[4] = {0., 0., 0., 0.}, h2[4];
+        ULong64_t mask = 0;
+        for (ULong64_t k = 1; k < count; k++) {
+            int c = 1+flippedBit(k);
+            mask ^= (ULong64_t)1 << c;
+            const double* p = &momenta[4*c];
+            double sign = ((mask >> c) & 1) ? 1. : -1.;
+            for (int i = 0; i < 4; i++) {
+                h1[i] += sign*p[i];
+                h2[i] = total[i]-h1[i];
+            }
+            splits.push_back(split_value(massSquared(h1)+massSquared(h2), mask));
+        }
+    } else {
+        split_search search;
+        search.momenta = momenta;
+        for (int c = 1; c < n; c++)
+            search.order.push_back(c);
+        energy_greater greater;
+        greater.momenta = &momenta;
+        std::sort(search.order.begin(), search.order.end(), greater);
+        tolerance = 32*(3*n+1)*DBL_EPSILON*scale*scale;
+        search.tolerance = tolerance;
+        // objects with E < |p| can lower the masses by at most
+        //  2*E*deficit per hemisphere, nothing is dropped for unphysical input
+        search.slack = negativeEnergy ? DBL_MAX : 8*energy*deficit;
+        search.best = DBL_MAX;
+        double h1[4] = {0., 0., 0., 0.};
+        search.search(0, h1, &momenta[0], 0);
+        splits = search.found;
+    }
+    double best = DBL_MAX;
+    for (int s = 0; s < splits.size(); s++)
+        best = std::min(best, splits[s].first);
+
+    // the original code takes the first split of minimal mass, with the
+    //  first object being the highest bit of its index
+    double bestMass = DBL_MAX;
+    ULong64_t bestIndex = 0;
+    bool haveSplit = false;
+    for (int s = 0; s < splits.size(); s++) {
+        if (splits[s].first > best+4*tolerance)
+            continue;
+        TLorentzVector h1, h2;
+        ULong64_t index = 0;
+        for (int c = 0; c < n; c++) {
+            if ((splits[s].second >> c) & 1) {
+                h1 += objects[c];
+                index |= (ULong64_t)1 << (n-1-c);
+            } else {
+                h2 += objects[c];
+            }
+        }
+        double mass = h1.M2()+h2.M2();
+        if (!haveSplit || mass < bestMass || (mass == bestMass && index < bestIndex)) {
+            haveSplit = true;
+            bestMass = mass;
+            bestIndex = index;
+            first = h1;
+            second = h2;
+        }
+    }
+    return bestMass;
+}
+
+}
@@ -36,16 +36,11 @@ double topnesscompute(double pb1[4], double pb2[4], double pl[4], double MET[4],
   int Ntry=100000;    // maximum number of Nelder-Mead cycles to perform for a given initial seed   
   int Nattempts=15; //   number of initial starts 
 
-  // get random seed (once) 
-  // default c++ "random number" generator good enough here      
-  srand((unsigned)time(0));
+  // default c++ "random number" generator good enough here; it is seeded
+  // once per run (randomseed), reseeding it here would make topness and
+  // every other rand() user irreproducible
   double rndm, start ;
   int n=3000;
-  // get going                                                                     
-  for (int i=0; i<100; i++)
-    {
-      rndm=(rand()%n)+1;
-    }
   double edir[]={1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1};
   double ybest=1000000000.; // a big number 
   double ybest1=100000000.;                                           
@@ -0,0 +1,346 @@
+#include "topness/topness_minimiser.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+#include "topness/topness_struct.h"
+
+/* Minimisation of the topness statistic by damped Newton steps,
+   the statistic itself and the top and W masses are the ones of topness_struct.h */
+
+// grid of neutrino transverse momenta around half the missing transverse momentum
+static const int gridHalfWidth = 16;
+static const double gridStep = 25.;
+// at most this many local minima of the grid are refined
+static const int maxRefinedStarts = 16;
+static const int maxIterations = 200;
+static const int maxCacheSize = 256;
+
+static inline double minkowski(const double a[4], const double b[4]) {
+    return a[3]*b[3]-a[0]*b[0]-a[1]*b[1]-a[2]*b[2];
+}
+
+// The four residuals r of S = sum r_i^2 with respect to x = (pv_x, pv_y, pv_z, pW_z),
+//  optionally their gradients J[i][k] and Hessians K[i][k][m]
+struct topness_residuals {
+    double bW[4], bl[4], pl[4], MET[4];
+    double scale[4]; // sigmat^2, sigmat^2, sigmaW^2, sigmas^2
+
+    double evaluate(const double x[4], double r[4], double J[4][4], double K[4][4][4]) const {
+        double v[4] = {x[0], x[1], x[2], sqrt(x[0]*x[0]+x[1]*x[1]+x[2]*x[2])};
+        double W[4] = {MET[0]-x[0], MET[1]-x[1], x[3], 0.};
+        W[3] = sqrt(W[0]*W[0]+W[1]*W[1]+W[2]*W[2]+mW*mW);
+
+        // the summed four-vectors of the four terms
+        double Q[4][4];
+        for (int m = 0; m < 4; m++) {
+            Q[0][m] = bW[m]+W[m];
+            Q[2][m] = pl[m]+v[m];
+            Q[1][m] = bl[m]+Q[2][m];
+            Q[3][m] = Q[1][m]+Q[0][m];
+        }
+        double target[4] = {mt*mt, mt*mt, mW*mW, 4*mt*mt};
+        double S = 0.;
+        for (int i = 0; i < 4; i++) {
+            r[i] = (minkowski(Q[i], Q[i])-target[i])/scale[i];
+            S += r[i]*r[i];
+        }
+        if (J == NULL)
+            return S;
+
+        // The spatial momenta are linear in x, the neutrino energy is kept away
+        //  from its kink at 0. Of W, x moves the components in Wcomponent by Wsign.
+        double Ev = std::max(v[3], 1e-9);
+        const int Wcomponent[4] = {0, 1, -1, 2};
+        const double Wsign[4] = {-1., -1., 0., 1.};
+        double dQ[4][4][4];
+        for (int k = 0; k < 4; k++) {
+            double dv[4] = {0., 0., 0., 0.}, dW[4] = {0., 0., 0., 0.};
+            if (k < 3) {
+                dv[k] = 1.;
+                dv[3] = x[k]/Ev;
+            }
+            if (Wcomponent[k] >= 0) {
+                dW[Wcomponent[k]] = Wsign[k];
+                dW[3] = Wsign[k]*W[Wcomponent[k]]/W[3];
+            }
+            for (int m = 0; m < 4; m++) {
+                dQ[0][k][m] = dW[m];
+                dQ[1][k][m] = dQ[2][k][m] = dv[m];
+                dQ[3][k][m] = dv[m]+dW[m];
+            }
+            for (int i = 0; i < 4; i++)
+                J[i][k] = 2*minkowski(Q[i], dQ[i][k])/scale[i];
+        }
+        if (K == NULL)
+            return S;
+
+        // only the energies have second derivatives
+        for (int k = 0; k < 4; k++) {
+            for (int m = 0; m < 4; m++) {
+                double d2Ev = 0., d2EW = 0.;
+                if (k < 3 && m < 3)
+                    d2Ev = ((k == m ? 1. : 0.)-x[k]*x[m]/(Ev*Ev))/Ev;
+                if (Wcomponent[k] >= 0 && Wcomponent[m] >= 0) {
+                    double Wk = W[Wcomponent[k]], Wm = W[Wcomponent[m]];
+                    d2EW = Wsign[k]*Wsign[m]*((k == m ? 1. : 0.)-Wk*Wm/(W[3]*W[3]))/W[3];
+                }
+                double d2E[4] = {d2EW, d2Ev, d2Ev, d2Ev+d2EW};
+                for (int i = 0; i < 4; i++)
+                    K[i][k][m] = 2*(minkowski(dQ[i][k], dQ[i][m])+Q[i][3]*d2E[i])/scale[i];
+            }
+        }
+        return S;
+    }
+};
+
+// Solves A x = b for 4x4 matrices by Gaussian elimination, false if singular
+static bool solve4(double A[4][4], double b[4], double x[4]) {
+    for (int c = 0; c < 4; c++) {
+        int pivot = c;
+        for (int r = c+1; r < 4; r++)
+            if (fabs(A[r][c]) > fabs(A[pivot][c]))
+                pivot = r;
+        if (A[pivot][c] == 0.)
+            return false;
+        for (int m = 0; m < 4; m++)
+            std::swap(A[c][m], A[pivot][m]);
+        std::swap(b[c], b[pivot]);
+        for (int r = c+1; r < 4; r++) {
+            double f = A[r][c]/A[c][c];
+            for (int m = c; m < 4; m++)
+                A[r][m] -= f*A[c][m];
+            b[r] -= f*b[c];
+        }
+    }
+    for (int c = 3; c >= 0; c--) {
+        double s = b[c];
+        for (int m = c+1; m < 4; m++)
+            s -= A[c][m]*x[m];
+        x[c] = s/A[c][c];
+    }
+    return true;
+}
+
+// Newton minimisation of S starting from x, damped like Levenberg-Marquardt,
+//  returns min S and updates x
+static double minimise(const topness_residuals& residuals, double x[4]) {
+    double r[4], J[4][4], K[4][4][4];
+    double S = residuals.evaluate(x, r, J, K);
+    double lambda = 1e-3;
+    for (int iteration = 0; iteration < maxIterations; iteration++) {
+        // gradient and Hessian of S/2, the Gauss-Newton part JtJ also scales the damping
+        double H[4][4], JtJ[4][4], g[4];
+        for (int k = 0; k < 4; k++) {
+            g[k] = 0.;
+            for (int i = 0; i < 4; i++)
+                g[k] += J[i][k]*r[i];
+            for (int m = 0; m < 4; m++) {
+                JtJ[k][m] = H[k][m] = 0.;
+                for (int i = 0; i < 4; i++) {
+                    JtJ[k][m] += J[i][k]*J[i][m];
+                    H[k][m] += J[i][k]*J[i][m]+r[i]*K[i][k][m];
+                }
+            }
+        }
+        bool improved = false;
+        while (!improved && lambda < 1e12) {
+            double A[4][4], b[4], step[4];
+            for (int k = 0; k < 4; k++) {
+                for (int m = 0; m < 4; m++)
+                    A[k][m] = H[k][m];
+                A[k][k] += lambda*(JtJ[k][k]+1e-12);
+                b[k] = -g[k];
+            }
+            if (!solve4(A, b, step)) {
+                lambda *= 10;
+                continue;
+            }
+            double xNew[4], rNew[4];
+            for (int k = 0; k < 4; k++)
+                xNew[k] = x[k]+step[k];
+            double SNew = residuals.evaluate(xNew, rNew, NULL, NULL);
+            if (SNew < S) {
+                improved = true;
+                bool converged = (S-SNew <= 1e-12*S);
+                for (int k = 0; k < 4; k++)
+                    x[k] = xNew[k];
+                S = residuals.evaluate(x, r, J, K);
+                lambda = std::max(lambda/10, 1e-12);
+                if (converged)
+                    return S;
+            } else {
+                lambda *= 10;
+            }
+        }
+        if (!improved)
+            break;
+    }
+    return S;
+}
+
+// z momentum of an invisible particle of transverse momentum qx, qy and mass^2
+//  mq2 such that its sum with a has mass^2 M2, both solutions or the real part
+static int solvePz(const double a[4], double qx, double qy, double mq2, double M2, double pz[2]) {
+    double mu = (M2-minkowski(a, a)-mq2)/2+a[0]*qx+a[1]*qy;
+    double A = a[3]*a[3]-a[2]*a[2];
+    if (A <= 0.) {
+        pz[0] = 0.;
+        return 1;
+    }
+    double B = -2*mu*a[2];
+    double C = a[3]*a[3]*(qx*qx+qy*qy+mq2)-mu*mu;
+    double discriminant = B*B-4*A*C;
+    if (discriminant <= 0.) {
+        pz[0] = -B/(2*A);
+        return 1;
+    }
+    pz[0] = (-B-sqrt(discriminant))/(2*A);
+    pz[1] = (-B+sqrt(discriminant))/(2*A);
+    return 2;
+}
+
+topness_minimiser::topness_minimiser() {
+}
+
+void topness_minimiser::clear() {
+    cache.clear();
+}
+
+double topness_minimiser::pairing(const double bW[4], const double bl[4], const double pl[4], const double MET[4],
+                                  double sigmat, double sigmaW, double sigmas, double xbest[4]) {
+    double key[17];
+    for (int m = 0; m < 4; m++) {
+        key[m] = bW[m];
+        key[4+m] = bl[m];
+        key[8+m] = pl[m];
+    }
+    key[12] = MET[0];
+    key[13] = MET[1];
+    key[14] = sigmat;
+    key[15] = sigmaW;
+    key[16] = sigmas;
+    for (int c = 0; c < cache.size(); c++) {
+        bool same = true;
+        for (int m = 0; m < 17 && same; m++)
+            same = (cache[c].key[m] == key[m]);
+        if (same) {
+            for (int k = 0; k < 4; k++)
+                xbest[k] = cache[c].x[k];
+            return cache[c].value;
+        }
+    }
+
+    topness_residuals residuals;
+    for (int m = 0; m < 4; m++) {
+        residuals.bW[m] = bW[m];
+        residuals.bl[m] = bl[m];
+        residuals.pl[m] = pl[m];
+    }
+    residuals.MET[0] = MET[0];
+    residuals.MET[1] = MET[1];
+    residuals.MET[2] = residuals.MET[3] = 0.;
+    residuals.scale[0] = residuals.scale[1] = sigmat*sigmat;
+    residuals.scale[2] = sigmaW*sigmaW;
+    residuals.scale[3] = sigmas*sigmas;
+
+    // For a given neutrino transverse momentum the leptonic W and the hadronic
+    //  top are put on shell by the z momenta. There are up to two solutions for
+    //  each, the four combinations span separate grids of transverse momenta
+    //  whose local minima are the starting points of the minimisation.
+    const int gridWidth = 2*gridHalfWidth+1;
+    const int gridSize = gridWidth*gridWidth;
+    std::vector<double> gridValues(4*gridSize);
+    std::vector<double> gridPoints(16*gridSize);
+    for (int i = 0; i < gridWidth; i++) {
+        for (int j = 0; j < gridWidth; j++) {
+            double vx = MET[0]/2+(i-gridHalfWidth)*gridStep;
+            double vy = MET[1]/2+(j-gridHalfWidth)*gridStep;
+            double vz[2], Wz[2];
+            if (solvePz(pl, vx, vy, 0., mW*mW, vz) == 1)
+                vz[1] = vz[0];
+            if (solvePz(bW, MET[0]-vx, MET[1]-vy, mW*mW, mt*mt, Wz) == 1)
+                Wz[1] = Wz[0];
+            for (int c = 0; c < 4; c++) {
+                int g = c*gridSize+i*gridWidth+j;
+                double* x = &gridPoints[4*g];
+                double r[4];
+                x[0] = vx;
+                x[1] = vy;
+                x[2] = vz[c/2];
+                x[3] = Wz[c%2];
+                gridValues[g] = residuals.evaluate(x, r, NULL, NULL);
+            }
+        }
+    }
+    std::vector<std::pair<double, int> > starts;
+    for (int c = 0; c < 4; c++) {
+        for (int i = 0; i < gridWidth; i++) {
+            for (int j = 0; j < gridWidth; j++) {
+                int g = c*gridSize+i*gridWidth+j;
+                bool localMinimum = true;
+                for (int di = -1; di <= 1 && localMinimum; di++)
+                    for (int dj = -1; dj <= 1 && localMinimum; dj++)
+                        if (i+di >= 0 && i+di < gridWidth && j+dj >= 0 && j+dj < gridWidth)
+                            localMinimum = (gridValues[g+di*gridWidth+dj] >= gridValues[g]);
+                if (localMinimum)
+                    starts.push_back(std::make_pair(gridValues[g], g));
+            }
+        }
+    }
+    std::sort(starts.begin(), starts.end());
+    if (starts.size() > maxRefinedStarts)
+        starts.resize(maxRefinedStarts);
+
+    double best = DBL_MAX;
+    for (int s = 0; s < starts.size(); s++) {
+        double x[4];
+        for (int k = 0; k < 4; k++)
+            x[k] = gridPoints[4*starts[s].second+k];
+        double S = minimise(residuals, x);
+        if (S < best) {
+            best = S;
+            for (int k = 0; k < 4; k++)
+                xbest[k] = x[k];
+        }
+    }
+
+    if (cache.size() >= maxCacheSize)
+        cache.clear();
+    pairing_result result;
+    for (int m = 0; m < 17; m++)
+        result.key[m] = key[m];
+    result.value = best;
+    for (int k = 0; k < 4; k++)
+        result.x[k] = xbest[k];
+    cache.push_back(result);
+    return best;
+}
+
+double topness_minimiser::minimum(const double pb1[4], const double pb2[4], const double pl[4], const double MET[4],
+                                  double sigmat, double sigmaW, double sigmas, double xbest[4]) {
+    double x1[4], x2[4];
+    double S1 = pairing(pb1, pb2, pl, MET, sigmat, sigmaW, sigmas, x1);
+    double S2 = pairing(pb2, pb1, pl, MET, sigmat, sigmaW, sigmas, x2);
+    const double* x = (S1 < S2) ? x1 : x2;
+    for (int k = 0; k < 4; k++)
+        xbest[k] = x[k];
+    return std::min(S1, S2);
+}
+
+std::vector<double> topness_minimiser::minimum(const std::vector<topness_tuple>& tuples,
+                                               double sigmat, double sigmaW, double sigmas) {
+    std::vector<double> minima;
+    for (int t = 0; t < tuples.size(); t++) {
+        const topness_tuple& tuple = tuples[t];
+        double pl[4] = {tuple.lepton.Px(), tuple.lepton.Py(), tuple.lepton.Pz(), tuple.lepton.E()};
+        double pb1[4] = {tuple.b1.Px(), tuple.b1.Py(), tuple.b1.Pz(), tuple.b1.E()};
+        double pb2[4] = {tuple.b2.Px(), tuple.b2.Py(), tuple.b2.Pz(), tuple.b2.E()};
+        double MET[4] = {tuple.invis.Px(), tuple.invis.Py(), 0., 0.};
+        double xbest[4];
+        minima.push_back(minimum(pb1, pb2, pl, MET, sigmat, sigmaW, sigmas, xbest));
+    }
+    return minima;
+}
@@ -4,6 +4,9 @@
 #include <fstream>
 #include <stdio.h>
 #include <map>
+#include <set>
+#include <algorithm>
+#include <functional>
 #include <math.h>
 #include <stdexcept>
 #include <iostream>
@@ -20,6 +23,7 @@
 #include "TDatabasePDG.h"
 #include "TParticlePDG.h"
 #include "TLorentzVector.h"
+#include "TRandom3.h"
 
 #include "modules/Delphes.h"
 #include "classes/DelphesFactory.h"
@@ -68,6 +72,40 @@ public:
         double eff; // efficiency working point, [0,1]
     };
 
+    //! Isolation tags of one particle type sharing source and pTmin
+    /** All tags of a group are evaluated from a single pass over the
+     *  neighbours of a candidate, whatever their cone sizes and limits.
+     */
+    struct isolation_group {
+        std::string source; //!< 't' for tracks or 'c' for calorimeter
+        double pTmin; //!< pTmin of the considered candidates
+        double maxDR; //!< largest dR cone of all tags in the group
+        std::vector<int> tags; //!< positions of the tags in their tag list
+    };
+
+    //! Scale factors on the efficiencies of one systematic universe
+    /** Each efficiency of the given category is multiplied with the
+     *  factor (and capped at 1). The nominal universe has all factors 1.
+     */
+    struct efficiency_universe {
+        std::string label; //!< Unique name, appended to the output prefix
+        double bTag; //!< b jets passing a b tag
+        double cMistag; //!< c jets passing a b tag
+        double lightMistag; //!< light jets passing a b tag
+        double tauTag; //!< true taus passing the tau tags
+        double electronID; //!< electrons passing the loose identification
+        double muonID; //!< muons passing the combined(plus) identification
+        double photonID; //!< photons passing the medium identification
+    };
+
+    //! Statistical status of all analyses, combined by checkPrecision()
+    struct precision_status {
+        bool precise; //!< all analyses reached the requested relative error
+        bool excluded; //!< an analysis has r > 1 with the requested confidence
+        bool allowed; //!< all analyses with S95 values have r < 1 with the requested confidence
+        bool haveR; //!< any analysis knows its S95 values
+    };
+
 
     //! Standard Constructor
     AnalysisHandler();
@@ -92,6 +130,12 @@ public:
             int randomSeed
             );
 
+    //! \brief Links the analyses to the branches of the DelphesHandler
+    //!
+    //! Has to be called after DelphesHandler::initialiseModules(), which
+    //! creates the branches. Does nothing if the input is a ROOT file.
+    void linkDelphes();
+
     //! Processes event via all loaded analyses.
     /** \param iEvent the index of the event to be analysed, starting at 0.
      *  \return False if event could not be processed, else True.
@@ -108,9 +152,32 @@ public:
     void setCrossSection(double xsect,
                          double xsecterr = -1.0);
 
+    //! \brief Checks if the statistics of the event loop suffice
+    //!
+    //! Combines the status of the most sensitive signal region of every
+    //! analysis into status, see AnalysisBase::sensitiveRegionPrecision().
+    //! \param precision requested relative statistical error, ignored if <= 0
+    //! \param sigma requested distance of r from 1 in units of its
+    //!  statistical error, ignored if <= 0
+    //! \param status combined status, has to be initialised with precise and
+    //!  allowed true and excluded and haveR false
+    void checkPrecision(double precision, double sigma, precision_status& status);
+
     //! Finalises analyses
     void finish();
 
+    //! \brief Writes the results of the current job of a parameter scan
+    //!
+    //! finish() does the same for the last job and finalises the handler.
+    void finishJob();
+
+    //! \brief Resets all analyses for the next job of a parameter scan
+    //!
+    //! \param outputPrefix output prefix of the results of the job
+    //! \param file event file of the job. It replaces the ROOT input of the
+    //!  handler, with a DelphesHandler it only provides the cross section.
+    void startJob(std::string outputPrefix, EventFile file);
+
     
     //! name which is printed in logfile
     std::string name;
@@ -128,6 +195,15 @@ protected:
                               Tag_Map whichTags,
                               Param_Map eventParameters ) {};
 
+    //! \brief Returns the loosest bounds of the truth b, c and taus used for tagging
+    //!
+    //! The DelphesHandler only writes truth particles within these bounds to
+    //! the TaggingParticle branch.
+    virtual void truthTaggingCuts(double& ptMin, double& etaMax) {
+        ptMin = 0;
+        etaMax = 100;
+    };
+
     //! Performs experiment dependent particle procession
     /** Experiment dependent parts are identification/reconstruction
      *  efficiencies and jet tagging.
@@ -137,8 +213,42 @@ protected:
     //! Links experiment dependent particle lists
     virtual void linkObjects();
 
+    //! Performs the efficiency dependent part of postProcessParticles
+    /** Has to be repeatable on the same event: all random decisions are
+     *  taken via passes(), such that each efficiency universe sees the
+     *  same draws and each tag configuration can be replayed.
+     */
+    virtual void applyEfficiencies() {
+        Global::abort(name, "This analysis handler does not support repeated efficiency passes");
+    };
+
+    //! \brief Decides if a candidate passes a selection of efficiency eff
+    //!
+    //! Every (object, slot) pair has one uniform random number u per event,
+    //! shared by all universes, and the candidate passes if u < eff. Several
+    //! working points of the same decision (e.g. loose/medium/tight) should
+    //! share the slot. In probabilistic mode u is not drawn but the
+    //! configurations of all decisions are enumerated, see probabilistic.
+    //! \param object the candidate the decision is taken for
+    //! \param slot distinguishes independent decisions on the same candidate
+    //! \param eff the probability to pass
+    bool passes(const void* object, int slot, double eff);
+
+    //! \brief Applies the current universe's scale factor on an efficiency
+    //!
+    //! \param eff the nominal efficiency
+    //! \param scale the member of efficiency_universe to apply, NULL for none
+    //! \return the varied efficiency, capped at 1
+    inline double varyEfficiency(double eff, double efficiency_universe::*scale) {
+        if (currentUniverse == NULL || scale == NULL || currentUniverse->*scale == 1.0)
+            return eff;
+        return std::min(1.0, eff*(currentUniverse->*scale));
+    }
+
     //! List of all booked analyses
     std::vector<AnalysisBase*> listOfAnalyses;
+    //! Whether each analysis in listOfAnalyses fails its reconstruction level bounds in the current event
+    std::vector<char> recoVetoed;
 
     //! List of all booked jet btags
     std::vector<jet_tag_definition*> listOfJetBTags;
@@ -186,12 +296,18 @@ protected:
     /** @} */
 
     double eventWeight; //!< weight of the currently processed event
+    //! weight variations (scale, PDF, ...) of the currently processed event
+    std::vector<double> eventWeights;
+    //! names of the weight variations: LHE weight ids or the HepMC/Pythia weight index
+    std::vector<std::string> weightNames;
 
     //! EventFile object
     EventFile eventFile;
 
     //! DelphesHandler object, if used
     DelphesHandler* dHandler;
+    //! true while the detector replicas after the first one of an event are read
+    bool readingReplica;
 
     //! ROOT TChain object to read .root file
     TChain* rootFileChain;
@@ -237,6 +353,15 @@ private:
             std::vector<isolation_tag_definition*>& list
             );
 
+    //! \brief Sets up efficiency universes for the AnalysisHandler handlerLabel
+    //!
+    //! \param conf the complete fritz configuration
+    //! \param handlerLabel the label of this AnalysisHandler
+    void setupEffUniverses(
+            Config conf,
+            std::string handlerLabel
+            );
+
     //! \brief Setup all analyses belonging to this handler
     //!
     //! \param conf the complete fritz configuration
@@ -284,9 +409,14 @@ private:
 
     //! \brief Link analyses to a delphes handler
     //!
+    //! Only registers the required branches, the branches are linked by
+    //! linkDelphes() once the Delphes modules are initialised.
     //! \param dHandler DelphesHandler to link against
     void setup(DelphesHandler* dHandler);
 
+    //! Returns the names of the Delphes branches read by this handler and its analyses
+    std::set<std::string> requiredBranches();
+
     //! Performes experiment independent analysis initialisation
     /* \sa setup function
      * \input rootInputFile Delphes .root file that should be analyses
@@ -298,19 +428,138 @@ private:
     //! Fills particle containers for given event
     bool readParticles(int iEvent);
 
+    //! Runs all analyses in listOfAnalyses on the linked event
+    void runAnalyses(int iEvent);
+
+    //! Compares the reconstruction level bounds of all analyses with the current event
+    /** Fills recoVetoed, such that linkObjects() and runAnalyses() skip the vetoed analyses.
+     *  \sa AnalysisBase::declareRecoBounds()
+     */
+    void evaluateRecoBounds();
+
+    //! Counts an event vetoed by the DelphesHandler in all analyses
+    void countVetoedEvent();
+
+    //! Reads the S95 values of the signal regions of analysis from its reference file
+    void readReferenceFile(AnalysisBase* analysis, std::string refFile);
+
+    //! Processes the currently read detector level event in all analyses and universes
+    void processReconstructedEvent(int iEvent);
+
+    //! Opens an event group in all analyses, including the universe copies
+    void startEventGroups();
+
+    //! Closes the event groups opened by startEventGroups()
+    void finishEventGroups();
+
+    //! Reads the weight and the weight variations of the current event
+    void readWeights(int iEvent);
+
+    //! \brief Runs the analyses on all tag configurations of the event
+    //!
+    //! The first configuration has to be applied already. In probabilistic
+    //! mode, applyEfficiencies() is called again for every further one.
+    void processConfigurations(int iEvent);
+
+    //! Uniform random number in [0,1), the same for an (object, slot) pair
+    //! during the whole event
+    double random(const void* object, int slot);
+
+    //! Uniform random number for a new draw, see universeRandom
+    double uniform();
+
     //! Interal subfunctions to isolate particles
     void isolateElectrons(); //!< isolates electrons
     void isolateMuons(); //!< isolates muons;
     void isolatePhotons(); //!< isolates photons;
 
+    //! Groups isolation tags with the same source and pTmin
+    std::vector<isolation_group> groupIsolationTags(
+            const std::vector<isolation_tag_definition*>& list
+            );
+
+    //! \brief Sets the flags of all tags in a group from isolationCone
+    //!
+    //! isolationCone has to hold the (dR, pT) pairs of all neighbours of
+    //! the candidate within the group's largest cone.
+    //!
+    //! \param group the group whose tags are evaluated
+    //! \param list the tag list the group refers to
+    //! \param candPT pT of the candidate, for relative isolation
+    //! \param flags the candidate's tag values, indexed as list
+    void evaluateIsolationGroup(
+            const isolation_group& group,
+            const std::vector<isolation_tag_definition*>& list,
+            double candPT,
+            std::vector<bool>& flags
+            );
+
+    //! Isolation groups, built from the tag lists before the first event
+    std::vector<isolation_group> electronIsolationGroups;
+    std::vector<isolation_group> muonIsolationGroups;
+    std::vector<isolation_group> photonIsolationGroups;
+    //! (dR, pT) of the neighbours of the current candidate, reused
+    std::vector<std::pair<double,double> > isolationCone;
+    //! Tracks and towers of the generator particles of the current event
+    ParticleOwnership ownership;
+    //! Large radius jets reclustered by the analyses in the current event
+    JetReclustering reclustering;
+    //! Jet pTs of the current event in decreasing order and their running sums, reused
+    std::vector<double> sortedJetPTs;
+    std::vector<double> jetPTSums;
+    //! Towers of the current isolation candidate, reused
+    std::vector<Tower*> ownTowers;
+
+    //! Efficiency universes evaluated in addition to the nominal one
+    std::vector<efficiency_universe> effUniverses;
+    //! Analyses of each efficiency universe, same order as listOfAnalyses
+    std::vector<std::vector<AnalysisBase*> > universeAnalyses;
+    //! Universe currently processed, NULL for the nominal one
+    efficiency_universe* currentUniverse;
+    //! Random numbers drawn in the current event, see random()
+    std::map<std::pair<const void*,int>, double> randomDraws;
+    //! Generator of the draws which only the universes need, such that
+    //! universes do not shift the rand() sequence of the nominal pass
+    TRandom3 universeRandom;
+
+    //! Range of the random number of one decision in the current configuration
+    struct decision_interval {
+        double lo; //!< lower end of the range
+        double hi; //!< upper end of the range
+        double sampled; //!< random number within the range once sampled, else -1
+    };
+
+    //! \brief Replace random decisions by an enumeration of configurations
+    //!
+    //! Each configuration of tag and identification decisions is processed
+    //! once, weighted with its probability. Configurations are enumerated
+    //! depth first: every decision whose efficiency splits the range its
+    //! random number is still allowed to have is a branch point.
+    bool probabilistic;
+    //! Configurations less likely than this are not split further, their
+    //! remaining decisions are sampled instead, which keeps yields unbiased
+    double minConfigurationWeight;
+    //! Ranges of the decisions of the current configuration
+    std::map<std::pair<const void*,int>, decision_interval> decisionIntervals;
+    //! Branch choices (true = pass) of the current configuration, in order
+    std::vector<bool> configurationPath;
+    //! Number of branch points reached in the current configuration
+    int pathPosition;
+    //! Choices leading to configurations yet to be processed
+    std::vector<std::vector<bool> > pendingPaths;
+    //! Probability of the current configuration
+    double configurationWeight;
+
     //! text file to store standard output and error of all analyses
     std::string analysisLogFile;
 
     // FixMe: store analysisParameters vector
 
     //! Internal ROOT objects which store the event wise information
-    TClonesArray *branchGenParticle; //!< truth particles (b, c, tau)
+    TClonesArray *branchGenParticle; //!< all truth particles, optional
+    TClonesArray *branchTaggingParticle; //!< skimmed truth particles (b, c, tau), optional
     TClonesArray *branchEvent; //!< general event information
+    TClonesArray *branchWeight; //!< weight variations, NULL if the input has none
     TClonesArray *branchElectron; //!< truth smeared electrons
     TClonesArray *branchMuon; //!< truth smeared muons
     TClonesArray *branchJet; //!< reconstructed jets
@@ -82,6 +82,12 @@ protected:
     //! links ATLAS specific particle vectors to ATLAS analyses
     void linkObjects();
 
+    //! Identification and tagging, rerun for every efficiency universe
+    void applyEfficiencies();
+
+    //! Loosest bounds of the truth b, c and taus used for tagging
+    void truthTaggingCuts(double& ptMin, double& etaMax);
+
 private:
     //! Apply ATLAS photon identification efficiencies
     void identifyPhotons();
@@ -52,6 +52,12 @@ protected:
     //! links CMS specific particle vectors to CMS analyses
     void linkObjects();
 
+    //! Identification and tagging, rerun for every efficiency universe
+    void applyEfficiencies();
+
+    //! Loosest bounds of the truth b, c and taus used for tagging
+    void truthTaggingCuts(double& ptMin, double& etaMax);
+
 private:
     //! Apply CMS photon identification efficiencies
     void identifyPhotons();
@@ -0,0 +1,45 @@
+#ifndef CMEfficiency_h
+#define CMEfficiency_h
+
+/** \class CMEfficiency
+ *
+ *  Selects candidates from the InputArray according to the efficiency formula,
+ *  like the Delphes Efficiency module. The formula is evaluated via a
+ *  FormulaTable and has to be piecewise constant, see FormulaTable::tabulable().
+ *
+ */
+
+#include "classes/DelphesModule.h"
+
+#include "FormulaTable.h"
+
+class TIterator;
+class TObjArray;
+class DelphesFormula;
+
+class CMEfficiency: public DelphesModule
+{
+public:
+
+  CMEfficiency();
+  ~CMEfficiency();
+
+  void Init();
+  void Process();
+  void Finish();
+
+private:
+
+  DelphesFormula *fFormula; //!
+  FormulaTable fTable; //!
+
+  TIterator *fItInputArray; //!
+
+  const TObjArray *fInputArray; //!
+
+  TObjArray *fOutputArray; //!
+
+  ClassDef(CMEfficiency, 1)
+};
+
+#endif
@@ -0,0 +1,15 @@
+/** ROOT dictionary of the Delphes modules provided by CheckMATE
+ *
+ *  Delphes creates the modules of a detector card via their ROOT class.
+ */
+
+#ifdef __CINT__
+
+#pragma link off all globals;
+#pragma link off all classes;
+#pragma link off all functions;
+
+#pragma link C++ class CMEfficiency+;
+#pragma link C++ class CMMomentumSmearing+;
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef CMMomentumSmearing_h
+#define CMMomentumSmearing_h
+
+/** \class CMMomentumSmearing
+ *
+ *  Performs transverse momentum resolution smearing, like the Delphes
+ *  MomentumSmearing module. The resolution formula is evaluated via a
+ *  FormulaTable and has to be piecewise constant, see FormulaTable::tabulable().
+ *
+ */
+
+#include "classes/DelphesModule.h"
+
+#include "FormulaTable.h"
+
+class TIterator;
+class TObjArray;
+class DelphesFormula;
+
+class CMMomentumSmearing: public DelphesModule
+{
+public:
+
+  CMMomentumSmearing();
+  ~CMMomentumSmearing();
+
+  void Init();
+  void Process();
+  void Finish();
+
+private:
+
+  Double_t LogNormal(Double_t mean, Double_t sigma);
+
+  DelphesFormula *fFormula; //!
+  FormulaTable fTable; //!
+
+  TIterator *fItInputArray; //!
+
+  const TObjArray *fInputArray; //!
+
+  TObjArray *fOutputArray; //!
+
+  ClassDef(CMMomentumSmearing, 1)
+};
+
+#endif
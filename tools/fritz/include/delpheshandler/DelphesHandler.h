@@ -1,12 +1,16 @@
 #ifndef _DELPHESHANDLER
 #define _DELPHESHANDLER
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
+#include <set>
 #include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 #include "TROOT.h"
 #include "TApplication.h"
@@ -21,6 +25,7 @@
 #include "modules/Delphes.h"
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesFormula.h"
 #include "classes/DelphesHepMCReader.h"
 #include "classes/DelphesSTDHEPReader.h"
 #include "classes/DelphesLHEFReader.h"
@@ -38,6 +43,7 @@
 #include "Global.h"
 #include "EventFile.h"
 #include "FritzConfig.h"
+#include "FormulaTable.h"
 
 class DelphesHandler {
     friend class AnalysisHandler;
@@ -79,6 +85,65 @@ public:
     //! Returns true if there are still events available
     bool hasNextEvent();
 
+    //! \brief Simulates the next detector replica of the current generator event
+    //!
+    //! With oversample = K, every generator event is passed K times through
+    //! Delphes with independent smearing. The first replica is produced by
+    //! processEvent().
+    //! \return False if all replicas of the event have been simulated
+    bool nextReplica();
+
+    //! \brief Registers loose truth level bounds of analyses using this handler
+    //!
+    //! Only used if autoveto is set. The veto uses the loosest bounds of all
+    //! registered analyses, a bound of 0 disables the respective cut. The
+    //! bounds have to be declared by the analyses with
+    //! AnalysisBase::declareTruthBounds(): a single analysis without bounds
+    //! disables the veto for all of them.
+    //! \param metMin minimum truth missing transverse momentum
+    //! \param leadingPTMin minimum pT of the leading lepton or jet
+    //! \param htMin minimum scalar sum of the visible transverse momenta
+    void addTruthBounds(double metMin, double leadingPTMin, double htMin);
+
+    //! \brief Registers an AnalysisHandler that reads the events of this handler
+    //!
+    //! The replicas of oversample are simulated while the first AnalysisHandler
+    //! processes an event, further handlers would only see the last replica.
+    //! The combination is therefore rejected.
+    //! \param handlerName name of the AnalysisHandler for the error message
+    void addAnalysisHandler(std::string handlerName);
+
+    //! \brief Registers the branches an AnalysisHandler reads from this handler
+    //!
+    //! Without an output file, initialiseModules() only runs the modules
+    //! needed for the registered branches.
+    //! \param branches names of the TreeWriter branches, e.g. Jet or Tower
+    void requireBranches(const std::set<std::string>& branches);
+
+    //! \brief Requests the TaggingParticle branch with the truth b, c and taus
+    //!
+    //! The branch is filled by an extra TaggingParticlesSkimmer added to the
+    //! detector card, such that the full Particle branch is not needed for
+    //! the truth matching of the taggers. It uses the loosest bounds of all
+    //! handlers that requested it.
+    //! \param ptMin minimum pT of the truth particles
+    //! \param etaMax maximum absolute pseudorapidity of the truth particles
+    void requireTaggingParticles(double ptMin, double etaMax);
+
+    //! \brief Reads the detector card and initialises the Delphes modules
+    //!
+    //! Has to be called after all AnalysisHandlers registered their branches.
+    void initialiseModules();
+
+    //! Returns true if the events are read from a file instead of a PythiaHandler
+    bool readsEventFile();
+
+    //! \brief Continues with the events of another file, for parameter scans
+    //!
+    //! The Delphes modules stay initialised, only the input is exchanged.
+    //! \param eventFile new event file, must have the format of the current one
+    void startJob(EventFile eventFile);
+
     //! Returns the cross section of the events processed by Delphes
     double getCrossSection();
 
@@ -106,16 +171,44 @@ private:
     void setupCommon(Properties props);
     //! Link Delphes to event file
     void setup(Properties props, EventFile eventFile);
+    //! Determines the DelphesMode of an event file from its first line
+    static int eventFileMode(std::string fileName);
+    //! Open the event file and pass it to the reader
+    void openEventFile(std::string inputEventFileName);
     //! Set up Delphes object and potentially create output .root file
     void initialiseDelphes(std::string configFile,
                            std::string logFile,
                            std::string outputRootFileName);
+    //! Writes a copy of the detector card adapted to this run
+    /** Unused modules and branches are removed, and modules with piecewise
+     *  constant formulas are replaced by the CheckMATE versions using lookup tables.
+     *  The new card gets a unique name next to the Delphes log file and is
+     *  removed once Delphes has read it.
+     *  \return path of the new card, the original one if nothing changes */
+    std::string rewriteConfigFile();
+    // Runs the Delphes modules on the current event and measures their time
+    void runModules();
     // in case of pHandler mode, translate Pythia event into Delphes event
     void readPythiaEvent(int iEvent);
+    // Applies the truth level preselection on the read event, sets eventVetoed
+    bool vetoEvent();
+    // Stores copies of the input particles of the current event for the replicas
+    void cacheInputParticles();
+    // Refills the (cleared) input arrays from the cached particles
+    void restoreInputParticles();
+    // Deletes the cached input particles
+    void clearInputCache();
     
     // These are needed to read in events and process them further
     Delphes *mainDelphes;
     std::string delphesLogFile;
+    std::string delphesConfigFile;
+    bool compiledFormulas; // if piecewise constant formulas use lookup tables
+    bool haveRequiredBranches; // if an analysis handler has registered its branches
+    std::set<std::string> requiredBranches;
+    bool haveTaggingParticles; // if the TaggingParticle branch was requested
+    double taggingPTMin; // loosest truth bounds of the TaggingParticle branch
+    double taggingEtaMax;
     DelphesFactory *factory;
     ExRootTreeWriter *treeWriter;
     ExRootConfReader *confReader;
@@ -123,6 +216,7 @@ private:
 
     // this information is determined individually for a given event
     ExRootTreeBranch *branchEvent;
+    ExRootTreeBranch *branchWeight; //!< weight variations of the event, NULL for STDHEP input
     TObjArray *stableParticleOutputArray;
     TObjArray *allParticleOutputArray;
     TObjArray *partonOutputArray;
@@ -138,6 +232,11 @@ private:
     //only defined in hepmc or stdhep mode
     TStopwatch* readStopWatch;
     TStopwatch* procStopWatch;
+    double procTime; // total time spent in the Delphes modules
+    Long64_t nSimulatedEvents; // number of passes through the Delphes modules
+
+    // only defined in event file read mode
+    FILE* inputFile;
 
     // only defined in hepmc read mode
     DelphesHepMCReader*  dHepmcReader;
@@ -150,6 +249,25 @@ private:
 
     // indicates if there are still events available
     bool hasEvents;
+
+    // truth level preselection before the detector simulation
+    bool truthVeto; // if any veto bound is set
+    bool autoVeto; // if the bounds are taken from the analyses
+    bool haveAutoBounds; // if an analysis handler has registered its bounds yet
+    double vetoMETMin; // minimum truth missing transverse momentum
+    double vetoLeadingPTMin; // minimum leading lepton pT or visible HT
+    double vetoHTMin; // minimum visible HT
+    bool eventVetoed; // if the current event failed the preselection
+    Long64_t nVetoedEvents;
+
+    // detector simulation replicas per generator event
+    int oversample; // number of Delphes passes per event
+    int currentReplica; // index of the currently simulated pass
+    std::vector<std::string> analysisHandlers; // names of the linked AnalysisHandlers
+    std::vector<Candidate*> cachedParticles; // copies of the input particles
+    std::vector<int> cachedAllParticles; // indices in cachedParticles for each array
+    std::vector<int> cachedStableParticles;
+    std::vector<int> cachedPartons;
     
     EventFile eventFile;
 
@@ -0,0 +1,60 @@
+#ifndef _FORMULATABLE
+#define _FORMULATABLE
+
+#include <string>
+#include <vector>
+
+class DelphesFormula;
+
+//! Lookup table replacement for piecewise constant Delphes formulas
+/** The efficiency and resolution formulas of the detector cards are usually
+ *  sums of products of bin conditions like (abs(eta) <= 1.5) * (pt > 1.0)
+ *  and constants. If every variable of a formula only appears in comparisons
+ *  with numbers, the formula is constant between these numbers. The table
+ *  stores the value of every such cell, evaluated once by the DelphesFormula
+ *  of the card, such that the lookup gives exactly the results of the formula.
+ */
+class FormulaTable {
+public:
+    //! Standard Constructor
+    FormulaTable();
+
+    //! \brief Checks if a formula can be tabulated
+    //!
+    //! \param expression formula as written in the detector card, using
+    //!  the variables pt, eta, phi and energy
+    static bool tabulable(std::string expression);
+
+    //! \brief Fills the table
+    //!
+    //! \param expression formula as written in the detector card
+    //! \param formula compiled Delphes version of the same expression, used
+    //!  to fill the table and for NaN input
+    //! \return False if the formula can not be tabulated
+    bool compile(std::string expression, DelphesFormula* formula);
+
+    //! Returns the value of the formula, same arguments as DelphesFormula::Eval
+    double eval(double pt, double eta, double phi, double energy);
+
+    //! A variable the formula depends on, possibly via its absolute value
+    struct table_key {
+        int variable; // index in pt, eta, phi, energy
+        bool absolute; // the formula uses abs(variable)
+        std::vector<double> bounds; // sorted numbers the variable is compared with
+        int stride; // distance of neighbouring cells of this key in values
+    };
+
+private:
+    // Collects the keys of expression, returns false if it can not be tabulated
+    static bool findKeys(std::string expression, std::vector<table_key>& keys);
+    // Index of the cell of x: 2i for the interval below bounds[i], 2i+1 for bounds[i]
+    static int cell(const std::vector<double>& bounds, double x);
+    // A value inside the given cell
+    static double representative(const table_key& key, int cell);
+
+    std::vector<table_key> keys;
+    std::vector<double> values;
+    DelphesFormula* formula;
+};
+
+#endif
@@ -162,4 +162,12 @@ class Parser {
  */
 Config parseConfigFile(std::string path);
 
+//! Parses a configuration from a stream
+/*!
+ * \input in the stream with the contents of a configuration file
+ * \result the contents read into a map
+ * \exception if parsing fails
+ */
+Config parseConfigStream(std::istream &in);
+
 #endif // CONFIG_PARSER_H_
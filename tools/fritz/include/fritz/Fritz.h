@@ -87,6 +87,9 @@ class Fritz {
         //! Takes the config and initializes all analysis handlers
         void setupAnalysisHandler(Config conf);
 
+        //! Initialises the Delphes modules and links the analysis handlers to them
+        void linkHandlers();
+
         //! Read the contents of a global section
         void setupGlobal(Config conf);
 
@@ -97,6 +100,50 @@ class Fritz {
          */
         bool processEvent(int iEvent);
 
+        //! Runs the event loop over the current input of all handlers
+        void runEventLoop();
+
+        //! Takes the config and reads all scan jobs
+        void setupScanJobs(Config conf);
+
+        //! Switches all handlers to the scan job with the given label
+        void startScanJob(std::string label);
+
+        //! Runs all scan jobs
+        /** \param afterInitialRun if the results of a previous run have to be
+         *   written before the first job is started
+         */
+        void runScanJobs(bool afterInitialRun);
+
+        //! Accepts jobs on serveSocket until an interrupt signal arrives
+        /** Every job config is run by runServedJob() in a forked child, which
+         *  shares the initialised handlers copy-on-write with the daemon.
+         */
+        void serve();
+
+        //! Reads a job config from a client and runs its ScanJob sections
+        /** Runs in a forked child and exits, such that a slow or stuck
+         *  client never blocks the daemon from accepting further jobs.
+         *  \param fd connection to the client, which sends the job config
+         *   and receives all output
+         */
+        void runServedJob(int fd);
+
+        //! Checks if the analyses have enough statistics to stop early
+        /** The check only runs every stopCheck events, starting after
+         *  stopMinEvents events. Note that the stop is data dependent: a
+         *  region is more likely to reach the target right after an upward
+         *  fluctuation of its yield, so the yield of the region which
+         *  triggered the stop is biased (upwards for stopPrecision and the
+         *  exclusion, downwards for the allowed case). The bias shrinks with
+         *  the number of events before the first check, stopMinEvents
+         *  should therefore not be set too low.
+         *  \return True if all analyses reached stopPrecision, or if the
+         *   model is excluded or allowed by more than stopSigma standard
+         *   deviations of r = S/S95.
+         */
+        bool precisionReached();
+
         //! Static function to catch interrupt signals
         /* If an interrupt signal comes in, interrupted is set to true.
          * \param num parameter that depends on the type of signal (not used)
@@ -121,7 +168,17 @@ class Fritz {
         int nEvents; //!< Total number of events to be processed
         bool haveRandomSeed; //!< Has randomSeed been set
         int randomSeed; //!< Random seed for this run
+        std::string serveSocket; //!< Unix socket of the daemon mode, empty otherwise
+        int stopCheck; //!< Events between two precision checks, 0 disables them
+        int stopMinEvents; //!< Events before the first precision check
+        double stopPrecision; //!< Relative error of the signal regions to stop at
+        double stopSigma; //!< Distance of r from 1 in standard deviations to stop at
         static bool interupted; //!< set to true if interrupt signal is called
+
+        //! Further jobs of a parameter scan, run after the initial configuration
+        /** Map from the label of the ScanJob section to the event file
+         *  and output prefix of the job. */
+        std::map<std::string,std::pair<EventFile,std::string> > scanJobs;
 };
 
 #endif /* FRITZ_H_ */
@@ -16,11 +16,13 @@ const std::string keyTauTagSection = "tautag";
 const std::string keyElectronIsoSection = "electroniso";
 const std::string keyMuonIsoSection = "muoniso";
 const std::string keyPhotonIsoSection = "photoniso";
+const std::string keyEffUniverseSection = "effuniverse";
 const std::string keyAnalysisSection = "analysis";
 const std::string keyEventFileSection = "eventfile";
 const std::string keyPythiaHandlerSection = "pythiahandler";
 const std::string keyDelphesHandlerSection = "delpheshandler";
 const std::string keyAnalysisHandlerSection = "analysishandler";
+const std::string keyScanJobSection = "scanjob";
 
 //! A map for each section from key to value
 typedef std::map<std::string, std::string> Properties;
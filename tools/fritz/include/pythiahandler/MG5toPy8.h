@@ -5,6 +5,11 @@
 #include "Pythia8Plugins/GeneratorInput.h"
 #include <unistd.h>
 #include <sys/stat.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <signal.h>
+#include <errno.h>
 
 using namespace std;
 
@@ -54,6 +59,21 @@ namespace Pythia8 {
 // for NLO generation with aMC@NLO as the grid initialization
 // can be skipped after the initial run.
 
+// Fritz addition: with setCache, compiled process directories are
+// stored in a cache directory, keyed by a hash of the configure and
+// generate commands, the files of the imported models, the MadGraph
+// configuration card and the MadGraph version. Runs with the same
+// process (e.g. scan points which only change the param card) then
+// copy the cached directory instead of running the generate stage.
+
+// Fritz addition: with setDoubleBuffer, every further batch of events
+// is generated in the background in a copy of the run directory
+// ("<dir>_b") while Pythia showers the current batch. The reader then
+// alternates between the two directories. A batch is only started in
+// the background while fewer events have been requested from MadGraph
+// than Pythia is set to generate (Main:numberOfEvents), a pending
+// batch is killed when the object is destroyed.
+
 class LHAupMadgraph : public LHAup {
 
 public:
@@ -80,6 +100,12 @@ public:
   // Set the random seed and maximum runs.
   bool setSeed(int seedIn, int runsIn = 30081);
 
+  // Set the directory of cached process directories and the MadGraph version.
+  void setCache(string cacheDirIn, string versionIn);
+
+  // Generate the next batch of events in the background.
+  void setDoubleBuffer(bool doubleBufferIn);
+
   // Set the initialization information.
   bool setInit();
 
@@ -100,12 +126,36 @@ protected:
   // Run the generate stage of MadGraph.
   bool generate();
 
+  // Copy the user provided cards into the process directory.
+  void copyCards();
+
+  // Key of the process directory in the cache.
+  string cacheKey();
+
+  // Content of a file, empty if it can not be read.
+  string fileContent(string path);
+
+  // Copy a cached process directory into the run directory.
+  bool restoreCache();
+
+  // Store the generated process directory in the cache.
+  bool storeCache();
+
   // Run the launch stage of MadGraph.
   bool launch();
 
   // Run MadGraph.
   bool run(int eventsIn, int seedIn = -1);
 
+  // Start a MadGraph run in directory iDir, in the background if requested.
+  bool start(int iDir, int eventsIn, int seedIn, bool async);
+
+  // Whether Pythia may need more events than requested from MadGraph.
+  bool needMore();
+
+  // Wait for the background run and switch the reader to its directory.
+  bool finish();
+
   // Create the LHEF reader.
   bool reader(bool init);
 
@@ -114,9 +164,9 @@ protected:
   LHAupLHEF *lhef;
 
   // Stored members.
-  int events, seed, runs, nRuns, jets;
-  bool match, amcatnlo;
-  string dir, exe, lhegz;
+  int events, seed, runs, nRuns, jets, nRequested;
+  bool match, amcatnlo, doubleBuffer;
+  string dir, exe, lhegz, cacheDir, version;
   double sigWgt, wgt;
   vector< pair<string, string> > cards;
 
@@ -126,6 +176,12 @@ protected:
   // Vector of whether a command stage has been overridden by the user.
   vector<bool> override;
 
+  // The run directories for double buffering, the one currently read,
+  // and whether a background run is in progress.
+  string dirs[2];
+  int iCurrent;
+  bool pending;
+
 };
 
 // Constructor.
@@ -133,8 +189,11 @@ protected:
 LHAupMadgraph::LHAupMadgraph(Pythia *pythiaIn, bool matchIn, string dirIn,
                              string exeIn) :
   pythia(pythiaIn), lhef(0), events(10000), seed(-1), runs(30081),
-  nRuns(0), jets(-1), match(matchIn), dir(dirIn), exe(exeIn),
-  lhegz(dirIn + "/Events/run/unweighted_events.lhe"), override(vector<bool>(3, false)) {
+  nRuns(0), jets(-1), nRequested(0), match(matchIn), dir(dirIn), exe(exeIn),
+  lhegz(dirIn + "/Events/run/unweighted_events.lhe"), override(vector<bool>(3, false)),
+  iCurrent(0), pending(false) {
+  doubleBuffer = false;
+  dirs[0] = dir; dirs[1] = dir + "_b";
   mkdir(dir.c_str(), 0777);
   if (pythia) pythia->readString("Beams:frameType = 5");
 }
@@ -143,7 +202,17 @@ LHAupMadgraph::LHAupMadgraph(Pythia *pythiaIn, bool matchIn, string dirIn,
 
 // Destructor.
 
-LHAupMadgraph::~LHAupMadgraph() {if (lhef) delete lhef;}
+// The events of a background run are not needed any more, so its
+// process group (see start()) is killed instead of waited for.
+
+LHAupMadgraph::~LHAupMadgraph() {
+  if (pending) {
+    ifstream pidFile((dirs[1 - iCurrent] + "/run.pid").c_str());
+    int pid = 0;
+    if (pidFile >> pid && pid > 0) kill(-pid, SIGTERM);
+  }
+  if (lhef) delete lhef;
+}
 
 //--------------------------------------------------------------------------
 
@@ -240,6 +309,32 @@ bool LHAupMadgraph::setSeed(int seedIn, int runsIn) {
 
 //--------------------------------------------------------------------------
 
+// Set the directory of cached process directories.
+
+// The cache is only used if cacheDirIn is not empty. The version
+// string (e.g. the content of the MadGraph VERSION file) enters the
+// cache key, such that process directories of different MadGraph
+// versions are not mixed.
+
+void LHAupMadgraph::setCache(string cacheDirIn, string versionIn) {
+  cacheDir = cacheDirIn; version = versionIn;
+  if (cacheDir != "") mkdir(cacheDir.c_str(), 0777);
+}
+
+//--------------------------------------------------------------------------
+
+// Generate the next batch of events in the background.
+
+// This needs a second copy of the run directory, but the MadGraph
+// generation of the next batch then overlaps with the showering of
+// the current one.
+
+void LHAupMadgraph::setDoubleBuffer(bool doubleBufferIn) {
+  doubleBuffer = doubleBufferIn;
+}
+
+//--------------------------------------------------------------------------
+
 // Set the number of events to generate per MadGraph run, the default is 10000.
 
 void LHAupMadgraph::setEvents(int eventsIn) {events = eventsIn;}
@@ -305,15 +400,129 @@ bool LHAupMadgraph::generate() {
   }
 
   orig.close();
+  return true;
+
+}
+
+//--------------------------------------------------------------------------
 
-  // Copy over any user provided configuration cards.
+// Copy over any user provided configuration cards.
+
+void LHAupMadgraph::copyCards() {
   for (int iCard = 0; iCard < (int)cards.size(); ++iCard) {
     ifstream src((cards[iCard].first).c_str(), ios::binary);
     ofstream dst((dir + "/Cards/" + cards[iCard].second).c_str(), ios::binary);
     dst << src.rdbuf();
   }
-  return true;
+}
+
+//--------------------------------------------------------------------------
+
+// Key of the process directory in the cache.
+
+// The 64 bit FNV-1a hash of everything which determines the process
+// directory: the configure and generate commands, the files of every
+// model imported from the MadGraph models directory (restrictions
+// like "sm-no_b_mass" select a card inside the model directory) and
+// the user cards which configure MadGraph itself. The param and run
+// cards are not included: they only enter at the launch stage and are
+// copied into the process directory after a restore, such that scan
+// points which only change them reuse the process. Launch settings are
+// not included either.
+
+string LHAupMadgraph::cacheKey() {
+  string content = version + "\n";
+  for (int iLine = 0; iLine < (int)configureLines.size(); ++iLine)
+    content += "configure " + configureLines[iLine] + "\n";
+  string models = exe.substr(0, exe.rfind("/bin/")) + "/models/";
+  for (int iLine = 0; iLine < (int)generateLines.size(); ++iLine) {
+    content += generateLines[iLine] + "\n";
+    stringstream line(generateLines[iLine]);
+    string command, object, model;
+    line >> command >> object >> model;
+    if (command != "import" || object != "model" || model == "") continue;
+    string modelDir = model;
+    if (access(modelDir.c_str(), F_OK) == -1)
+      modelDir = models + model.substr(0, model.find('-'));
+    DIR *files = opendir(modelDir.c_str());
+    if (!files) continue;
+    vector<string> names;
+    while (dirent *file = readdir(files)) names.push_back(file->d_name);
+    closedir(files);
+    sort(names.begin(), names.end());
+    for (int iFile = 0; iFile < (int)names.size(); ++iFile)
+      content += "model " + names[iFile] + "\n"
+        + fileContent(modelDir + "/" + names[iFile]);
+  }
+  if (override[Generate]) content += "override\n";
+  for (int iCard = 0; iCard < (int)cards.size(); ++iCard) {
+    if (cards[iCard].second == "param_card.dat"
+        || cards[iCard].second == "run_card.dat") continue;
+    content += "card " + cards[iCard].second + "\n"
+      + fileContent(cards[iCard].first);
+  }
+  uint64_t hash = 14695981039346656037ULL;
+  for (int i = 0; i < (int)content.size(); ++i) {
+    hash ^= (unsigned char)content[i];
+    hash *= 1099511628211ULL;
+  }
+  stringstream ss;
+  ss << hex << setfill('0') << setw(16) << hash;
+  return ss.str();
+}
+
+//--------------------------------------------------------------------------
+
+// Content of a file, empty if it can not be read.
+
+// Directories and other special files are skipped.
+
+string LHAupMadgraph::fileContent(string path) {
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) return "";
+  ifstream file(path.c_str(), ios::binary);
+  stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+//--------------------------------------------------------------------------
+
+// Copy a cached process directory into the run directory.
+
+// As with "output -f", any previous content of the run directory is
+// removed. Returns false if there is no cache entry for the process.
+
+bool LHAupMadgraph::restoreCache() {
+  if (cacheDir == "") return false;
+  string entry = cacheDir + "/" + cacheKey();
+  if (access((entry + "/Cards/run_card.dat").c_str(), F_OK) == -1)
+    return false;
+  cout << "Using cached MadGraph process directory " << entry << endl;
+  if (!execute("rm -rf " + dir + " && mkdir -p " + dir
+               + " && cp -a " + entry + "/. " + dir + "/")) return false;
+  return access((dir + "/Cards/run_card.dat").c_str(), F_OK) != -1;
+}
 
+//--------------------------------------------------------------------------
+
+// Store the generated process directory in the cache.
+
+// The directory is copied to a temporary name first and then renamed,
+// such that parallel runs never see incomplete cache entries. If
+// another run stored the same process in the meantime, the copy is
+// dropped.
+
+bool LHAupMadgraph::storeCache() {
+  if (cacheDir == "") return true;
+  string entry = cacheDir + "/" + cacheKey();
+  stringstream tmp;
+  tmp << entry << ".tmp" << getpid();
+  if (!execute("rm -rf " + tmp.str() + " && cp -a " + dir + " " + tmp.str()))
+    return false;
+  if (rename(tmp.str().c_str(), entry.c_str()) != 0)
+    execute("rm -rf " + tmp.str());
+  return true;
 }
 
 //--------------------------------------------------------------------------
@@ -357,14 +566,33 @@ bool LHAupMadgraph::launch() {
   cout << "Unzipping events" << endl;
   if (!execute("cd " + dir +"/Events/run; gunzip unweighted_events.lhe.gz"))
     return false;
-  
-  /* fstream script((dir + "/run.sh").c_str(), ios::out); */
-  /* script << "#!/usr/bin/env bash\n" */
-  /* 	 << "sed -i \"s/.*= *nevents/$1 = nevents/g\" ./Cards/run_card.dat\n" */
-  /* 	 << "sed -i \"s/.*= *iseed/$2 = iseed/g\" ./Cards/run_card.dat\n" */
-  /* 	 << "./bin/generate_events --parton --nocompile --only_generation " */
-  /* 	 << "--force --name run\n"; */
-  /* script.close(); execute("chmod 755 " + dir + "/run.sh"); */
+
+  // Script for the further batches, which reuses the compiled process.
+  fstream script((dir + "/run.sh").c_str(), ios::out);
+  script << "#!/usr/bin/env bash\n"
+	 << "rm -rf ./Events/run\n"
+	 << "sed -i \"s/.*= *nevents/$1 = nevents/g\" ./Cards/run_card.dat\n"
+	 << "sed -i \"s/.*= *iseed/$2 = iseed/g\" ./Cards/run_card.dat\n"
+	 << "./bin/generate_events --parton --nocompile --only_generation "
+	 << "--force --name run\n"
+	 << "gunzip -f ./Events/run/unweighted_events.lhe.gz\n";
+  script.close(); execute("chmod 755 " + dir + "/run.sh");
+
+  // The first batch has the number of events of the run card.
+  fstream card((dir + "/Cards/run_card.dat").c_str(), ios::in);
+  string line;
+  nRequested = 0;
+  while (getline(card, line))
+    if (line.find("= nevents") != string::npos) {
+      stringstream(line) >> nRequested; break;}
+  card.close();
+
+  // Start the second batch right away in a copy of the run directory.
+  if (doubleBuffer && needMore()) {
+    if (!execute("rm -rf " + dirs[1] + " && cp -a " + dir + " " + dirs[1]))
+      return false;
+    if (!start(1, events, -1, true)) return false;
+  }
 
   return true;
 
@@ -375,13 +603,27 @@ bool LHAupMadgraph::launch() {
 // Run MadGraph.
 
 bool LHAupMadgraph::run(int eventsIn, int seedIn) {
+  return start(iCurrent, eventsIn, seedIn, false);
+}
+
+//--------------------------------------------------------------------------
+
+// Start a MadGraph run in directory iDir.
+
+// Asynchronous runs write a run.done marker when finished, see
+// finish(). They run in a session of their own, whose id is written to
+// run.pid, such that the destructor can kill MadGraph with all its
+// subprocesses.
+
+bool LHAupMadgraph::start(int iDir, int eventsIn, int seedIn, bool async) {
 
   if (!pythia) return false;
   if (nRuns >= runs) {
     pythia->info.errorMsg("Error from LHAupMadgraph::run: maximum number "
                           "of allowed runs exceeded."); return false;}
 
-  if (access((dir + "/run.sh").c_str(), F_OK) == -1){
+  string runDir = dirs[iDir];
+  if (access((runDir + "/run.sh").c_str(), F_OK) == -1){
     pythia->info.errorMsg("Error from LHAupMadgraph::run: "
                           "Cannot find run.sh."); return false;}
 
@@ -391,7 +633,17 @@ bool LHAupMadgraph::run(int eventsIn, int seedIn) {
   
   if (seedIn < 0) seedIn = (seed - 1) * runs + nRuns + 1;
   stringstream line;
-  line << "cd " + dir + "; ./run.sh " << eventsIn << " " << seedIn;
+  if (async) {
+    line << "cd " + runDir + "; rm -f run.done; setsid sh -c './run.sh "
+         << eventsIn << " " << seedIn << " > run.log 2>&1; touch run.done' "
+         << "> /dev/null 2>&1 & echo $! > run.pid";
+    if (!execute(line.str())) return false;
+    pending = true;
+    ++nRuns;
+    nRequested += eventsIn;
+    return true;
+  }
+  line << "cd " + runDir + "; ./run.sh " << eventsIn << " " << seedIn;
   if (!execute(line.str())) return false;
   if (access(lhegz.c_str(), F_OK) == -1) {
 
@@ -401,6 +653,64 @@ bool LHAupMadgraph::run(int eventsIn, int seedIn) {
   }
   
   ++nRuns;
+  nRequested += eventsIn;
+  return true;
+
+}
+
+//--------------------------------------------------------------------------
+
+// Whether Pythia may need more events than requested from MadGraph.
+
+// Without a number of events set in Pythia, all events of MadGraph are
+// read. Events vetoed by the matching are not accounted for, if more
+// are needed they are generated without double buffering.
+
+bool LHAupMadgraph::needMore() {
+  int nEvents = pythia->settings.mode("Main:numberOfEvents");
+  return nEvents <= 0 || nRequested < nEvents;
+}
+
+//--------------------------------------------------------------------------
+
+// Wait for the background run and switch the reader to its directory.
+
+bool LHAupMadgraph::finish() {
+
+  if (!pending) {
+    pythia->info.errorMsg("Error from LHAupMadgraph::finish: "
+                          "no MadGraph run in progress."); return false;}
+  int iNext = 1 - iCurrent;
+  pending = false;
+  string done = dirs[iNext] + "/run.done";
+  ifstream pidFile((dirs[iNext] + "/run.pid").c_str());
+  int pid = 0;
+  if (!(pidFile >> pid) || pid <= 0) {
+    pythia->info.errorMsg("Error from LHAupMadgraph::finish: could not read "
+                          "the process id of the MadGraph run.");
+    return false;
+  }
+  // The marker is written by the process itself, if it has gone without
+  // writing it, the run was killed. Remaining MadGraph subprocesses of
+  // its session are stopped.
+  while (access(done.c_str(), F_OK) == -1) {
+    if (kill(pid, 0) == -1 && errno == ESRCH
+        && access(done.c_str(), F_OK) == -1) {
+      kill(-pid, SIGTERM);
+      pythia->info.errorMsg("Error from LHAupMadgraph::finish: MadGraph run "
+                            "terminated without finishing, see "
+                            + dirs[iNext] + "/run.log.");
+      return false;
+    }
+    sleep(1);
+  }
+  iCurrent = iNext;
+  lhegz = dirs[iCurrent] + "/Events/run/unweighted_events.lhe";
+  if (access(lhegz.c_str(), F_OK) == -1) {
+    pythia->info.errorMsg("Error from LHAupMadgraph::finish: could not read "
+                          "LHEfile, see " + dirs[iCurrent] + "/run.log.");
+    return false;
+  }
   return true;
 
 }
@@ -451,12 +761,21 @@ bool LHAupMadgraph::setInit() {
   // Initialize MadGraph.
   if (!pythia) return false;
   //  if (access((dir + "/run.sh").c_str(), F_OK) == -1) {
+  // A cached directory replaces the run directory, so the configuration
+  // is only written afterwards.
+  bool cached = restoreCache();
   if (!configure()) {
     pythia->info.errorMsg("Error from LHAupMadgraph::setInit: failed to "
 			  "create the MadGraph configuration"); return false;}
-  if (!generate()) {
-    pythia->info.errorMsg("Error from LHAupMadgraph::setInit: failed to "
-			  "generate the MadGraph process"); return false;}
+  if (!cached) {
+    if (!generate()) {
+      pythia->info.errorMsg("Error from LHAupMadgraph::setInit: failed to "
+                            "generate the MadGraph process"); return false;}
+    if (!storeCache())
+      pythia->info.errorMsg("Warning from LHAupMadgraph::setInit: failed to "
+                            "store the MadGraph process in the cache");
+  }
+  copyCards();
   if (!launch()) {
     pythia->info.errorMsg("Error from LHAupMadgraph::setInit: failed to "
                             "launch the MadGraph process"); return false;}
@@ -485,8 +804,17 @@ bool LHAupMadgraph::setEvent(int) {
     pythia->info.errorMsg("Error from LHAupMadgraph::setEvent: LHEF "
                           "event file was not found"); return false;}
   if (!lhef->setEvent()) {
-    if (!run(events)) return false;
-    if (!reader(false)) return false;
+    if (pending) {
+      // Read the batch generated in the background and start the next
+      // one in the directory just read, if further events are needed.
+      if (!finish()) return false;
+      if (!reader(false)) return false;
+      if (doubleBuffer && needMore()
+          && !start(1 - iCurrent, events, -1, true)) return false;
+    } else {
+      if (!run(events)) return false;
+      if (!reader(false)) return false;
+    }
     lhef->setEvent();
   }
 
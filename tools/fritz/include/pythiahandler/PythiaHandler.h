@@ -106,6 +106,8 @@ private:
     std::string mgParamCard; //!< path to param card 
     std::string mgRunPath; //!< path to param card 
     std::string mgSourcePath; //!< path to MadGraph source directory
+    std::string mgCachePath; //!< directory of cached process directories, not mandatory
+    bool mgDoubleBuffer; //!< if the next batch of events is generated in the background
     Pythia8::LHAupMadgraph* madgraph;
 
 };
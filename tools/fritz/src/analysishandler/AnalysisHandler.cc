@@ -4,7 +4,9 @@ AnalysisHandler::AnalysisHandler() {
     doJetTauTags = false;
     eventWeight = 0;
     branchGenParticle = NULL;
+    branchTaggingParticle = NULL;
     branchEvent = NULL;
+    branchWeight = NULL;
     branchElectron = NULL;
     branchMuon = NULL;
     branchJet = NULL;
@@ -13,19 +15,29 @@ AnalysisHandler::AnalysisHandler() {
     branchTrack = NULL;
     branchTower = NULL;
     dHandler = NULL;
+    readingReplica = false;
     missingET = NULL;
     rootFileChain = NULL;
     treeReader = NULL;
     analysisLogFile = "analysis";
     hasEvents = true;
+    currentUniverse = NULL;
+    probabilistic = false;
+    minConfigurationWeight = 0.01;
+    pathPosition = 0;
+    configurationWeight = 1.0;
     name = "analysishandler";
 }
 
 AnalysisHandler::~AnalysisHandler() {
     delete rootFileChain;
     delete treeReader;
+    delete missingET;
     for(int a = 0; a < listOfAnalyses.size(); a++)
         delete listOfAnalyses[a];
+    for(int u = 0; u < universeAnalyses.size(); u++)
+        for(int a = 0; a < universeAnalyses[u].size(); a++)
+            delete universeAnalyses[u][a];
 }
 
 // all known keys
@@ -39,11 +51,20 @@ static const std::string keyIsoDr = "dr";
 static const std::string keyIsoPTmin = "ptmin";
 static const std::string keyIsoMaxval = "maxval";
 static const std::string keyIsoAbsorrel = "absorrel";
+// efficiency universe
+static const std::string keyUniverseBTag = "btag";
+static const std::string keyUniverseCMistag = "cmistag";
+static const std::string keyUniverseLightMistag = "lightmistag";
+static const std::string keyUniverseTauTag = "tautag";
+static const std::string keyUniverseElectronID = "electronid";
+static const std::string keyUniverseMuonID = "muonid";
+static const std::string keyUniversePhotonID = "photonid";
 // analysis
 static const std::string keyAnalysisElectronIso = "electron_isolation";
 static const std::string keyAnalysisMuonIso = "muon_isolation";
 static const std::string keyAnalysisPhotonIso = "photon_isolation";
 static const std::string keyAnalysisBTags = "jet_btags";
+static const std::string keyAnalysisRefFile = "reffile";
 // analysishandler
 static const std::string keyAnalysisHandlerType = "analysistype";
 static const std::string keyAnalysisHandlerOutputFolder = "outputdirectory";
@@ -51,6 +72,8 @@ static const std::string keyAnalysisHandlerOutputPrefix = "outputprefix";
 static const std::string keyAnalysisHandlerDelphesHandler = "delpheshandler";
 static const std::string keyAnalysisHandlerEventFile = "eventfile";
 static const std::string keyAnalysisHandlerLogFile = "logfile";
+static const std::string keyAnalysisHandlerProbabilistic = "probabilistic";
+static const std::string keyAnalysisHandlerMinConfigWeight = "minconfigweight";
 
 static const void unknownKeysBTag(Properties props) {
     std::vector<std::string> knownKeys;
@@ -79,6 +102,20 @@ static const void unknownKeysIso(Properties props) {
     warnUnknownKeys(props,knownKeys,props["name"],"Unknown key in Isolation section");
 }
 
+static const void unknownKeysEffUniverse(Properties props) {
+    std::vector<std::string> knownKeys;
+    knownKeys.push_back(keyName);
+    knownKeys.push_back(keyHandler);
+    knownKeys.push_back(keyUniverseBTag);
+    knownKeys.push_back(keyUniverseCMistag);
+    knownKeys.push_back(keyUniverseLightMistag);
+    knownKeys.push_back(keyUniverseTauTag);
+    knownKeys.push_back(keyUniverseElectronID);
+    knownKeys.push_back(keyUniverseMuonID);
+    knownKeys.push_back(keyUniversePhotonID);
+    warnUnknownKeys(props,knownKeys,props["name"],"Unknown key in EffUniverse section");
+}
+
 static const void unknownKeysAnalysis(Properties props) {
     std::vector<std::string> knownKeys;
     knownKeys.push_back(keyName);
@@ -87,6 +124,7 @@ static const void unknownKeysAnalysis(Properties props) {
     knownKeys.push_back(keyAnalysisMuonIso);
     knownKeys.push_back(keyAnalysisPhotonIso);
     knownKeys.push_back(keyAnalysisBTags);
+    knownKeys.push_back(keyAnalysisRefFile);
     warnUnknownKeys(props,knownKeys,props["name"],"Unknown key in Analysis section");
 }
 
@@ -99,6 +137,8 @@ static const void unknownKeysAnalysisHandler(Properties props) {
     knownKeys.push_back(keyAnalysisHandlerDelphesHandler);
     knownKeys.push_back(keyAnalysisHandlerEventFile);
     knownKeys.push_back(keyAnalysisHandlerLogFile);
+    knownKeys.push_back(keyAnalysisHandlerProbabilistic);
+    knownKeys.push_back(keyAnalysisHandlerMinConfigWeight);
     warnUnknownKeys(props,knownKeys,props["name"],"Unknown key in AnalysisHandler section");
 }
 
@@ -235,6 +275,39 @@ std::map<std::string,int> AnalysisHandler::setupIsolation(
     return ids;
 }
 
+void AnalysisHandler::setupEffUniverses(
+        Config conf,
+        std::string handlerLabel
+        ) {
+    Sections sections = conf[keyEffUniverseSection];
+    std::map<std::string,Properties>::iterator it;
+    for (it=sections.begin(); it!=sections.end(); it++) {
+        std::string label = it->first;
+        Properties props = it->second;
+        std::string handler = lookupRequired(
+                props,
+                keyHandler,
+                props["name"],
+                "The analysis handler is required in effuniverse sections"
+                );
+        if (handler!=handlerLabel) {
+            continue;
+        }
+        unknownKeysEffUniverse(props);
+        efficiency_universe universe;
+        universe.label = label;
+        universe.bTag = lookupOrDefault(props, keyUniverseBTag, 1.0);
+        universe.cMistag = lookupOrDefault(props, keyUniverseCMistag, 1.0);
+        universe.lightMistag = lookupOrDefault(props, keyUniverseLightMistag, 1.0);
+        universe.tauTag = lookupOrDefault(props, keyUniverseTauTag, 1.0);
+        universe.electronID = lookupOrDefault(props, keyUniverseElectronID, 1.0);
+        universe.muonID = lookupOrDefault(props, keyUniverseMuonID, 1.0);
+        universe.photonID = lookupOrDefault(props, keyUniversePhotonID, 1.0);
+        effUniverses.push_back(universe);
+        universeAnalyses.push_back(std::vector<AnalysisBase*>());
+    }
+}
+
 //! \brief Link analysis to btag or isolation
 //!
 //! \param props The properties of the analysis
@@ -317,6 +390,18 @@ void AnalysisHandler::setupAnalyses(
                 "btag"
                 );
         bookAnalysis(label, whichTags, analysisParameters);
+        std::string refFile = lookupOrDefault(props, keyAnalysisRefFile, "");
+        if (refFile != "")
+            readReferenceFile(listOfAnalyses.back(), refFile);
+        // every efficiency universe gets its own copy of the analysis,
+        //  writing to outputPrefix_<universe>
+        for (int u = 0; u < effUniverses.size(); u++) {
+            std::map<std::string,std::string> universeParameters = analysisParameters;
+            universeParameters["outputPrefix"] += "_"+effUniverses[u].label;
+            listOfAnalyses.swap(universeAnalyses[u]);
+            bookAnalysis(label, whichTags, universeParameters);
+            listOfAnalyses.swap(universeAnalyses[u]);
+        }
     }
 }
 
@@ -351,6 +436,12 @@ void AnalysisHandler::setupAnalysisHandler(
         ) {
     std::pair<bool,std::string> pair;
     analysisLogFile = lookupOrDefault(props, keyAnalysisHandlerLogFile, "analysis");
+    probabilistic = (lookupOrDefault(props, keyAnalysisHandlerProbabilistic, "false") == "true");
+    minConfigurationWeight = lookupOrDefault(
+            props,
+            keyAnalysisHandlerMinConfigWeight,
+            minConfigurationWeight
+            );
     pair = maybeLookup(props, keyAnalysisHandlerEventFile);
     bool haveEventFile = pair.first;
     std::string eventFileLabel = pair.second;
@@ -404,6 +495,9 @@ void AnalysisHandler::setup(
     unknownKeysAnalysisHandler(props);
     std::map<std::string,int> bTagIds = setupBTags(conf, label);
     setupTauTag(conf, label);
+    setupEffUniverses(conf, label);
+    // seed 0 lets ROOT choose a unique seed
+    universeRandom.SetSeed(haveRandomSeed ? randomSeed : 0);
     std::map<std::string,int> electronIsoIds = setupIsolation(
             conf,
             label,
@@ -453,7 +547,13 @@ void AnalysisHandler::setup(EventFile file) {
     treeReader = new ExRootTreeReader(rootFileChain);
 
     branchEvent = treeReader->UseBranch("Event");
-    branchGenParticle = treeReader->UseBranch("Particle");
+    // the full Particle branch is only needed if the skimmed truth particles are missing
+    branchGenParticle = NULL;
+    branchTaggingParticle = NULL;
+    if(rootFileChain->GetBranch("TaggingParticle"))
+        branchTaggingParticle = treeReader->UseBranch("TaggingParticle");
+    else
+        branchGenParticle = treeReader->UseBranch("Particle");
     branchJet = treeReader->UseBranch("Jet");
     branchTrack = treeReader->UseBranch("Track");
     branchTower = treeReader->UseBranch("Tower");
@@ -461,8 +561,11 @@ void AnalysisHandler::setup(EventFile file) {
     branchMuon = treeReader->UseBranch("Muon");
     branchPhoton = treeReader->UseBranch("Photon");
     branchMissingET = treeReader->UseBranch("MissingET");
-    if(!branchGenParticle || !branchEvent || !branchJet || !branchTrack ||
-       !branchTower || !branchElectron || !branchMuon || !branchPhoton ||
+    // weight variations are optional and only present for suitable input
+    if(rootFileChain->GetBranch("Weight"))
+        branchWeight = treeReader->UseBranch("Weight");
+    if((!branchGenParticle && !branchTaggingParticle) || !branchEvent ||
+       !branchJet || !branchTrack || !branchTower || !branchElectron || !branchMuon || !branchPhoton ||
        !branchMissingET) {
         Global::abort(name,
                       "could not link all required branches to the "
@@ -475,7 +578,61 @@ void AnalysisHandler::setup(EventFile file) {
 
 void AnalysisHandler::setup( DelphesHandler* dHandlerIn) {
     dHandler = dHandlerIn;
+    dHandler->addAnalysisHandler(name);
+    // the branches only exist after the Delphes modules are initialised,
+    //  which may drop the modules of branches none of the handlers read
+    dHandler->requireBranches(requiredBranches());
+    // analyses may read the towers directly, e.g. for an isolation of their
+    //  own, so the booked isolation tags do not tell whether towers are needed
+    std::string towerAnalyses;
+    std::vector<AnalysisBase*> allAnalyses = listOfAnalyses;
+    for(int u = 0; u < universeAnalyses.size(); u++)
+        allAnalyses.insert(allAnalyses.end(), universeAnalyses[u].begin(), universeAnalyses[u].end());
+    for(int a = 0; a < allAnalyses.size(); a++)
+        if (allAnalyses[a]->ignoredObjects.count("towers") == 0)
+            towerAnalyses += " "+allAnalyses[a]->getAnalysisName();
+    if (towerAnalyses != "")
+        Global::print(name, "Keeping the Tower branch for the analyses which do not"
+                            " ignore(\"towers\"):"+towerAnalyses);
+    double ptMin, etaMax;
+    truthTaggingCuts(ptMin, etaMax);
+    dHandler->requireTaggingParticles(ptMin, etaMax);
+}
 
+std::set<std::string> AnalysisHandler::requiredBranches() {
+    std::set<std::string> branches;
+    branches.insert("TaggingParticle");
+    branches.insert("Jet");
+    branches.insert("Electron");
+    branches.insert("Muon");
+    branches.insert("Photon");
+    branches.insert("MissingET");
+    // the tau tagging of the experiment handlers counts the tracks in the
+    //  tau candidates
+    branches.insert("Track");
+
+    std::vector<isolation_tag_definition*> isoTags = listOfElectronTags;
+    isoTags.insert(isoTags.end(), listOfMuonTags.begin(), listOfMuonTags.end());
+    isoTags.insert(isoTags.end(), listOfPhotonTags.begin(), listOfPhotonTags.end());
+    for (int i = 0; i < isoTags.size(); i++)
+        if (isoTags[i]->source == "c")
+            branches.insert("Tower");
+
+    std::vector<AnalysisBase*> allAnalyses = listOfAnalyses;
+    for(int u = 0; u < universeAnalyses.size(); u++)
+        allAnalyses.insert(allAnalyses.end(), universeAnalyses[u].begin(), universeAnalyses[u].end());
+    for(int a = 0; a < allAnalyses.size(); a++) {
+        if (allAnalyses[a]->ignoredObjects.count("towers") == 0)
+            branches.insert("Tower");
+        if (allAnalyses[a]->ignoredObjects.count("tracks") == 0)
+            branches.insert("Track");
+    }
+    return branches;
+}
+
+void AnalysisHandler::linkDelphes() {
+    if (dHandler == NULL)
+        return;
     Global::print(name, "Linking to "+dHandler->name+" tree");
     // link all required branch pointers to the respective pointers
     //  within Delphes in the delphes handlers
@@ -486,6 +643,8 @@ void AnalysisHandler::setup( DelphesHandler* dHandlerIn) {
          it++) {
         if ((std::string)(*it)->GetData()->GetName() == "Particle")
                 branchGenParticle = (*it)->GetData();
+        else if ((std::string)(*it)->GetData()->GetName() == "TaggingParticle")
+                branchTaggingParticle = (*it)->GetData();
         else if ((std::string)(*it)->GetData()->GetName() == "Event")
                 branchEvent= (*it)->GetData();
         else if ((std::string)(*it)->GetData()->GetName() == "Jet")
@@ -502,14 +661,33 @@ void AnalysisHandler::setup( DelphesHandler* dHandlerIn) {
                 branchPhoton = (*it)->GetData();
         else if ((std::string)(*it)->GetData()->GetName() == "MissingET")
                 branchMissingET = (*it)->GetData();
+        else if ((std::string)(*it)->GetData()->GetName() == "Weight")
+                branchWeight = (*it)->GetData();
     }
-    if(!branchGenParticle || !branchEvent || !branchJet || !branchTrack ||
-       !branchTower || !branchElectron || !branchMuon || !branchPhoton ||
-       !branchMissingET) {
+    // the Tower branch is only kept if it is required, the Particle branch
+    //  is not needed if the card could be extended by the TaggingParticle branch
+    if((!branchGenParticle && !branchTaggingParticle) || !branchEvent || !branchJet || !branchTrack ||
+       (!branchTower && requiredBranches().count("Tower")) ||
+       !branchElectron || !branchMuon || !branchPhoton || !branchMissingET) {
         Global::abort(name,
                       "could not link all required branches to the"
                       +dHandler->name+" equivalents!");
     }
+    // the truth veto has to keep every event any of our analyses may select
+    double metMin = -1, leadingPTMin = -1, htMin = -1;
+    std::vector<AnalysisBase*> allAnalyses = listOfAnalyses;
+    for(int u = 0; u < universeAnalyses.size(); u++)
+        allAnalyses.insert(allAnalyses.end(), universeAnalyses[u].begin(), universeAnalyses[u].end());
+    for(int a = 0; a < allAnalyses.size(); a++) {
+        if (metMin < 0 || allAnalyses[a]->truthMETMin < metMin)
+            metMin = allAnalyses[a]->truthMETMin;
+        if (leadingPTMin < 0 || allAnalyses[a]->truthLeadingPTMin < leadingPTMin)
+            leadingPTMin = allAnalyses[a]->truthLeadingPTMin;
+        if (htMin < 0 || allAnalyses[a]->truthHTMin < htMin)
+            htMin = allAnalyses[a]->truthHTMin;
+    }
+    if (!allAnalyses.empty())
+        dHandler->addTruthBounds(metMin, leadingPTMin, htMin);
     Global::print(name,
                   "AnalysisHandler successfully linked to "+dHandler->name);
     initialize(); // virtual, defined by derived classes
@@ -522,17 +700,212 @@ bool AnalysisHandler::processEvent(int iEvent) {
     }
     if(!readParticles(iEvent))
         return false;
+    if (dHandler != NULL && dHandler->eventVetoed) {
+        countVetoedEvent();
+        return true;
+    }
+    if (dHandler == NULL || dHandler->oversample == 1) {
+        processReconstructedEvent(iEvent);
+        return true;
+    }
+    // the detector replicas of one generator event are correlated and
+    //  only count once in the statistics
+    startEventGroups();
+    processReconstructedEvent(iEvent);
+    readingReplica = true;
+    while (dHandler->nextReplica()) {
+        readParticles(iEvent);
+        processReconstructedEvent(iEvent);
+    }
+    readingReplica = false;
+    finishEventGroups();
+    return true;
+}
+
+void AnalysisHandler::processReconstructedEvent(int iEvent) {
+    randomDraws.clear();
+    reclustering.clear();
+    currentUniverse = NULL;
+    decisionIntervals.clear();
+    configurationPath.clear();
+    pathPosition = 0;
+    configurationWeight = 1.0;
     postProcessParticles();
-    linkObjects();
+    processConfigurations(iEvent);
+
+    // Efficiency universes only redo the efficiency dependent steps, with
+    //  the random numbers of the nominal pass
+    for(int u = 0; u < effUniverses.size(); u++) {
+        currentUniverse = &effUniverses[u];
+        decisionIntervals.clear();
+        configurationPath.clear();
+        pathPosition = 0;
+        configurationWeight = 1.0;
+        applyEfficiencies();
+        listOfAnalyses.swap(universeAnalyses[u]);
+        processConfigurations(iEvent);
+        listOfAnalyses.swap(universeAnalyses[u]);
+    }
+    currentUniverse = NULL;
+}
+
+void AnalysisHandler::processConfigurations(int iEvent) {
+    if (!probabilistic) {
+        linkObjects();
+        runAnalyses(iEvent);
+        return;
+    }
+    // all configurations of the event only count once in the statistics
+    for(int a = 0; a < listOfAnalyses.size(); a++)
+        listOfAnalyses[a]->startEventGroup();
+    while (true) {
+        linkObjects();
+        runAnalyses(iEvent);
+        if (pendingPaths.empty())
+            break;
+        configurationPath = pendingPaths.back();
+        pendingPaths.pop_back();
+        decisionIntervals.clear();
+        pathPosition = 0;
+        configurationWeight = 1.0;
+        applyEfficiencies();
+    }
+    for(int a = 0; a < listOfAnalyses.size(); a++)
+        listOfAnalyses[a]->finishEventGroup();
+}
+
+void AnalysisHandler::startEventGroups() {
+    for(int a = 0; a < listOfAnalyses.size(); a++)
+        listOfAnalyses[a]->startEventGroup();
+    for(int u = 0; u < universeAnalyses.size(); u++)
+        for(int a = 0; a < universeAnalyses[u].size(); a++)
+            universeAnalyses[u][a]->startEventGroup();
+}
+
+void AnalysisHandler::finishEventGroups() {
+    for(int a = 0; a < listOfAnalyses.size(); a++)
+        listOfAnalyses[a]->finishEventGroup();
+    for(int u = 0; u < universeAnalyses.size(); u++)
+        for(int a = 0; a < universeAnalyses[u].size(); a++)
+            universeAnalyses[u][a]->finishEventGroup();
+}
+
+void AnalysisHandler::countVetoedEvent() {
+    for(int a = 0; a < listOfAnalyses.size(); a++) {
+        listOfAnalyses[a]->weight = eventWeight;
+        listOfAnalyses[a]->weights = eventWeights;
+        listOfAnalyses[a]->countVetoedEvent();
+    }
+    for(int u = 0; u < universeAnalyses.size(); u++) {
+        for(int a = 0; a < universeAnalyses[u].size(); a++) {
+            universeAnalyses[u][a]->weight = eventWeight;
+            universeAnalyses[u][a]->weights = eventWeights;
+            universeAnalyses[u][a]->countVetoedEvent();
+        }
+    }
+}
+
+void AnalysisHandler::evaluateRecoBounds() {
+    // one summary of the event serves the bounds of all analyses: the number
+    //  of jets above a threshold and their HT follow from the sorted pTs
+    sortedJetPTs.clear();
+    for(int j = 0; j < jets.size(); j++)
+        sortedJetPTs.push_back(jets[j]->PT);
+    std::sort(sortedJetPTs.begin(), sortedJetPTs.end(), std::greater<double>());
+    jetPTSums.resize(sortedJetPTs.size()+1);
+    jetPTSums[0] = 0;
+    for(int j = 0; j < sortedJetPTs.size(); j++)
+        jetPTSums[j+1] = jetPTSums[j]+sortedJetPTs[j];
+
+    recoVetoed.assign(listOfAnalyses.size(), 0);
+    for(int a = 0; a < listOfAnalyses.size(); a++) {
+        AnalysisBase* analysis = listOfAnalyses[a];
+        if (analysis->recoMETMin > 0 && missingET->PT < analysis->recoMETMin) {
+            recoVetoed[a] = 1;
+            continue;
+        }
+        if (analysis->recoNJetsMin <= 0 && analysis->recoHTMin <= 0)
+            continue;
+        // jets with pT >= recoJetPTMin, like filterPhaseSpace() keeps them
+        int nJets = std::upper_bound(sortedJetPTs.begin(), sortedJetPTs.end(), analysis->recoJetPTMin,
+                                     std::greater<double>()) - sortedJetPTs.begin();
+        if (nJets < analysis->recoNJetsMin || (analysis->recoHTMin > 0 && jetPTSums[nJets] < analysis->recoHTMin))
+            recoVetoed[a] = 1;
+    }
+}
+
+void AnalysisHandler::runAnalyses(int iEvent) {
     for(int a = 0; a < listOfAnalyses.size(); a++) {
+        if (recoVetoed[a]) {
+            listOfAnalyses[a]->countVetoedEvent();
+            continue;
+        }
         Global::unredirect_cout(); // This needs to stay, don't ask why - I don't know either.
         Global::redirect_cout(analysisLogFile+"_"+listOfAnalyses[a]->analysis+".log");
         listOfAnalyses[a]->processEvent(iEvent);
-        //FIXME It must be possible to do this nicer...
-        delete listOfAnalyses[a]->missingET;
     }
     Global::unredirect_cout();
-    return true;
+}
+
+double AnalysisHandler::random(const void* object, int slot) {
+    std::pair<const void*,int> key(object, slot);
+    std::map<std::pair<const void*,int>, double>::iterator it = randomDraws.find(key);
+    if (it != randomDraws.end())
+        return it->second;
+    double r = uniform();
+    randomDraws[key] = r;
+    return r;
+}
+
+double AnalysisHandler::uniform() {
+    if (currentUniverse != NULL)
+        return universeRandom.Rndm();
+    return rand()/(RAND_MAX+1.);
+}
+
+bool AnalysisHandler::passes(const void* object, int slot, double eff) {
+    if (!probabilistic)
+        return random(object, slot) < eff;
+
+    std::pair<const void*,int> key(object, slot);
+    std::map<std::pair<const void*,int>, decision_interval>::iterator it =
+            decisionIntervals.find(key);
+    if (it == decisionIntervals.end()) {
+        decision_interval full;
+        full.lo = 0.0;
+        full.hi = 1.0;
+        full.sampled = -1.0;
+        it = decisionIntervals.insert(std::make_pair(key, full)).first;
+    }
+    decision_interval& interval = it->second;
+    if (interval.sampled >= 0.0)
+        return interval.sampled < eff;
+    if (eff >= interval.hi)
+        return true;
+    if (eff <= interval.lo)
+        return false;
+
+    // eff splits the range: this is a branch point
+    bool pass;
+    if (pathPosition < configurationPath.size()) {
+        pass = configurationPath[pathPosition];
+    } else if (configurationWeight < minConfigurationWeight) {
+        interval.sampled = interval.lo + (interval.hi-interval.lo)*uniform();
+        return interval.sampled < eff;
+    } else {
+        pass = true;
+        configurationPath.push_back(true);
+        pendingPaths.push_back(configurationPath);
+        pendingPaths.back().back() = false;
+    }
+    pathPosition++;
+    double oldLength = interval.hi-interval.lo;
+    if (pass)
+        interval.hi = eff;
+    else
+        interval.lo = eff;
+    configurationWeight *= (interval.hi-interval.lo)/oldLength;
+    return pass;
 }
 
 void AnalysisHandler::setCrossSection(double xsect,
@@ -542,6 +915,13 @@ void AnalysisHandler::setCrossSection(double xsect,
             if (xsecterr != -1.0)
                 listOfAnalyses[a]->xsecterr = xsecterr;
     }
+    for(int u = 0; u < universeAnalyses.size(); u++) {
+        for(int a = 0; a < universeAnalyses[u].size(); a++) {
+            universeAnalyses[u][a]->xsect = xsect;
+            if (xsecterr != -1.0)
+                universeAnalyses[u][a]->xsecterr = xsecterr;
+        }
+    }
     Global::print(name, "Analysis updated with sigma = "
                                      +Global::doubleToStr(xsect)+" fb");
     if (xsecterr != -1.0) {
@@ -551,7 +931,88 @@ void AnalysisHandler::setCrossSection(double xsect,
 }
 
 
+void AnalysisHandler::readReferenceFile(AnalysisBase* analysis,
+                                        std::string refFile) {
+    ifstream file(refFile.c_str());
+    if (!file.is_open())
+        Global::abort(name, "Cannot read reference file "+refFile);
+    // the first line names the columns, e.g. SR obs bkg ... S95_obs S95_exp
+    std::string line, column;
+    std::getline(file, line);
+    std::stringstream header(line);
+    int iRegion = -1, iObserved = -1, iExpected = -1;
+    for (int i = 0; header >> column; i++) {
+        if (column == "SR")
+            iRegion = i;
+        else if (column == "S95_obs")
+            iObserved = i;
+        else if (column == "S95_exp")
+            iExpected = i;
+    }
+    if (iRegion < 0 || iObserved < 0 || iExpected < 0)
+        Global::abort(name, "Reference file "+refFile+" lacks SR, S95_obs or S95_exp columns");
+    while (std::getline(file, line)) {
+        std::stringstream entries(line);
+        std::vector<std::string> values;
+        while (entries >> column)
+            values.push_back(column);
+        if (values.size() <= std::max(iRegion, std::max(iObserved, iExpected)))
+            continue;
+        analysis->s95Observed[values[iRegion]] = atof(values[iObserved].c_str());
+        analysis->s95Expected[values[iRegion]] = atof(values[iExpected].c_str());
+    }
+}
+
+void AnalysisHandler::checkPrecision(double precision, double sigma,
+                                     precision_status& status) {
+    if (sigma > 0) {
+        // r needs the cross section of the events so far
+        double xsect = (dHandler != NULL) ? dHandler->getCrossSection()
+                                          : eventFile.getCrossSection();
+        for(int a = 0; a < listOfAnalyses.size(); a++)
+            listOfAnalyses[a]->xsect = xsect;
+    }
+    for(int a = 0; a < listOfAnalyses.size(); a++) {
+        double r, rError;
+        double relError = listOfAnalyses[a]->sensitiveRegionPrecision(r, rError);
+        if (relError < 0 || relError > precision)
+            status.precise = false;
+        if (r < 0)
+            continue;
+        status.haveR = true;
+        if (r - sigma*rError > 1)
+            status.excluded = true;
+        if (r + sigma*rError >= 1)
+            status.allowed = false;
+    }
+}
+
 void AnalysisHandler::finish() {
+    finishJob();
+    finalize(); // virtual, defined by derived classes
+    Global::print(name, "Analyses successfully finished!");
+}
+
+void AnalysisHandler::startJob(std::string outputPrefix, EventFile file) {
+    for(int a = 0; a < listOfAnalyses.size(); a++)
+        listOfAnalyses[a]->reset(outputPrefix);
+    for(int u = 0; u < universeAnalyses.size(); u++)
+        for(int a = 0; a < universeAnalyses[u].size(); a++)
+            universeAnalyses[u][a]->reset(outputPrefix+"_"+effUniverses[u].label);
+    weightNames.clear();
+    hasEvents = true;
+    if (treeReader) {
+        delete treeReader;
+        delete rootFileChain;
+        branchWeight = NULL;
+        setup(file);
+    } else {
+        eventFile = file;
+    }
+    Global::print(name, "Analyses reset for output prefix "+outputPrefix);
+}
+
+void AnalysisHandler::finishJob() {
     double xsect;
     double xsectErr;
     if (dHandler!=NULL) {    
@@ -572,11 +1033,18 @@ void AnalysisHandler::finish() {
     for(int a = 0; a < listOfAnalyses.size(); a++) {
         listOfAnalyses[a]->xsect = xsect;
         listOfAnalyses[a]->xsecterr = xsectErr;
+        listOfAnalyses[a]->weightNames = weightNames;
         listOfAnalyses[a]->finish();
     }
+    for(int u = 0; u < universeAnalyses.size(); u++) {
+        for(int a = 0; a < universeAnalyses[u].size(); a++) {
+            universeAnalyses[u][a]->xsect = xsect;
+            universeAnalyses[u][a]->xsecterr = xsectErr;
+            universeAnalyses[u][a]->weightNames = weightNames;
+            universeAnalyses[u][a]->finish();
+        }
+    }
     Global::unredirect_cout();
-    finalize(); // virtual, defined by derived classes
-    Global::print(name, "Analyses successfully finished!");
 }
 
 void AnalysisHandler::bookAnalysesViaInputFile(std::string configFile,
@@ -776,25 +1244,35 @@ bool AnalysisHandler::readParticles(int iEvent) {
             return false;
         }
     }
+    // events vetoed before the detector simulation only carry their weights
+    if (dHandler != NULL && dHandler->eventVetoed) {
+        readWeights(iEvent);
+        return true;
+    }
+
     // define particle vectors and fill them with content of the right branch
     true_b.clear();
     true_c.clear();
     true_tau.clear();
-    if (!branchGenParticle) {
+    TClonesArray* branchTruth = branchTaggingParticle ? branchTaggingParticle : branchGenParticle;
+    if (!branchTruth) {
         Global::abort(name,
                       "GenParticleBranch not properly assigned!");
     }
 
-    for(int i = 0; i < branchGenParticle->GetEntries(); i++) {
-        if (abs( ((GenParticle*)branchGenParticle->At(i))->PID)  == 5)
-            true_b.push_back((GenParticle*)branchGenParticle->At(i));
-        else if (abs( ((GenParticle*)branchGenParticle->At(i))->PID)  == 4)
-            true_c.push_back((GenParticle*)branchGenParticle->At(i));
-        else if (abs( ((GenParticle*)branchGenParticle->At(i))->PID)  == 15) {
-            true_tau.push_back((GenParticle*)branchGenParticle->At(i));
+    for(int i = 0; i < branchTruth->GetEntries(); i++) {
+        if (abs( ((GenParticle*)branchTruth->At(i))->PID)  == 5)
+            true_b.push_back((GenParticle*)branchTruth->At(i));
+        else if (abs( ((GenParticle*)branchTruth->At(i))->PID)  == 4)
+            true_c.push_back((GenParticle*)branchTruth->At(i));
+        else if (abs( ((GenParticle*)branchTruth->At(i))->PID)  == 15) {
+            true_tau.push_back((GenParticle*)branchTruth->At(i));
         }
     }
-    branchGenParticle->Clear();
+    if (branchGenParticle)
+        branchGenParticle->Clear();
+    if (branchTaggingParticle)
+        branchTaggingParticle->Clear();
 
     tracks.clear();
     if (!branchTrack)
@@ -803,12 +1281,14 @@ bool AnalysisHandler::readParticles(int iEvent) {
         tracks.push_back((Track*)branchTrack->At(i));
     branchTrack->Clear();
 
+    // no analysis reads towers if their branch was pruned from Delphes
     towers.clear();
-    if (!branchTower)
-        Global::abort(name, "branchTower not properly assigned!");
-    for(int i = 0; i < branchTower->GetEntries(); i++)
-        towers.push_back((Tower*)branchTower->At(i));
-    branchTower->Clear();
+    if (branchTower) {
+        for(int i = 0; i < branchTower->GetEntries(); i++)
+            towers.push_back((Tower*)branchTower->At(i));
+        branchTower->Clear();
+    }
+    ownership.build(tracks, towers);
 
     jets.clear();
     if (!branchJet)
@@ -844,9 +1324,21 @@ bool AnalysisHandler::readParticles(int iEvent) {
         Global::abort(name,
                       "branchMissingET not properly assigned or empty!");
     }
-    missingET = new ETMiss((MissingET*)branchMissingET->At(0));
+    // one object serves all events and replicas
+    if (missingET == NULL)
+        missingET = new ETMiss((MissingET*)branchMissingET->At(0));
+    else
+        *missingET = ETMiss((MissingET*)branchMissingET->At(0));
     branchMissingET->Clear();
 
+    readWeights(iEvent);
+    return true;
+}
+
+void AnalysisHandler::readWeights(int iEvent) {
+    // detector replicas share the weights read with the first one
+    if (readingReplica)
+        return;
     if (!branchEvent || branchEvent->GetEntries() == 0) {
         Global::abort(name,
                       "branchEvent not properly assigned or empty!");
@@ -867,7 +1359,40 @@ bool AnalysisHandler::readParticles(int iEvent) {
     }
 
     branchEvent->Clear();
-    return true;
+
+    eventWeights.clear();
+    if (branchWeight) {
+        for(int i = 0; i < branchWeight->GetEntries(); i++) {
+            TObject* entry = branchWeight->At(i);
+            std::string weightName;
+            if (!strcmp(entry->ClassName(), "LHEFWeight")) {
+                // LHE <wgt> entries are all variations of the event weight
+                eventWeights.push_back(((LHEFWeight*)entry)->Weight);
+                weightName = Global::intToStr(((LHEFWeight*)entry)->ID);
+            } else {
+                // HepMC and Pythia list the nominal weight first
+                if (i == 0)
+                    continue;
+                eventWeights.push_back(((Weight*)entry)->Weight);
+                weightName = Global::intToStr(i);
+            }
+            if (weightNames.size() < eventWeights.size())
+                weightNames.push_back(weightName);
+            else if (weightNames[eventWeights.size()-1] != weightName)
+                Global::abort(name,
+                              "Weight variation '"+weightName+"' of event "
+                              +Global::intToStr(iEvent)+" does not match '"
+                              +weightNames[eventWeights.size()-1]+"' of previous events!");
+        }
+        branchWeight->Clear();
+    }
+
+    // every simulated replica carries an equal share of the event weight
+    if (dHandler != NULL && dHandler->oversample > 1 && !dHandler->eventVetoed) {
+        eventWeight /= dHandler->oversample;
+        for(int i = 0; i < eventWeights.size(); i++)
+            eventWeights[i] /= dHandler->oversample;
+    }
 }
 
 
@@ -880,72 +1405,120 @@ void AnalysisHandler::postProcessParticles() {
     // loop over electrons
 }
 
+std::vector<AnalysisHandler::isolation_group> AnalysisHandler::groupIsolationTags(
+        const std::vector<isolation_tag_definition*>& list
+        ) {
+    std::vector<isolation_group> groups;
+    for (int i = 0; i < list.size(); i++) {
+        isolation_tag_definition* iso = list[i];
+        if (iso->source != "t" && iso->source != "c")
+            Global::abort(name,
+                          "Unknown isolation source "
+                          +iso->source);
+        int g = 0;
+        while (g < groups.size() &&
+               (groups[g].source != iso->source || groups[g].pTmin != iso->pTmin))
+            g++;
+        if (g == groups.size()) {
+            isolation_group group;
+            group.source = iso->source;
+            group.pTmin = iso->pTmin;
+            group.maxDR = iso->dR;
+            groups.push_back(group);
+        }
+        if (iso->dR > groups[g].maxDR)
+            groups[g].maxDR = iso->dR;
+        groups[g].tags.push_back(i);
+    }
+    return groups;
+}
+
+static bool insideCone(double dR, const std::pair<double,double>& neighbour) {
+    return dR < neighbour.first;
+}
+
+void AnalysisHandler::evaluateIsolationGroup(
+        const isolation_group& group,
+        const std::vector<isolation_tag_definition*>& list,
+        double candPT,
+        std::vector<bool>& flags
+        ) {
+    // Sort the neighbours by distance and turn their pT into a running sum:
+    //  the sum within any cone is then the last entry not further away
+    std::sort(isolationCone.begin(), isolationCone.end());
+    for (int n = 1; n < isolationCone.size(); n++)
+        isolationCone[n].second += isolationCone[n-1].second;
+
+    for (int t = 0; t < group.tags.size(); t++) {
+        isolation_tag_definition* iso = list[group.tags[t]];
+        std::vector<std::pair<double,double> >::iterator last = std::upper_bound(
+                isolationCone.begin(),
+                isolationCone.end(),
+                iso->dR,
+                insideCone
+                );
+        double sumPT = 0;
+        if (last != isolationCone.begin())
+            sumPT = (last-1)->second;
+        // process sumPT depending on if we have an absolute or a
+        //  relative limit
+        if (iso->divideByPTCand)
+            sumPT /= candPT;
+        // now check against limit and set the correct tag value
+        flags[group.tags[t]] = (sumPT < iso->maxVal);
+    }
+}
+
 void AnalysisHandler::isolateElectrons() {
     electronIsolationTags.clear();
+    if (electronIsolationGroups.empty())
+        electronIsolationGroups = groupIsolationTags(listOfElectronTags);
     for (int e = 0; e < electrons.size(); e++) {
         Electron* cand = electrons[e];
-        std::vector<bool> flags;
-
-        // Check all isolation conditions
-        for (int i = 0; i < listOfElectronTags.size(); i++) {
-            isolation_tag_definition* iso = listOfElectronTags[i];
-            double maxDR = iso->dR;
-            double pTmin = iso->pTmin;
-
-            double sumPT = 0;
+        TLorentzVector candP4 = cand->P4();
+        std::vector<bool> flags(listOfElectronTags.size(), false);
+        Track* ownTrack = ownership.ownTrack(cand->Particle);
+        ownTowers.clear();
+        ownership.addOwnTowers(cand->Particle, ownTowers);
+
+        // One pass over the neighbours per group of isolation conditions
+        for (int g = 0; g < electronIsolationGroups.size(); g++) {
+            const isolation_group& group = electronIsolationGroups[g];
+            isolationCone.clear();
             // loop over either the calos or the tracks
-            if (iso->source == "t") {
+            if (group.source == "t") {
                 for (int t = 0; t < tracks.size(); t++) {
                     Track* neighbour = tracks[t];
                     // respect ptmin
-                    if (neighbour->PT < pTmin)
+                    if (neighbour->PT < group.pTmin)
                         continue;
-                    // check dR
-                    if (neighbour->P4().DeltaR(cand->P4()) > maxDR)
+                    // check dR against the largest cone
+                    double dR = neighbour->P4().DeltaR(candP4);
+                    if (dR > group.maxDR)
                         continue;
                     // Ignore the electron's track itself
-                     if(neighbour->Particle == cand->Particle)
-                         continue;
-                    sumPT += neighbour->PT;
+                    if (neighbour == ownTrack)
+                        continue;
+                    isolationCone.push_back(std::make_pair(dR, (double)neighbour->PT));
                 }
             }
-            else if (iso->source == "c") {
+            else {
                 for (int t = 0; t < towers.size(); t++) {
                     Tower* neighbour = towers[t];
                     // respect ptmin
-                    if (neighbour->ET < pTmin)
+                    if (neighbour->ET < group.pTmin)
                         continue;
-                    // check dR
-                    if (neighbour->P4().DeltaR(cand->P4()) > maxDR)
+                    // check dR against the largest cone
+                    double dR = neighbour->P4().DeltaR(candP4);
+                    if (dR > group.maxDR)
                         continue;
-                    // Ignore the electron's tower
-                    bool candidatesTower = false;
-                    for(int p = 0; p < neighbour->Particles.GetEntries(); p++){
-                        if (neighbour->Particles.At(p) == cand->Particle) {
-                            // break the loop and ignore the tower
-                            candidatesTower = true;
-                            break;
-                        }
-                    }
-                    if (candidatesTower)
+                    // Ignore the electron's towers
+                    if (std::find(ownTowers.begin(), ownTowers.end(), neighbour) != ownTowers.end())
                         continue;
-                    sumPT += neighbour->ET;
+                    isolationCone.push_back(std::make_pair(dR, (double)neighbour->ET));
                 }
             }
-            else
-                Global::abort(name,
-                              "Unknown isolation source "
-                              +iso->source);
-
-            // process sumPT depending on if we have an absolute or a
-            //  relative limit
-            if (iso->divideByPTCand)
-                sumPT /= cand->PT;
-            // now check against limit and if so, add the correct tag value
-            if (sumPT < iso->maxVal)
-                flags.push_back(true);
-            else
-                flags.push_back(false);
+            evaluateIsolationGroup(group, listOfElectronTags, cand->PT, flags);
         }
         electronIsolationTags[cand] = flags;
     }
@@ -954,57 +1527,47 @@ void AnalysisHandler::isolateElectrons() {
 void AnalysisHandler::isolateMuons() {
     // Do the same as isolateElectrons()
     muonIsolationTags.clear();
+    if (muonIsolationGroups.empty())
+        muonIsolationGroups = groupIsolationTags(listOfMuonTags);
     for (int m = 0; m < muons.size(); m++) {
         Muon* cand = muons[m];
-        std::vector<bool> flags;
-        // loop over isolation conditions
-        for (int i = 0; i < listOfMuonTags.size(); i++) {
-            isolation_tag_definition* iso = listOfMuonTags[i];
-            double maxDR = iso->dR;
-            double pTmin = iso->pTmin;
-
-            double sumPT = 0;
+        TLorentzVector candP4 = cand->P4();
+        std::vector<bool> flags(listOfMuonTags.size(), false);
+        // loop over groups of isolation conditions
+        for (int g = 0; g < muonIsolationGroups.size(); g++) {
+            const isolation_group& group = muonIsolationGroups[g];
+            isolationCone.clear();
             // loop over calos or tracks
-            if (iso->source == "t") {
+            if (group.source == "t") {
                 for (int t = 0; t < tracks.size(); t++) {
                     Track* neighbour = tracks[t];
                     // respect ptmin
-                    if (neighbour->PT < pTmin)
+                    if (neighbour->PT < group.pTmin)
                         continue;
-                    // check dR
-                    if (neighbour->P4().DeltaR(cand->P4()) > maxDR)
+                    // check dR against the largest cone
+                    double dR = neighbour->P4().DeltaR(candP4);
+                    if (dR > group.maxDR)
                         continue;
                     // FIXME To be compatible with CheckMATE 1, muons do not
                     // appear in tracks, therefore no track=?=muon check needed
-                    sumPT += neighbour->PT;
+                    isolationCone.push_back(std::make_pair(dR, (double)neighbour->PT));
                 }
             }
-            else if (iso->source == "c") {
+            else {
                 for (int t = 0; t < towers.size(); t++) {
                     Tower* neighbour = towers[t];
                     // respect ptmin
-                    if (neighbour->ET < pTmin)
+                    if (neighbour->ET < group.pTmin)
                         continue;
-                    // check dR
-                    if (neighbour->P4().DeltaR(cand->P4()) > maxDR)
+                    // check dR against the largest cone
+                    double dR = neighbour->P4().DeltaR(candP4);
+                    if (dR > group.maxDR)
                         continue;
                     // Muons do not deposit into towers, so no tower=?=muon
-                    sumPT += neighbour->ET;
+                    isolationCone.push_back(std::make_pair(dR, (double)neighbour->ET));
                 }
             }
-            else
-                Global::abort(name,
-                              "Unknown isolation source "
-                              +iso->source);
-            // process sumPT depending on if we have an absolute or a
-            //  relative limit
-            if (iso->divideByPTCand)
-                sumPT /= cand->PT;
-            // now check against limit and if so, add the correct tag value
-            if (sumPT < iso->maxVal)
-                flags.push_back(true);
-            else
-                flags.push_back(false);
+            evaluateIsolationGroup(group, listOfMuonTags, cand->PT, flags);
         }
         muonIsolationTags[cand] = flags;
     }
@@ -1012,105 +1575,95 @@ void AnalysisHandler::isolateMuons() {
 
 void AnalysisHandler::isolatePhotons() {
     photonIsolationTags.clear();
+    if (photonIsolationGroups.empty())
+        photonIsolationGroups = groupIsolationTags(listOfPhotonTags);
     for (int p = 0; p < photons.size(); p++) {
         Photon* cand = photons[p];
-        std::vector<bool> flags;
-
-        // loop over isolation conditions
-        for (int i = 0; i < listOfPhotonTags.size(); i++) {
-            // FIXME to be compatible with CM1 and to improve speed, avoid
-            // test of any photon with PT < 10 GeV
-            if(photons[p]->PT < 10.) {
-                flags.push_back(false);
-                continue;
-            }
+        std::vector<bool> flags(listOfPhotonTags.size(), false);
 
-            isolation_tag_definition* iso = listOfPhotonTags[i];
-            double maxDR = iso->dR;
-            double pTmin = iso->pTmin;
+        // FIXME to be compatible with CM1 and to improve speed, avoid
+        // test of any photon with PT < 10 GeV
+        if(cand->PT < 10.) {
+            photonIsolationTags[cand] = flags;
+            continue;
+        }
 
-            double sumPT = 0;
+        TLorentzVector candP4 = cand->P4();
+        ownTowers.clear();
+        ownership.addOwnTowers(cand->Particles, ownTowers);
+        // loop over groups of isolation conditions
+        for (int g = 0; g < photonIsolationGroups.size(); g++) {
+            const isolation_group& group = photonIsolationGroups[g];
+            isolationCone.clear();
              // loop over calos or tracks
-            if (iso->source == "t") {
+            if (group.source == "t") {
                 for (int t = 0; t < tracks.size(); t++) {
                     Track* neighbour = tracks[t];
                     // respect ptmin
-                    if (neighbour->PT < pTmin)
+                    if (neighbour->PT < group.pTmin)
                         continue;
-                    // check dR
-                    if (neighbour->P4().DeltaR(cand->P4()) > maxDR)
+                    // check dR against the largest cone
+                    double dR = neighbour->P4().DeltaR(candP4);
+                    if (dR > group.maxDR)
                         continue;
                     // photons do not appear in tracks
                     // TODO Check whether this is true in Delphes too
                     // as their overlap check could test
                     // mother(photon) =?= track
-                    sumPT += neighbour->PT;
+                    isolationCone.push_back(std::make_pair(dR, (double)neighbour->PT));
                 }
             }
-            else if (iso->source == "c") {
+            else {
                 for (int t = 0; t < towers.size(); t++) {
                     Tower* neighbour = towers[t];
                     // respect ptmin
-                    if (neighbour->ET < pTmin)
+                    if (neighbour->ET < group.pTmin)
                         continue;
-                    // check dR
-                    if (neighbour->P4().DeltaR(cand->P4()) > maxDR)
+                    // check dR against the largest cone
+                    double dR = neighbour->P4().DeltaR(candP4);
+                    if (dR > group.maxDR)
                         continue;
-                    // Check for tower =?= photon
-                    bool candidatesTower = false;
-                    TRefArray nParticles = neighbour->Particles;
-                    TRefArray cParticles = cand->Particles;
-                    for(int np = 0; np < nParticles.GetEntries(); np++) {
-                       for (int cp = 0; cp < cParticles.GetEntries(); cp++) {
-                           if (nParticles.At(np) == cParticles.At(cp)) {
-                                 candidatesTower = true;
-                                 break;
-                           }
-                       }
-                    }
-                    if (candidatesTower)
+                    // Ignore towers sharing a particle with the photon
+                    if (std::find(ownTowers.begin(), ownTowers.end(), neighbour) != ownTowers.end())
                         continue;
-                    sumPT += neighbour->ET;
+                    isolationCone.push_back(std::make_pair(dR, (double)neighbour->ET));
                 }
             }
-            else
-                Global::abort(name,
-                              "Unknown isolation source "
-                              +iso->source);
-            // process sumPT depending on if we have an absolute or a
-            //  relative limit
-            if (iso->divideByPTCand)
-                sumPT /= cand->PT;
-            // now check against limit and if so, add the correct tag value
-            if (sumPT < iso->maxVal)
-                flags.push_back(true);
-            else
-                flags.push_back(false);
+            evaluateIsolationGroup(group, listOfPhotonTags, cand->PT, flags);
         }
-        photonIsolationTags[photons[p]] = flags;
+        photonIsolationTags[cand] = flags;
     }
 }
 
 void AnalysisHandler::linkObjects() {
+    evaluateRecoBounds();
     for(int a = 0; a < listOfAnalyses.size(); a++) {
-        // important: as many analyses cut on the containers,
-        //  every analysis must use its own container
-        std::vector<Track*> tempTracks = tracks;
-        listOfAnalyses[a]->tracks = tempTracks;
-        std::vector<Tower*> tempTowers = towers;
-        listOfAnalyses[a]->towers = tempTowers;
-        std::vector<Jet*> tempJets = jets;
-        listOfAnalyses[a]->jets = tempJets;
-        std::vector<Electron*> tempElectrons = electrons;
-        listOfAnalyses[a]->electrons = tempElectrons;
-        std::vector<Muon*> tempMuons = muons;
-        listOfAnalyses[a]->muons = tempMuons;
-        std::vector<Photon*> tempPhotons = photons;
-        listOfAnalyses[a]->photons = tempPhotons;
-        ETMiss* tempMissingET =  new ETMiss(missingET);
-        listOfAnalyses[a]->missingET = tempMissingET;
-        listOfAnalyses[a]->weight = eventWeight;
+        listOfAnalyses[a]->weight = eventWeight*configurationWeight;
+        listOfAnalyses[a]->weights = eventWeights;
+        if (configurationWeight != 1.0)
+            for(int w = 0; w < eventWeights.size(); w++)
+                listOfAnalyses[a]->weights[w] *= configurationWeight;
+        // analyses failing their bounds are only counted
+        if (recoVetoed[a])
+            continue;
 
+        // important: as many analyses cut on the containers,
+        //  every analysis must use its own container. Assigning into the
+        //  containers of the previous event reuses their memory.
+        listOfAnalyses[a]->tracks = tracks;
+        listOfAnalyses[a]->towers = towers;
+        listOfAnalyses[a]->jets = jets;
+        listOfAnalyses[a]->electrons = electrons;
+        listOfAnalyses[a]->muons = muons;
+        listOfAnalyses[a]->photons = photons;
+        // the analysis keeps its missing ET object and deletes it in the end
+        if (listOfAnalyses[a]->missingET == NULL)
+            listOfAnalyses[a]->missingET = new ETMiss(missingET);
+        else
+            *listOfAnalyses[a]->missingET = ETMiss(missingET);
+
+        listOfAnalyses[a]->ownership = &ownership;
+        listOfAnalyses[a]->reclustering = &reclustering;
         listOfAnalyses[a]->electronIsolationTags = electronIsolationTags;
         listOfAnalyses[a]->muonIsolationTags = muonIsolationTags;
         listOfAnalyses[a]->photonIsolationTags = photonIsolationTags;
@@ -30,6 +30,11 @@ void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::initialize() {
 void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::finalize() {
 }
 
+void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::truthTaggingCuts(double& ptMin, double& etaMax) {
+    ptMin = std::min(PTMIN_B_TRUTH, PTMIN_TAU_TRUTH);
+    etaMax = std::max(ETAMAX_B_TRUTH, ETAMAX_TAU_TRUTH);
+}
+
 void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::bookAnalysis(std::string analysisName,
                                         Tag_Map whichTags,
                                         Param_Map eventParameters) {
@@ -56,6 +61,10 @@ void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::postProcessParticles() {
     AnalysisHandler::postProcessParticles();
 
     // Then take care of the rest
+    applyEfficiencies();
+}
+
+void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::applyEfficiencies() {
     identifyPhotons();
     identifyElectrons();
     identifyMuons();
@@ -74,8 +83,9 @@ void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::identifyPhotons() {
         // tag 0 is the loose isolation condition
         if (photonIsolationTags[cand][0]) {
             photonsLoose.push_back(cand);
-            pEffMed = photonEffMedium(cand->PT, cand->Eta);
-            if ( rand()/(RAND_MAX+1.) < pEffMed )
+            pEffMed = varyEfficiency(photonEffMedium(cand->PT, cand->Eta),
+                                     &efficiency_universe::photonID);
+            if (passes(cand, 0, pEffMed))
                 photonsMedium.push_back(cand);
         }
     }
@@ -93,13 +103,14 @@ void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::identifyElectrons() {
         // tag 0 is the loose isolation condition
         if (electronIsolationTags[cand][0]) {
             electronsLoose.push_back(cand);
-            eEffMed = electronRecEff(cand->PT, cand->Eta) *
-                      electronIDEffMedium(cand->PT, cand->Eta);
-            if (rand()/(RAND_MAX+1.) <  eEffMed) {
+            eEffMed = varyEfficiency(electronRecEff(cand->PT, cand->Eta) *
+                                     electronIDEffMedium(cand->PT, cand->Eta),
+                                     &efficiency_universe::electronID);
+            if (passes(cand, 0, eEffMed)) {
                 electronsMedium.push_back(cand);
                 eEffTigOvMed = electronIDEffTightOverMedium(cand->PT,
                                                             cand->Eta);
-                if (rand()/(RAND_MAX+1.) <  eEffTigOvMed)
+                if (passes(cand, 1, eEffTigOvMed))
                     electronsTight.push_back(cand);
             }
         }
@@ -118,11 +129,12 @@ void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::identifyMuons()  {
         cand = muons[m];
         if (muonIsolationTags[muons[m]][0]) {
             muonsLoose.push_back(muons[m]);
-            mEffCombPlus = muonEffCombPlus(muons[m]->Phi, muons[m]->Eta);
-            if (rand()/((double)RAND_MAX+1) < mEffCombPlus ) {
+            mEffCombPlus = varyEfficiency(muonEffCombPlus(muons[m]->Phi, muons[m]->Eta),
+                                          &efficiency_universe::muonID);
+            if (passes(cand, 0, mEffCombPlus)) {
                 muonsCombinedPlus.push_back(muons[m]);
                 mEffComb = muonEffCombOverCombPlus(muons[m]->Phi, muons[m]->Eta);
-                if (rand()/((double)RAND_MAX+1) < mEffComb ) {
+                if (passes(cand, 1, mEffComb)) {
                     muonsCombined.push_back(muons[m]);
                 }
             }
@@ -132,9 +144,11 @@ void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::identifyMuons()  {
 
 void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::tagBJets() {
    Jet* cand = NULL; // The to-be-checked candidate
-   // The candidate's probability and its pass-limit to be tagged
-   double prob = 0, pass_prob = 0;
+   // The candidate's pass-limit to be tagged
+   double pass_prob = 0;
    Eff_Fun_Ptr3 eff_function = NULL; // Efficiency function for the candidate
+   // Scale factor of the current efficiency universe for the candidate's flavour
+   double efficiency_universe::*eff_scale = NULL;
    std::vector<bool> bTags; // The candidate's list of passed bTags
 
    jetBTags.clear();
@@ -144,7 +158,6 @@ void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::tagBJets() {
 
    for(int j = 0; j < jets.size(); j++) {
           cand = jets[j];
-          prob = rand()/(RAND_MAX+1.);
           eff_function = NULL;
           bTags.clear();
 
@@ -155,6 +168,7 @@ void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::tagBJets() {
                 fabs(true_b[b]->Eta) < ETAMAX_B_TRUTH &&
                  true_b[b]->P4().DeltaR(cand->P4()) < DR_B_TRUTH) {
                   eff_function = &AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::bSigEff;
+                  eff_scale = &efficiency_universe::bTag;
                   break;
               }
           }
@@ -165,19 +179,23 @@ void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::tagBJets() {
                      fabs(true_c[c]->Eta) < ETAMAX_B_TRUTH &&
                      true_c[c]->P4().DeltaR(cand->P4()) < DR_B_TRUTH) {
                       eff_function = &AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::bBkgCJetEff;
+                      eff_scale = &efficiency_universe::cMistag;
                       break;
                   }
               }
           }
           // If no b and no c overlap, use light jet Rej
-          if (eff_function == NULL)
+          if (eff_function == NULL) {
               eff_function = &AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::bBkgLJetEff;
+              eff_scale = &efficiency_universe::lightMistag;
+          }
 
           // Now that we know the right function to use, lets tag
           for(int btag = 0; btag < listOfJetBTags.size(); btag++) {
-              pass_prob = (*eff_function)(cand->PT, cand->Eta,
-                                                listOfJetBTags[btag]->eff);
-              if (fabs(cand->P4().Eta()) < ETAMAX_B_TRUTH && prob < pass_prob)
+              pass_prob = varyEfficiency((*eff_function)(cand->PT, cand->Eta,
+                                                         listOfJetBTags[btag]->eff),
+                                         eff_scale);
+              if (fabs(cand->P4().Eta()) < ETAMAX_B_TRUTH && passes(cand, 0, pass_prob))
                       bTags.push_back(true);
               else
                   bTags.push_back(false);
@@ -190,8 +208,10 @@ void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::tagTauJets() {
     Jet* cand = NULL; // currently tested jet candidate
     // pointer to the right efficiency functions
     Eff_Fun_Ptr2 effFunLoose = NULL, effFunMedium = NULL, effFunTight = NULL;
-    double prob = 0, pass_prob = 0;
+    double pass_prob = 0;
     int prongs = 0;
+    // Scale factor of the current efficiency universe, only for true taus
+    double efficiency_universe::*eff_scale = NULL;
 
     std::vector<bool> tauTags, stdTags;
     // These are the standard values for all candidates
@@ -209,9 +229,9 @@ void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::tagTauJets() {
         effFunMedium = NULL;
         effFunTight = NULL;
         cand = jets[j];
-        prob = rand()/(RAND_MAX+1.);
         tauTags = stdTags;
         prongs = 0;
+        eff_scale = NULL;
 
        /* First, find the prong and the charge of the potential tau by
         * looping over all tracks*/
@@ -234,6 +254,7 @@ void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::tagTauJets() {
            if(true_tau[t]->PT > PTMIN_TAU_TRUTH &&
               fabs(true_tau[t]->Eta) < ETAMAX_TAU_TRUTH  &&
               cand->P4().DeltaR(true_tau[t]->P4()) < DR_TAU_TRUTH) {
+               eff_scale = &efficiency_universe::tauTag;
                if(prongs > 1) {
                    effFunLoose = &AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::tauSigEffMultiLoose;
                    effFunMedium = &AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::tauSigEffMultiMedium;
@@ -262,14 +283,14 @@ void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::tagTauJets() {
        }
        // Now that we know the right function to use, lets tag
        // We only need to check "medium" if we passed "loose" etc.
-       pass_prob = (*effFunLoose)(cand->PT, cand->Eta);
-       if(prob < pass_prob) {
+       pass_prob = varyEfficiency((*effFunLoose)(cand->PT, cand->Eta), eff_scale);
+       if(passes(cand, 1, pass_prob)) {
            tauTags[0] = true;
-           pass_prob = (*effFunMedium)(cand->PT, cand->Eta);
-           if (prob < pass_prob) {
+           pass_prob = varyEfficiency((*effFunMedium)(cand->PT, cand->Eta), eff_scale);
+           if (passes(cand, 1, pass_prob)) {
                tauTags[1] = true;
-               pass_prob = (*effFunTight)(cand->PT, cand->Eta);
-               if (prob < pass_prob)
+               pass_prob = varyEfficiency((*effFunTight)(cand->PT, cand->Eta), eff_scale);
+               if (passes(cand, 1, pass_prob))
                    tauTags[2] = true;
            }
        }
@@ -281,26 +302,18 @@ void AnalysisHandlerATLAS_14TeV_HL_FlatBtagger::linkObjects() {
     AnalysisHandler::linkObjects();
     // Linking Particle Objects and run analyses
     for (int a = 0; a < listOfAnalyses.size(); a++) {
-        std::vector<Electron*> tempElectronsLoose = electronsLoose;
-        listOfAnalyses[a]->electronsLoose = tempElectronsLoose;
-        std::vector<Electron*> tempElectronsMedium = electronsMedium;
-        listOfAnalyses[a]->electronsMedium = tempElectronsMedium;
-        std::vector<Electron*> tempElectronsTight = electronsTight;
-        listOfAnalyses[a]->electronsTight = tempElectronsTight;;
-
-        std::vector<Muon*> tempMuonsLoose = muonsLoose;
-        listOfAnalyses[a]->muonsLoose = tempMuonsLoose;
-
-
-        std::vector<Muon*> tempMuonsCombined = muonsCombined;
-        listOfAnalyses[a]->muonsCombined = tempMuonsCombined;;
-        std::vector<Muon*> tempMuonsCombinedPlus = muonsCombinedPlus;
-        listOfAnalyses[a]->muonsCombinedPlus = tempMuonsCombinedPlus;
-
-        std::vector<Photon*> tempPhotonsLoose = photonsLoose;
-        listOfAnalyses[a]->photonsLoose = tempPhotonsLoose;
-        std::vector<Photon*> tempPhotonsMedium = photonsMedium;
-        listOfAnalyses[a]->photonsMedium = tempPhotonsMedium;
+        if (recoVetoed[a])
+            continue;
+        listOfAnalyses[a]->electronsLoose = electronsLoose;
+        listOfAnalyses[a]->electronsMedium = electronsMedium;
+        listOfAnalyses[a]->electronsTight = electronsTight;
+
+        listOfAnalyses[a]->muonsLoose = muonsLoose;
+        listOfAnalyses[a]->muonsCombined = muonsCombined;
+        listOfAnalyses[a]->muonsCombinedPlus = muonsCombinedPlus;
+
+        listOfAnalyses[a]->photonsLoose = photonsLoose;
+        listOfAnalyses[a]->photonsMedium = photonsMedium;
 
         listOfAnalyses[a]->jetBTags = jetBTags;
         listOfAnalyses[a]->jetTauTags = jetTauTags;
@@ -30,6 +30,11 @@ void AnalysisHandlerATLAS_7TeV::initialize() {
 void AnalysisHandlerATLAS_7TeV::finalize() {
 }
 
+void AnalysisHandlerATLAS_7TeV::truthTaggingCuts(double& ptMin, double& etaMax) {
+    ptMin = std::min(PTMIN_B_TRUTH, PTMIN_TAU_TRUTH);
+    etaMax = std::max(ETAMAX_B_TRUTH, ETAMAX_TAU_TRUTH);
+}
+
 void AnalysisHandlerATLAS_7TeV::bookAnalysis(std::string analysisName,
                                         Tag_Map whichTags,
                                         Param_Map eventParameters) {
@@ -55,6 +60,10 @@ void AnalysisHandlerATLAS_7TeV::postProcessParticles() {
     AnalysisHandler::postProcessParticles();
 
     // Then take care of the rest
+    applyEfficiencies();
+}
+
+void AnalysisHandlerATLAS_7TeV::applyEfficiencies() {
     identifyPhotons();
     identifyElectrons();
     identifyMuons();
@@ -73,8 +82,9 @@ void AnalysisHandlerATLAS_7TeV::identifyPhotons() {
         // tag 0 is the loose isolation condition
         if (photonIsolationTags[cand][0]) {
             photonsLoose.push_back(cand);
-            pEffMed = photonEffMedium(cand->PT, cand->Eta);
-            if ( rand()/(RAND_MAX+1.) < pEffMed )
+            pEffMed = varyEfficiency(photonEffMedium(cand->PT, cand->Eta),
+                                     &efficiency_universe::photonID);
+            if (passes(cand, 0, pEffMed))
                 photonsMedium.push_back(cand);
         }
     }
@@ -92,13 +102,14 @@ void AnalysisHandlerATLAS_7TeV::identifyElectrons() {
         // tag 0 is the loose isolation condition
         if (electronIsolationTags[cand][0]) {
             electronsLoose.push_back(cand);
-            eEffMed = electronRecEff(cand->PT, cand->Eta) *
-                      electronIDEffMedium(cand->PT, cand->Eta);
-            if (rand()/(RAND_MAX+1.) <  eEffMed) {
+            eEffMed = varyEfficiency(electronRecEff(cand->PT, cand->Eta) *
+                                     electronIDEffMedium(cand->PT, cand->Eta),
+                                     &efficiency_universe::electronID);
+            if (passes(cand, 0, eEffMed)) {
                 electronsMedium.push_back(cand);
                 eEffTigOvMed = electronIDEffTightOverMedium(cand->PT,
                                                             cand->Eta);
-                if (rand()/(RAND_MAX+1.) <  eEffTigOvMed)
+                if (passes(cand, 1, eEffTigOvMed))
                     electronsTight.push_back(cand);
             }
         }
@@ -117,11 +128,12 @@ void AnalysisHandlerATLAS_7TeV::identifyMuons()  {
         cand = muons[m];
         if (muonIsolationTags[muons[m]][0]) {
             muonsLoose.push_back(muons[m]);
-            mEffCombPlus = muonEffCombPlus(muons[m]->Phi, muons[m]->Eta);
-            if (rand()/((double)RAND_MAX+1) < mEffCombPlus ) {
+            mEffCombPlus = varyEfficiency(muonEffCombPlus(muons[m]->Phi, muons[m]->Eta),
+                                          &efficiency_universe::muonID);
+            if (passes(cand, 0, mEffCombPlus)) {
                 muonsCombinedPlus.push_back(muons[m]);
                 mEffComb = muonEffCombOverCombPlus(muons[m]->Phi, muons[m]->Eta);
-                if (rand()/((double)RAND_MAX+1) < mEffComb ) {
+                if (passes(cand, 1, mEffComb)) {
                     muonsCombined.push_back(muons[m]);
                 }
             }
@@ -131,9 +143,11 @@ void AnalysisHandlerATLAS_7TeV::identifyMuons()  {
 
 void AnalysisHandlerATLAS_7TeV::tagBJets() {
    Jet* cand = NULL; // The to-be-checked candidate
-   // The candidate's probability and its pass-limit to be tagged
-   double prob = 0, pass_prob = 0;
+   // The candidate's pass-limit to be tagged
+   double pass_prob = 0;
    Eff_Fun_Ptr3 eff_function = NULL; // Efficiency function for the candidate
+   // Scale factor of the current efficiency universe for the candidate's flavour
+   double efficiency_universe::*eff_scale = NULL;
    std::vector<bool> bTags; // The candidate's list of passed bTags
 
    jetBTags.clear();
@@ -143,7 +157,6 @@ void AnalysisHandlerATLAS_7TeV::tagBJets() {
 
    for(int j = 0; j < jets.size(); j++) {
           cand = jets[j];
-          prob = rand()/(RAND_MAX+1.);
           eff_function = NULL;
           bTags.clear();
 
@@ -154,6 +167,7 @@ void AnalysisHandlerATLAS_7TeV::tagBJets() {
                 fabs(true_b[b]->Eta) < ETAMAX_B_TRUTH &&
                  true_b[b]->P4().DeltaR(cand->P4()) < DR_B_TRUTH) {
                   eff_function = &AnalysisHandlerATLAS_7TeV::bSigEff;
+                  eff_scale = &efficiency_universe::bTag;
                   break;
               }
           }
@@ -164,19 +178,23 @@ void AnalysisHandlerATLAS_7TeV::tagBJets() {
                      fabs(true_c[c]->Eta) < ETAMAX_B_TRUTH &&
                      true_c[c]->P4().DeltaR(cand->P4()) < DR_B_TRUTH) {
                       eff_function = &AnalysisHandlerATLAS_7TeV::bBkgCJetEff;
+                      eff_scale = &efficiency_universe::cMistag;
                       break;
                   }
               }
           }
           // If no b and no c overlap, use light jet Rej
-          if (eff_function == NULL)
+          if (eff_function == NULL) {
               eff_function = &AnalysisHandlerATLAS_7TeV::bBkgLJetEff;
+              eff_scale = &efficiency_universe::lightMistag;
+          }
 
           // Now that we know the right function to use, lets tag
           for(int btag = 0; btag < listOfJetBTags.size(); btag++) {
-              pass_prob = (*eff_function)(cand->PT, cand->Eta,
-                                                listOfJetBTags[btag]->eff);
-              if (prob < pass_prob)
+              pass_prob = varyEfficiency((*eff_function)(cand->PT, cand->Eta,
+                                                         listOfJetBTags[btag]->eff),
+                                         eff_scale);
+              if (passes(cand, 0, pass_prob))
                       bTags.push_back(true);
               else
                   bTags.push_back(false);
@@ -189,8 +207,10 @@ void AnalysisHandlerATLAS_7TeV::tagTauJets() {
     Jet* cand = NULL; // currently tested jet candidate
     // pointer to the right efficiency functions
     Eff_Fun_Ptr2 effFunLoose = NULL, effFunMedium = NULL, effFunTight = NULL;
-    double prob = 0, pass_prob = 0;
+    double pass_prob = 0;
     int prongs = 0;
+    // Scale factor of the current efficiency universe, only for true taus
+    double efficiency_universe::*eff_scale = NULL;
 
     std::vector<bool> tauTags, stdTags;
     // These are the standard values for all candidates
@@ -208,9 +228,9 @@ void AnalysisHandlerATLAS_7TeV::tagTauJets() {
         effFunMedium = NULL;
         effFunTight = NULL;
         cand = jets[j];
-        prob = rand()/(RAND_MAX+1.);
         tauTags = stdTags;
         prongs = 0;
+        eff_scale = NULL;
 
        /* First, find the prong and the charge of the potential tau by
         * looping over all tracks*/
@@ -233,6 +253,7 @@ void AnalysisHandlerATLAS_7TeV::tagTauJets() {
            if(true_tau[t]->PT > PTMIN_TAU_TRUTH &&
               fabs(true_tau[t]->Eta) < ETAMAX_TAU_TRUTH  &&
               cand->P4().DeltaR(true_tau[t]->P4()) < DR_TAU_TRUTH) {
+               eff_scale = &efficiency_universe::tauTag;
                if(prongs > 1) {
                    effFunLoose = &AnalysisHandlerATLAS_7TeV::tauSigEffMultiLoose;
                    effFunMedium = &AnalysisHandlerATLAS_7TeV::tauSigEffMultiMedium;
@@ -261,14 +282,14 @@ void AnalysisHandlerATLAS_7TeV::tagTauJets() {
        }
        // Now that we know the right function to use, lets tag
        // We only need to check "medium" if we passed "loose" etc.
-       pass_prob = (*effFunLoose)(cand->PT, cand->Eta);
-       if(prob < pass_prob) {
+       pass_prob = varyEfficiency((*effFunLoose)(cand->PT, cand->Eta), eff_scale);
+       if(passes(cand, 1, pass_prob)) {
            tauTags[0] = true;
-           pass_prob = (*effFunMedium)(cand->PT, cand->Eta);
-           if (prob < pass_prob) {
+           pass_prob = varyEfficiency((*effFunMedium)(cand->PT, cand->Eta), eff_scale);
+           if (passes(cand, 1, pass_prob)) {
                tauTags[1] = true;
-               pass_prob = (*effFunTight)(cand->PT, cand->Eta);
-               if (prob < pass_prob)
+               pass_prob = varyEfficiency((*effFunTight)(cand->PT, cand->Eta), eff_scale);
+               if (passes(cand, 1, pass_prob))
                    tauTags[2] = true;
            }
        }
@@ -280,26 +301,18 @@ void AnalysisHandlerATLAS_7TeV::linkObjects() {
     AnalysisHandler::linkObjects();
     // Linking Particle Objects and run analyses
     for (int a = 0; a < listOfAnalyses.size(); a++) {
-        std::vector<Electron*> tempElectronsLoose = electronsLoose;
-        listOfAnalyses[a]->electronsLoose = tempElectronsLoose;
-        std::vector<Electron*> tempElectronsMedium = electronsMedium;
-        listOfAnalyses[a]->electronsMedium = tempElectronsMedium;
-        std::vector<Electron*> tempElectronsTight = electronsTight;
-        listOfAnalyses[a]->electronsTight = tempElectronsTight;;
-
-        std::vector<Muon*> tempMuonsLoose = muonsLoose;
-        listOfAnalyses[a]->muonsLoose = tempMuonsLoose;
-
-
-        std::vector<Muon*> tempMuonsCombined = muonsCombined;
-        listOfAnalyses[a]->muonsCombined = tempMuonsCombined;;
-        std::vector<Muon*> tempMuonsCombinedPlus = muonsCombinedPlus;
-        listOfAnalyses[a]->muonsCombinedPlus = tempMuonsCombinedPlus;
-
-        std::vector<Photon*> tempPhotonsLoose = photonsLoose;
-        listOfAnalyses[a]->photonsLoose = tempPhotonsLoose;
-        std::vector<Photon*> tempPhotonsMedium = photonsMedium;
-        listOfAnalyses[a]->photonsMedium = tempPhotonsMedium;
+        if (recoVetoed[a])
+            continue;
+        listOfAnalyses[a]->electronsLoose = electronsLoose;
+        listOfAnalyses[a]->electronsMedium = electronsMedium;
+        listOfAnalyses[a]->electronsTight = electronsTight;
+
+        listOfAnalyses[a]->muonsLoose = muonsLoose;
+        listOfAnalyses[a]->muonsCombined = muonsCombined;
+        listOfAnalyses[a]->muonsCombinedPlus = muonsCombinedPlus;
+
+        listOfAnalyses[a]->photonsLoose = photonsLoose;
+        listOfAnalyses[a]->photonsMedium = photonsMedium;
 
         listOfAnalyses[a]->jetBTags = jetBTags;
         listOfAnalyses[a]->jetTauTags = jetTauTags;
@@ -0,0 +1,94 @@
+/** \class CMEfficiency
+ *
+ *  Selects candidates from the InputArray according to the efficiency formula,
+ *  like the Delphes Efficiency module. The formula is evaluated via a
+ *  FormulaTable and has to be piecewise constant, see FormulaTable::tabulable().
+ *
+ */
+
+#include "CMEfficiency.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFormula.h"
+
+#include "TMath.h"
+#include "TRandom3.h"
+#include "TObjArray.h"
+#include "TLorentzVector.h"
+
+#include <stdexcept>
+#include <sstream>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+CMEfficiency::CMEfficiency() :
+  fFormula(0), fItInputArray(0)
+{
+  fFormula = new DelphesFormula;
+}
+
+//------------------------------------------------------------------------------
+
+CMEfficiency::~CMEfficiency()
+{
+  if(fFormula) delete fFormula;
+}
+
+//------------------------------------------------------------------------------
+
+void CMEfficiency::Init()
+{
+  // read efficiency formula
+  const char *expression = GetString("EfficiencyFormula", "1.0");
+  fFormula->Compile(expression);
+  if(!fTable.compile(expression, fFormula))
+  {
+    stringstream message;
+    message << "efficiency formula of " << GetName() << " is not piecewise constant, use the Efficiency module instead";
+    throw runtime_error(message.str());
+  }
+
+  // import input array
+
+  fInputArray = ImportArray(GetString("InputArray", "ParticlePropagator/stableParticles"));
+  fItInputArray = fInputArray->MakeIterator();
+
+  // create output array
+
+  fOutputArray = ExportArray(GetString("OutputArray", "stableParticles"));
+}
+
+//------------------------------------------------------------------------------
+
+void CMEfficiency::Finish()
+{
+  if(fItInputArray) delete fItInputArray;
+}
+
+//------------------------------------------------------------------------------
+
+void CMEfficiency::Process()
+{
+  Candidate *candidate;
+  Double_t pt, eta, phi, e;
+
+  fItInputArray->Reset();
+  while((candidate = static_cast<Candidate*>(fItInputArray->Next())))
+  {
+    const TLorentzVector &candidatePosition = candidate->Position;
+    const TLorentzVector &candidateMomentum = candidate->Momentum;
+    eta = candidatePosition.Eta();
+    phi = candidatePosition.Phi();
+    pt = candidateMomentum.Pt();
+    e = candidateMomentum.E();
+
+    // apply an efficency formula
+    if(gRandom->Uniform() > fTable.eval(pt, eta, phi, e)) continue;
+
+    fOutputArray->Add(candidate);
+  }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,123 @@
+/** \class CMMomentumSmearing
+ *
+ *  Performs transverse momentum resolution smearing, like the Delphes
+ *  MomentumSmearing module. The resolution formula is evaluated via a
+ *  FormulaTable and has to be piecewise constant, see FormulaTable::tabulable().
+ *
+ */
+
+#include "CMMomentumSmearing.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFormula.h"
+
+#include "TMath.h"
+#include "TRandom3.h"
+#include "TObjArray.h"
+#include "TLorentzVector.h"
+
+#include <stdexcept>
+#include <sstream>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+CMMomentumSmearing::CMMomentumSmearing() :
+  fFormula(0), fItInputArray(0)
+{
+  fFormula = new DelphesFormula;
+}
+
+//------------------------------------------------------------------------------
+
+CMMomentumSmearing::~CMMomentumSmearing()
+{
+  if(fFormula) delete fFormula;
+}
+
+//------------------------------------------------------------------------------
+
+void CMMomentumSmearing::Init()
+{
+  // read resolution formula
+  const char *expression = GetString("ResolutionFormula", "0.0");
+  fFormula->Compile(expression);
+  if(!fTable.compile(expression, fFormula))
+  {
+    stringstream message;
+    message << "resolution formula of " << GetName() << " is not piecewise constant, use the MomentumSmearing module instead";
+    throw runtime_error(message.str());
+  }
+
+  // import input array
+
+  fInputArray = ImportArray(GetString("InputArray", "ParticlePropagator/stableParticles"));
+  fItInputArray = fInputArray->MakeIterator();
+
+  // create output array
+
+  fOutputArray = ExportArray(GetString("OutputArray", "stableParticles"));
+}
+
+//------------------------------------------------------------------------------
+
+void CMMomentumSmearing::Finish()
+{
+  if(fItInputArray) delete fItInputArray;
+}
+
+//------------------------------------------------------------------------------
+
+void CMMomentumSmearing::Process()
+{
+  Candidate *candidate, *mother;
+  Double_t pt, eta, phi, e, res;
+
+  fItInputArray->Reset();
+  while((candidate = static_cast<Candidate*>(fItInputArray->Next())))
+  {
+    const TLorentzVector &candidatePosition = candidate->Position;
+    const TLorentzVector &candidateMomentum = candidate->Momentum;
+    eta = candidatePosition.Eta();
+    phi = candidatePosition.Phi();
+    pt = candidateMomentum.Pt();
+    e = candidateMomentum.E();
+    res = fTable.eval(pt, eta, phi, e);
+
+    // apply smearing formula
+    res = ( res > 1.0 ) ? 1.0 : res;
+    pt = LogNormal(pt, res * pt);
+
+    mother = candidate;
+    candidate = static_cast<Candidate*>(candidate->Clone());
+    eta = candidateMomentum.Eta();
+    phi = candidateMomentum.Phi();
+    candidate->Momentum.SetPtEtaPhiE(pt, eta, phi, pt * TMath::CosH(eta));
+    candidate->TrackResolution = res;
+    candidate->AddCandidate(mother);
+
+    fOutputArray->Add(candidate);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Double_t CMMomentumSmearing::LogNormal(Double_t mean, Double_t sigma)
+{
+  Double_t a, b;
+
+  if(mean > 0.0)
+  {
+    b = TMath::Sqrt(TMath::Log((1.0 + (sigma * sigma) / (mean * mean))));
+    a = TMath::Log(mean) - 0.5 * b * b;
+
+    return TMath::Exp(a + b * gRandom->Gaus(0.0, 1.0));
+  }
+  else
+  {
+    return 0.0;
+  }
+}
+
+//------------------------------------------------------------------------------
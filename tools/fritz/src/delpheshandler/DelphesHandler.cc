@@ -11,6 +11,7 @@ DelphesHandler::DelphesHandler() {
     treeWriterCM = NULL;
     treeWriter = NULL;
     branchEvent = NULL;
+    branchWeight = NULL;
     confReader = NULL;
     mainDelphes = NULL;
     factory = NULL;
@@ -22,20 +23,41 @@ DelphesHandler::DelphesHandler() {
     dLhefReader = NULL;
     readStopWatch = NULL;
     procStopWatch = NULL;
+    inputFile = NULL;
 #ifdef HAVE_PYTHIA
     pHandler = NULL;
     mainPythia = NULL;
 #endif
     delphesLogFile = "delphes.log";
+    haveRequiredBranches = false;
+    haveTaggingParticles = false;
+    taggingPTMin = 0;
+    taggingEtaMax = 0;
+    compiledFormulas = true;
+    procTime = 0;
+    nSimulatedEvents = 0;
     hasEvents = true;
+    truthVeto = false;
+    autoVeto = false;
+    haveAutoBounds = false;
+    vetoMETMin = 0;
+    vetoLeadingPTMin = 0;
+    vetoHTMin = 0;
+    eventVetoed = false;
+    nVetoedEvents = 0;
+    oversample = 1;
+    currentReplica = 0;
     name = "delpheshandler";
 }
 
 DelphesHandler::~DelphesHandler() {
+    clearInputCache();
     delete dHepmcReader;
     delete dStdhepReader;
     delete readStopWatch;
     delete procStopWatch;
+    if (inputFile != NULL)
+        fclose(inputFile);
     delete mainDelphes;
     delete confReader;
     delete treeWriter;
@@ -49,6 +71,12 @@ static const std::string keyPythiaHandler = "pythiahandler";
 static const std::string keyEventFile = "eventfile";
 static const std::string keyLogFile = "logfile";
 static const std::string keyOutputFile = "outputfile";
+static const std::string keyVetoMETMin = "vetometmin";
+static const std::string keyVetoLeadingPTMin = "vetoleadingptmin";
+static const std::string keyVetoHTMin = "vetohtmin";
+static const std::string keyAutoVeto = "autoveto";
+static const std::string keyOversample = "oversample";
+static const std::string keyCompiledFormulas = "compiledformulas";
 
 static void unknownKeys(Properties props) {
     std::vector<std::string> knownKeys;
@@ -58,6 +86,12 @@ static void unknownKeys(Properties props) {
     knownKeys.push_back(keyEventFile);
     knownKeys.push_back(keyLogFile);
     knownKeys.push_back(keyOutputFile);
+    knownKeys.push_back(keyVetoMETMin);
+    knownKeys.push_back(keyVetoLeadingPTMin);
+    knownKeys.push_back(keyVetoHTMin);
+    knownKeys.push_back(keyAutoVeto);
+    knownKeys.push_back(keyOversample);
+    knownKeys.push_back(keyCompiledFormulas);
     warnUnknownKeys(
         props,
         knownKeys,
@@ -75,9 +109,107 @@ void DelphesHandler::setupCommon(Properties props) {
             name,
             "settings is required."
             );
+    vetoMETMin = lookupOrDefault(props, keyVetoMETMin, 0.0);
+    vetoLeadingPTMin = lookupOrDefault(props, keyVetoLeadingPTMin, 0.0);
+    vetoHTMin = lookupOrDefault(props, keyVetoHTMin, 0.0);
+    autoVeto = (lookupOrDefault(props, keyAutoVeto, "false") == "true");
+    if (autoVeto && (vetoMETMin > 0 || vetoLeadingPTMin > 0 || vetoHTMin > 0)) {
+        Global::abort(
+                name,
+                "autoveto can not be combined with explicit veto bounds."
+                );
+    }
+    truthVeto = autoVeto || vetoMETMin > 0 || vetoLeadingPTMin > 0 || vetoHTMin > 0;
+    if (truthVeto && outputFile != "") {
+        Global::abort(
+                name,
+                "Vetoed events are not simulated, a truth veto can therefore"
+                    " not be combined with an output file."
+                );
+    }
+    oversample = lookupOrDefault(props, keyOversample, 1);
+    if (oversample < 1) {
+        Global::abort(
+                name,
+                "oversample has to be a positive number."
+                );
+    }
+    if (oversample > 1 && outputFile != "") {
+        Global::abort(
+                name,
+                "Replicas of an event would be stored as separate events, oversample"
+                    " can therefore not be combined with an output file."
+                );
+    }
+    compiledFormulas = (lookupOrDefault(props, keyCompiledFormulas, "true") == "true");
     initialiseDelphes(settings, logFile, outputFile);
 }
 
+void DelphesHandler::addTruthBounds(double metMin, double leadingPTMin, double htMin) {
+    if (!autoVeto)
+        return;
+    if (!haveAutoBounds) {
+        vetoMETMin = metMin;
+        vetoLeadingPTMin = leadingPTMin;
+        vetoHTMin = htMin;
+        haveAutoBounds = true;
+    } else {
+        vetoMETMin = std::min(vetoMETMin, metMin);
+        vetoLeadingPTMin = std::min(vetoLeadingPTMin, leadingPTMin);
+        vetoHTMin = std::min(vetoHTMin, htMin);
+    }
+    if (vetoMETMin <= 0 && vetoLeadingPTMin <= 0 && vetoHTMin <= 0) {
+        Global::warn(name, "autoveto is set, but not every analysis declares truth level bounds."
+                           " No event is vetoed.");
+        return;
+    }
+    Global::print(
+            name,
+            "Truth veto bounds: MET > "+Global::doubleToStr(vetoMETMin)+
+                ", leading lepton/jet pT > "+Global::doubleToStr(vetoLeadingPTMin)+
+                ", HT > "+Global::doubleToStr(vetoHTMin)
+            );
+}
+
+// Particles which leave no trace in the detector
+static bool isInvisible(Candidate* particle) {
+    int pid = abs(particle->PID);
+    if (pid == 12 || pid == 14 || pid == 16)
+        return true;
+    // neutral BSM particles (neutralinos, sneutrinos, gravitinos) and
+    //  the dark matter PDG codes used by common UFO models
+    return particle->Charge == 0 &&
+           (pid > 1000000 || (pid >= 51 && pid <= 59));
+}
+
+bool DelphesHandler::vetoEvent() {
+    eventVetoed = false;
+    if (!truthVeto)
+        return false;
+    double metX = 0, metY = 0, ht = 0, leptonPT = 0;
+    for(int i = 0; i < stableParticleOutputArray->GetEntriesFast(); i++) {
+        Candidate* particle = (Candidate*)stableParticleOutputArray->At(i);
+        const TLorentzVector& momentum = particle->Momentum;
+        if (isInvisible(particle)) {
+            metX += momentum.Px();
+            metY += momentum.Py();
+            continue;
+        }
+        double pt = momentum.Pt();
+        ht += pt;
+        int pid = abs(particle->PID);
+        if ((pid == 11 || pid == 13) && pt > leptonPT)
+            leptonPT = pt;
+    }
+    // a jet can not carry more pT than the whole visible event
+    eventVetoed = (sqrt(metX*metX+metY*metY) < vetoMETMin ||
+                   (leptonPT < vetoLeadingPTMin && ht < vetoLeadingPTMin) ||
+                   ht < vetoHTMin);
+    if (eventVetoed)
+        nVetoedEvents++;
+    return eventVetoed;
+}
+
 #ifdef HAVE_PYTHIA
 void DelphesHandler::setup(
         Properties props,
@@ -178,38 +310,46 @@ void DelphesHandler::setup(
     setupCommon(props);
     this->pHandler = pHandler;
     mainPythia = pHandler->mainPythia;
-    treeWriter->Clear();
-    mainDelphes->Clear();
 }
 #endif
+int DelphesHandler::eventFileMode(std::string fileName) {
+    // Figure out if the file is .stdhep, .lhe or .hepmc by looking at the file
+    std::ifstream x(fileName.c_str());
+    std::string firstLine;
+    x >> firstLine;
+    if(firstLine == "HepMC::Version")
+        return HepMCMode;
+    if(firstLine.find("LesHouchesEvents version") != std::string::npos)
+        return LHEFMode;
+    return STDHEPMode;
+}
+
 void DelphesHandler::setup(
         Properties props,
         EventFile eventFile
     ) {
     this->eventFile = eventFile;
-    std::string inputEventFileName = eventFile.filepath;
-
-    // Figure out if the file is .stdhep, .lhe or .hepmc by looking at the file
-    std::ifstream x(inputEventFileName.c_str());
-    std::string firstLine;
-    x >> firstLine;
-    if(firstLine == "HepMC::Version") {
+    mode = eventFileMode(eventFile.filepath);
+    if(mode == HepMCMode) {
         Global::print(name, "Input File determined to be HepMC.");
         dHepmcReader = new DelphesHepMCReader();
-        mode = HepMCMode;
     }
-    else if(firstLine.find("LesHouchesEvents version") != std::string::npos){
+    else if(mode == LHEFMode){
         Global::print(name, "Input File determined to be LHEF.");
         dLhefReader = new DelphesLHEFReader();
-        mode = LHEFMode;
     }
     else {
         Global::print(name, "Input File determined to be STDHEP.");
         dStdhepReader = new DelphesSTDHEPReader();
-        mode = STDHEPMode;
     }
     setupCommon(props); 
-    FILE*inputFile = fopen(inputEventFileName.c_str(), "r");
+    openEventFile(eventFile.filepath);
+}
+
+void DelphesHandler::openEventFile(std::string inputEventFileName) {
+    if(inputFile != NULL)
+        fclose(inputFile);
+    inputFile = fopen(inputEventFileName.c_str(), "r");
     if(inputFile == NULL)
         Global::abort(name, "Cannot read "+inputEventFileName);
     fseek(inputFile, 0L, SEEK_END);
@@ -217,12 +357,11 @@ void DelphesHandler::setup(
     fseek(inputFile, 0L, SEEK_SET);
     if(length <= 0) {
         fclose(inputFile);
+        inputFile = NULL;
         Global::abort(name, "Cannot read "+inputEventFileName);
     }
 
     Global::redirect_cout(delphesLogFile);
-    treeWriter->Clear();
-    mainDelphes->Clear();
     if(dHepmcReader) {
         dHepmcReader->SetInputFile(inputFile);
         dHepmcReader->Clear();
@@ -239,6 +378,27 @@ void DelphesHandler::setup(
     Global::print(name, "Input file successfully opened!");
 }
 
+bool DelphesHandler::readsEventFile() {
+    return mode != PythiaMode;
+}
+
+void DelphesHandler::startJob(EventFile eventFile) {
+    if (!readsEventFile())
+        Global::abort(name, "Scan jobs need a DelphesHandler reading an event file.");
+    if (eventFileMode(eventFile.filepath) != mode)
+        Global::abort(name, "The event file "+eventFile.filepath+" of a scan job must"
+                            " have the same format as the initial one.");
+    Global::print(name, "Switching to input event "+eventFile.filepath);
+    this->eventFile = eventFile;
+    hasEvents = true;
+    nVetoedEvents = 0;
+    Global::redirect_cout(delphesLogFile);
+    treeWriter->Clear();
+    mainDelphes->Clear();
+    Global::unredirect_cout();
+    openEventFile(eventFile.filepath);
+}
+
 bool DelphesHandler::processEvent(int iEvent) {
     /* We have to clear at the beginning of an event
      * to make sure that results are kept for later handlers
@@ -250,6 +410,7 @@ bool DelphesHandler::processEvent(int iEvent) {
 
     treeWriter->Clear();
     mainDelphes->Clear();
+    currentReplica = 0;
 
     Global::redirect_cout(delphesLogFile);
 
@@ -261,7 +422,11 @@ bool DelphesHandler::processEvent(int iEvent) {
             return false;
         }
         readPythiaEvent(iEvent);
-        mainDelphes->ProcessTask();
+        if (!vetoEvent()) {
+            if (oversample > 1)
+                cacheInputParticles();
+            runModules();
+        }
     }
     else
 #endif 
@@ -277,11 +442,16 @@ bool DelphesHandler::processEvent(int iEvent) {
             if(dHepmcReader->EventReady())
                 break;
         }
-        mainDelphes->ProcessTask();
+        if (!vetoEvent()) {
+            if (oversample > 1)
+                cacheInputParticles();
+            runModules();
+        }
         dHepmcReader->AnalyzeEvent(branchEvent,
                                    iEvent,
                                    readStopWatch,
                                    procStopWatch);
+        dHepmcReader->AnalyzeWeight(branchWeight);
     }
     else if (dStdhepReader) {
         while(true) {
@@ -295,7 +465,11 @@ bool DelphesHandler::processEvent(int iEvent) {
             if(dStdhepReader->EventReady())
                 break;
         }
-        mainDelphes->ProcessTask();
+        if (!vetoEvent()) {
+            if (oversample > 1)
+                cacheInputParticles();
+            runModules();
+        }
         dStdhepReader->AnalyzeEvent(branchEvent,
                                     iEvent,
                                     readStopWatch,
@@ -313,11 +487,16 @@ bool DelphesHandler::processEvent(int iEvent) {
             if(dLhefReader->EventReady())
                 break;
         }
-        mainDelphes->ProcessTask();
+        if (!vetoEvent()) {
+            if (oversample > 1)
+                cacheInputParticles();
+            runModules();
+        }
         dLhefReader->AnalyzeEvent(branchEvent,
                                     iEvent,
                                     readStopWatch,
                                     procStopWatch);
+        dLhefReader->AnalyzeWeight(branchWeight);
     }
     else{
         Global::abort(name, "no valid input source");
@@ -328,14 +507,88 @@ bool DelphesHandler::processEvent(int iEvent) {
         dHepmcReader->Clear();
     if(dStdhepReader)
         dStdhepReader->Clear();
+    if(dLhefReader)
+        dLhefReader->Clear(); // also resets the weight list of the event
     Global::unredirect_cout();
     return true;
 }
 
+void DelphesHandler::runModules() {
+    procStopWatch->Start();
+    mainDelphes->ProcessTask();
+    procStopWatch->Stop();
+    procTime += procStopWatch->RealTime();
+    nSimulatedEvents++;
+}
+
 bool DelphesHandler::hasNextEvent() {
     return hasEvents;
 }
 
+bool DelphesHandler::nextReplica() {
+    if (eventVetoed || currentReplica+1 >= oversample)
+        return false;
+    currentReplica++;
+    // Event and Weight branches are not refilled, the replicas share
+    //  the information of the first pass
+    Global::redirect_cout(delphesLogFile);
+    treeWriter->Clear();
+    mainDelphes->Clear();
+    restoreInputParticles();
+    runModules();
+    Global::unredirect_cout();
+    return true;
+}
+
+void DelphesHandler::cacheInputParticles() {
+    clearInputCache();
+    // stable particles and partons are also contained in allParticles
+    std::map<TObject*, int> index;
+    TObjArray* arrays[3] = {allParticleOutputArray,
+                            stableParticleOutputArray,
+                            partonOutputArray};
+    std::vector<int>* cached[3] = {&cachedAllParticles,
+                                   &cachedStableParticles,
+                                   &cachedPartons};
+    for(int a = 0; a < 3; a++) {
+        for(int i = 0; i < arrays[a]->GetEntriesFast(); i++) {
+            TObject* particle = arrays[a]->At(i);
+            std::map<TObject*, int>::iterator it = index.find(particle);
+            if (it == index.end()) {
+                Candidate* copy = new Candidate();
+                particle->Copy(*copy);
+                it = index.insert(std::make_pair(particle, (int)cachedParticles.size())).first;
+                cachedParticles.push_back(copy);
+            }
+            cached[a]->push_back(it->second);
+        }
+    }
+}
+
+void DelphesHandler::restoreInputParticles() {
+    std::vector<Candidate*> particles;
+    for(int i = 0; i < cachedParticles.size(); i++) {
+        Candidate* candidate = factory->NewCandidate();
+        cachedParticles[i]->Copy(*candidate);
+        particles.push_back(candidate);
+    }
+    for(int i = 0; i < cachedAllParticles.size(); i++)
+        allParticleOutputArray->Add(particles[cachedAllParticles[i]]);
+    for(int i = 0; i < cachedStableParticles.size(); i++)
+        stableParticleOutputArray->Add(particles[cachedStableParticles[i]]);
+    for(int i = 0; i < cachedPartons.size(); i++)
+        partonOutputArray->Add(particles[cachedPartons[i]]);
+}
+
+void DelphesHandler::clearInputCache() {
+    for(int i = 0; i < cachedParticles.size(); i++)
+        delete cachedParticles[i];
+    cachedParticles.clear();
+    cachedAllParticles.clear();
+    cachedStableParticles.clear();
+    cachedPartons.clear();
+}
+
 double DelphesHandler::getCrossSection() {
 #ifdef HAVE_PYTHIA
     if (pHandler!=NULL) {
@@ -360,6 +613,15 @@ void DelphesHandler::finish() {
     mainDelphes->FinishTask();
     treeWriter->Write();
     Global::unredirect_cout();
+    if (truthVeto)
+        Global::print(name, Global::intToStr(nVetoedEvents)+" events failed the truth veto"
+                            " and skipped the detector simulation");
+    if (oversample > 1)
+        Global::print(name, "Every event was simulated "+Global::intToStr(oversample)+" times");
+    if (nSimulatedEvents > 0)
+        Global::print(name, "The Delphes modules took "
+                            +Global::doubleToStr(1000.*procTime/nSimulatedEvents)
+                            +" ms per event");
     Global::print(name, "Delphes successfully finished!");
 }
 
@@ -367,6 +629,7 @@ void DelphesHandler::initialiseDelphes(std::string configFile,
                                        std::string logFile,
                                        std::string outputRootFileName) {
     delphesLogFile = logFile;
+    delphesConfigFile = configFile;
     // First, set up general Delphes readers and writers
     Global::print(name, "Initialising settings from "+configFile);
     // If output file is required, set it up such that the treeWriter writes to it
@@ -387,14 +650,17 @@ void DelphesHandler::initialiseDelphes(std::string configFile,
 
     if (mode == HepMCMode || mode == PythiaMode) {
         branchEvent = treeWriter->NewBranch("Event", HepMCEvent::Class());
-    } else if (mode == STDHEPMode || mode == LHEFMode) {
+        branchWeight = treeWriter->NewBranch("Weight", Weight::Class());
+    } else if (mode == LHEFMode) {
+        branchEvent = treeWriter->NewBranch("Event", LHEFEvent::Class());
+        branchWeight = treeWriter->NewBranch("Weight", LHEFWeight::Class());
+    } else if (mode == STDHEPMode) {
         branchEvent = treeWriter->NewBranch("Event", LHEFEvent::Class());
     } else {
         Global::abort(name, "Unknown Delphes mode");
     }
 
     confReader = new ExRootConfReader;
-    confReader->ReadFile(configFile.c_str());
 
     mainDelphes = new Delphes("Delphes");
     mainDelphes->SetConfReader(confReader);
@@ -407,11 +673,321 @@ void DelphesHandler::initialiseDelphes(std::string configFile,
     allParticleOutputArray = mainDelphes->ExportArray("allParticles");
     stableParticleOutputArray = mainDelphes->ExportArray("stableParticles");
     partonOutputArray = mainDelphes->ExportArray("partons");
+    Global::unredirect_cout();
+}
 
-    mainDelphes->InitTask();
+void DelphesHandler::addAnalysisHandler(std::string handlerName) {
+    analysisHandlers.push_back(handlerName);
+    if (oversample > 1 && analysisHandlers.size() > 1) {
+        Global::abort(
+                name,
+                "oversample can only be used with one analysishandler, but "
+                    +analysisHandlers[0]+" and "+handlerName+" read the events."
+                );
+    }
+}
+
+void DelphesHandler::requireBranches(const std::set<std::string>& branches) {
+    haveRequiredBranches = true;
+    requiredBranches.insert(branches.begin(), branches.end());
+}
+
+void DelphesHandler::requireTaggingParticles(double ptMin, double etaMax) {
+    if (!haveTaggingParticles) {
+        taggingPTMin = ptMin;
+        taggingEtaMax = etaMax;
+        haveTaggingParticles = true;
+    } else {
+        taggingPTMin = std::min(taggingPTMin, ptMin);
+        taggingEtaMax = std::max(taggingEtaMax, etaMax);
+    }
+    requiredBranches.insert("TaggingParticle");
+}
+
+void DelphesHandler::initialiseModules() {
+    std::string configFile = delphesConfigFile;
+    if ((outputRootFile == NULL && haveRequiredBranches) || compiledFormulas ||
+        haveTaggingParticles)
+        configFile = rewriteConfigFile();
+    Global::redirect_cout(delphesLogFile);
+    confReader->ReadFile(configFile.c_str());
+    // the modules take their parameters from the parsed card, not the file
+    if (configFile != delphesConfigFile)
+        unlink(configFile.c_str());
+    try {
+        mainDelphes->InitTask();
+    } catch (std::runtime_error& e) {
+        Global::unredirect_cout();
+        Global::abort(name, "Delphes could not be initialised: "+std::string(e.what()));
+    }
+    treeWriter->Clear();
+    mainDelphes->Clear();
     Global::unredirect_cout();
     Global::print(name, "Delphes successfully initialised!");
 }
+
+// Fills a lookup table the way CMEfficiency and CMMomentumSmearing do in
+//  Init(), where a failure is a runtime_error that stops Delphes
+static bool fillsFormulaTable(std::string expression) {
+    // Tcl replaces the line continuations by spaces
+    std::replace(expression.begin(), expression.end(), '\\', ' ');
+    DelphesFormula formula;
+    FormulaTable table;
+    try {
+        formula.Compile(expression.c_str());
+        return table.compile(expression, &formula);
+    } catch (std::runtime_error& e) {
+        return false;
+    }
+}
+
+// Splits a line of a Tcl card into words, braces being separate words
+static std::vector<std::string> cardWords(std::string line) {
+    std::vector<std::string> words;
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos || line[start] == '#')
+        return words;
+    std::string padded;
+    for (int i = 0; i < line.size(); i++) {
+        if (line[i] == '{' || line[i] == '}')
+            padded += std::string(" ")+line[i]+" ";
+        else
+            padded += line[i];
+    }
+    std::istringstream stream(padded);
+    std::string word;
+    while (stream >> word)
+        words.push_back(word);
+    return words;
+}
+
+std::string DelphesHandler::rewriteConfigFile() {
+    std::ifstream card(delphesConfigFile.c_str());
+    if (!card.good()) {
+        Global::warn(name, "Can not read "+delphesConfigFile+", the detector card is used as it is.");
+        return delphesConfigFile;
+    }
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(card, line))
+        lines.push_back(line);
+
+    // module name -> modules whose output arrays it reads
+    std::map<std::string, std::set<std::string> > inputs;
+    std::map<std::string, std::string> moduleClasses;
+    std::map<std::string, int> moduleLines;
+    std::map<std::string, std::string> formulas; // efficiency or resolution formula
+    std::vector<std::string> executionPath;
+    int pathStart = -1, pathEnd = -1;
+    std::string treeWriterName;
+    std::vector<int> branchLines; // "add Branch Input/array Name Class" lines of the TreeWriter
+    std::map<int, std::string> branchSources, branchNames;
+    std::string module;
+    bool inPath = false;
+    bool inFormula = false;
+    int formulaDepth = 0;
+    int depth = 0;
+    for (int l = 0; l < lines.size(); l++) {
+        std::vector<std::string> words = cardWords(lines[l]);
+        if (depth == 0 && words.size() >= 3 && words[0] == "module") {
+            module = words[2];
+            inputs[module];
+            moduleClasses[module] = words[1];
+            moduleLines[module] = l;
+            if (words[1] == "TreeWriter")
+                treeWriterName = module;
+        }
+        if (depth == 0 && words.size() >= 2 && words[0] == "set" && words[1] == "ExecutionPath") {
+            inPath = true;
+            pathStart = l;
+        }
+        if (depth == 1 && module != "" && words.size() >= 3 && words[0] == "set" &&
+            (words[1] == "EfficiencyFormula" || words[1] == "ResolutionFormula") &&
+            words[2] == "{") {
+            inFormula = true;
+            formulaDepth = 0;
+            formulas[module] = "";
+        }
+        if (inFormula && !words.empty()) {
+            // the text between the outer braces, as Delphes gets it from Tcl
+            for (int i = 0; i < lines[l].size() && inFormula; i++) {
+                char c = lines[l][i];
+                if (c == '{' && ++formulaDepth == 1)
+                    continue;
+                if (c == '}' && --formulaDepth == 0)
+                    inFormula = false;
+                else if (formulaDepth > 0)
+                    formulas[module] += c;
+            }
+            formulas[module] += " ";
+        }
+        if (inPath) {
+            for (int w = 0; w < words.size(); w++)
+                if (words[w] != "set" && words[w] != "ExecutionPath" &&
+                    words[w] != "{" && words[w] != "}")
+                    executionPath.push_back(words[w]);
+        } else if (module != "") {
+            for (int w = 0; w < words.size(); w++)
+                if (words[w].find('/') != std::string::npos)
+                    inputs[module].insert(words[w].substr(0, words[w].find('/')));
+            if (module == treeWriterName && words.size() >= 5 &&
+                words[0] == "add" && words[1] == "Branch") {
+                branchLines.push_back(l);
+                branchSources[l] = words[2].substr(0, words[2].find('/'));
+                branchNames[l] = words[3];
+            }
+        }
+        for (int w = 0; w < words.size(); w++) {
+            if (words[w] == "{")
+                depth++;
+            else if (words[w] == "}")
+                depth--;
+        }
+        if (depth == 0) {
+            if (inPath)
+                pathEnd = l;
+            inPath = false;
+            module = "";
+        }
+    }
+    if (pathStart < 0 || pathEnd < 0 || treeWriterName == "") {
+        Global::warn(name, "Can not find the ExecutionPath and TreeWriter in "
+                           +delphesConfigFile+", the detector card is used as it is.");
+        return delphesConfigFile;
+    }
+
+    // the truth particles of the taggers get their own skimmer and branch,
+    //  such that the full Particle branch is not needed
+    const std::string skimmerName = "TaggingParticleSkimmer";
+    bool addSkimmer = haveTaggingParticles && moduleClasses.count(skimmerName) == 0;
+    for (int b = 0; b < branchLines.size(); b++)
+        if (branchNames[branchLines[b]] == "TaggingParticle")
+            addSkimmer = false;
+    if (addSkimmer) {
+        executionPath.insert(
+                std::find(executionPath.begin(), executionPath.end(), treeWriterName),
+                skimmerName);
+        inputs[skimmerName];
+        // line -1 stands for the branch added to the TreeWriter
+        branchLines.push_back(-1);
+        branchSources[-1] = skimmerName;
+        branchNames[-1] = "TaggingParticle";
+    }
+
+    // the analysis handlers are the only readers of the branches if nothing
+    //  is stored: keep every module some required branch depends on
+    std::set<int> droppedLines;
+    std::string droppedBranches;
+    std::set<std::string> needed(executionPath.begin(), executionPath.end());
+    if (outputRootFile == NULL && haveRequiredBranches) {
+        std::vector<std::string> queue;
+        needed.clear();
+        needed.insert(treeWriterName);
+        for (int b = 0; b < branchLines.size(); b++) {
+            int l = branchLines[b];
+            if (requiredBranches.count(branchNames[l]) == 0) {
+                droppedLines.insert(l);
+                droppedBranches += " "+branchNames[l];
+            } else {
+                queue.push_back(branchSources[l]);
+            }
+        }
+        while (!queue.empty()) {
+            std::string m = queue.back();
+            queue.pop_back();
+            if (inputs.count(m) == 0 || needed.count(m) > 0)
+                continue; // Delphes/... input arrays or already visited
+            needed.insert(m);
+            queue.insert(queue.end(), inputs[m].begin(), inputs[m].end());
+        }
+    }
+    std::vector<std::string> prunedPath;
+    std::string droppedModules;
+    for (int i = 0; i < executionPath.size(); i++) {
+        if (needed.count(executionPath[i]) > 0)
+            prunedPath.push_back(executionPath[i]);
+        else
+            droppedModules += " "+executionPath[i];
+    }
+
+    // piecewise constant formulas are evaluated via lookup tables
+    std::map<int, std::string> replacedLines;
+    std::string tabulatedModules;
+    for (int i = 0; compiledFormulas && i < prunedPath.size(); i++) {
+        std::string m = prunedPath[i];
+        std::string compiledClass;
+        if (moduleClasses[m] == "Efficiency")
+            compiledClass = "CMEfficiency";
+        else if (moduleClasses[m] == "MomentumSmearing")
+            compiledClass = "CMMomentumSmearing";
+        if (compiledClass == "" || formulas.count(m) == 0 ||
+            !FormulaTable::tabulable(formulas[m]))
+            continue;
+        if (!fillsFormulaTable(formulas[m])) {
+            Global::warn(name, "Can not build a lookup table for the formula of "+m
+                               +", keeping the Delphes "+moduleClasses[m]+" module");
+            continue;
+        }
+        replacedLines[moduleLines[m]] = "module "+compiledClass+" "+m+" {";
+        tabulatedModules += " "+m;
+    }
+    if (droppedModules == "" && droppedBranches == "" && tabulatedModules == "" &&
+        !addSkimmer)
+        return delphesConfigFile;
+
+    // a unique name, as several runs may share the directory of the log file
+    std::string cardTemplate = delphesLogFile+".card.XXXXXX";
+    std::vector<char> cardName(cardTemplate.begin(), cardTemplate.end());
+    cardName.push_back('\0');
+    int cardFd = mkstemp(&cardName[0]);
+    if (cardFd < 0)
+        Global::abort(name, "Can not create the detector card "+cardTemplate);
+    close(cardFd);
+    std::string cardFile = &cardName[0];
+    std::ofstream rewritten(cardFile.c_str());
+    for (int l = 0; l < lines.size(); l++) {
+        if (l == pathStart) {
+            rewritten << "set ExecutionPath {" << std::endl;
+            for (int i = 0; i < prunedPath.size(); i++)
+                rewritten << "  " << prunedPath[i] << std::endl;
+            rewritten << "}" << std::endl;
+        }
+        if ((l >= pathStart && l <= pathEnd) || droppedLines.count(l) > 0)
+            continue;
+        if (replacedLines.count(l) > 0)
+            rewritten << replacedLines[l] << std::endl;
+        else
+            rewritten << lines[l] << std::endl;
+        if (addSkimmer && l == moduleLines[treeWriterName])
+            rewritten << "  add Branch " << skimmerName
+                      << "/particles TaggingParticle GenParticle" << std::endl;
+    }
+    if (addSkimmer) {
+        rewritten << std::endl
+                  << "module TaggingParticlesSkimmer " << skimmerName << " {" << std::endl
+                  << "  set ParticleInputArray Delphes/allParticles" << std::endl
+                  << "  set PartonInputArray Delphes/partons" << std::endl
+                  << "  set OutputArray particles" << std::endl
+                  << "  set PTMin " << taggingPTMin << std::endl
+                  << "  set EtaMax " << taggingEtaMax << std::endl
+                  << "}" << std::endl;
+    }
+    if (!rewritten.good())
+        Global::abort(name, "Can not write the detector card "+cardFile);
+    if (droppedBranches != "")
+        Global::print(name, "No analysis reads the branches"+droppedBranches);
+    if (droppedModules != "")
+        Global::print(name, "Removed the unused modules"+droppedModules);
+    else if (droppedBranches != "")
+        Global::print(name, "All modules are needed by the remaining branches");
+    if (tabulatedModules != "")
+        Global::print(name, "Using lookup tables for the formulas of"+tabulatedModules);
+    if (addSkimmer)
+        Global::print(name, "Writing the truth b, c and taus with pT > "
+                            +Global::doubleToStr(taggingPTMin)+" and |eta| < "
+                            +Global::doubleToStr(taggingEtaMax)+" to the TaggingParticle branch");
+    return cardFile;
+}
 #ifdef HAVE_PYTHIA
 void DelphesHandler::readPythiaEvent(int iEvent) {
     // Translates Pythia HepMC event into Delphes event format
@@ -447,6 +1023,13 @@ void DelphesHandler::readPythiaEvent(int iEvent) {
     element->ReadTime = readStopWatch->RealTime();
     element->ProcTime = procStopWatch->RealTime();
 
+    // all weights, e.g. from UncertaintyBands, in the same layout the HepMC reader uses:
+    // the first one is the nominal weight, the others are variations
+    for(int i = 0; i < mainPythia->info.nWeights(); ++i) {
+        Weight *weight = static_cast<Weight *>(branchWeight->NewEntry());
+        weight->Weight = mainPythia->info.weight(i);
+    }
+
     pdg = TDatabasePDG::Instance();
     for(int i = 1; i < mainPythia->event.size(); ++i) {
         Pythia8::Particle &particle = mainPythia->event[i];
@@ -0,0 +1,378 @@
+#include "FormulaTable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "classes/DelphesFormula.h"
+
+static const int maxTableSize = 1 << 16;
+
+// Parse tree of a card formula, only used to find its table keys
+struct formula_node {
+    enum node_type {
+        Number,
+        Variable,
+        Call,
+        Unary,
+        Binary
+    };
+    int type;
+    std::string op; // operator or function name
+    double value; // for Number
+    int variable; // for Variable, -1 if unknown
+    std::vector<formula_node*> args;
+};
+
+static void deleteNode(formula_node* node) {
+    if (node == NULL)
+        return;
+    for (int i = 0; i < node->args.size(); i++)
+        deleteNode(node->args[i]);
+    delete node;
+}
+
+static formula_node* newNode(int type, std::string op) {
+    formula_node* node = new formula_node;
+    node->type = type;
+    node->op = op;
+    node->value = 0;
+    node->variable = -1;
+    return node;
+}
+
+// Splits a formula into numbers, names and operators
+static bool tokenize(std::string expression, std::vector<std::string>& tokens) {
+    size_t i = 0;
+    while (i < expression.size()) {
+        char c = expression[i];
+        if (isspace(c) || c == '\\') {
+            i++;
+        } else if (isdigit(c) || c == '.') {
+            const char* start = expression.c_str()+i;
+            char* end;
+            strtod(start, &end);
+            if (end == start)
+                return false;
+            tokens.push_back(expression.substr(i, end-start));
+            i += end-start;
+        } else if (isalpha(c) || c == '_') {
+            size_t j = i;
+            while (j < expression.size() &&
+                   (isalnum(expression[j]) || expression[j] == '_' || expression[j] == ':'))
+                j++;
+            tokens.push_back(expression.substr(i, j-i));
+            i = j;
+        } else {
+            std::string two = expression.substr(i, 2);
+            if (two == "<=" || two == ">=" || two == "==" || two == "!=" ||
+                two == "&&" || two == "||") {
+                tokens.push_back(two);
+                i += 2;
+            } else if (std::string("+-*/%^<>!(),").find(c) != std::string::npos) {
+                tokens.push_back(std::string(1, c));
+                i++;
+            } else {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Recursive descent parser with the C operator precedences of TFormula,
+//  ^ being the power operator
+class FormulaParser {
+public:
+    FormulaParser(const std::vector<std::string>& tokens) : tokens(tokens), pos(0) {}
+
+    formula_node* parse() {
+        formula_node* node = parseBinary(0);
+        if (node != NULL && pos != tokens.size()) {
+            deleteNode(node);
+            return NULL;
+        }
+        return node;
+    }
+
+private:
+    const std::vector<std::string>& tokens;
+    size_t pos;
+
+    std::string peek() {
+        return pos < tokens.size() ? tokens[pos] : "";
+    }
+
+    static bool isLevelOperator(int level, std::string token) {
+        switch (level) {
+            case 0: return token == "||";
+            case 1: return token == "&&";
+            case 2: return token == "==" || token == "!=";
+            case 3: return token == "<" || token == "<=" || token == ">" || token == ">=";
+            case 4: return token == "+" || token == "-";
+            case 5: return token == "*" || token == "/" || token == "%";
+        }
+        return false;
+    }
+
+    formula_node* parseBinary(int level) {
+        if (level > 5)
+            return parseUnary();
+        formula_node* left = parseBinary(level+1);
+        while (left != NULL && isLevelOperator(level, peek())) {
+            formula_node* node = newNode(formula_node::Binary, tokens[pos++]);
+            node->args.push_back(left);
+            formula_node* right = parseBinary(level+1);
+            if (right == NULL) {
+                deleteNode(node);
+                return NULL;
+            }
+            node->args.push_back(right);
+            left = node;
+        }
+        return left;
+    }
+
+    formula_node* parseUnary() {
+        std::string token = peek();
+        if (token == "-" || token == "+" || token == "!") {
+            pos++;
+            formula_node* arg = parseUnary();
+            if (arg == NULL)
+                return NULL;
+            formula_node* node = newNode(formula_node::Unary, token);
+            node->args.push_back(arg);
+            return node;
+        }
+        formula_node* base = parsePrimary();
+        if (base == NULL || peek() != "^")
+            return base;
+        pos++;
+        formula_node* exponent = parseUnary();
+        if (exponent == NULL) {
+            deleteNode(base);
+            return NULL;
+        }
+        formula_node* node = newNode(formula_node::Binary, "^");
+        node->args.push_back(base);
+        node->args.push_back(exponent);
+        return node;
+    }
+
+    formula_node* parsePrimary() {
+        if (pos >= tokens.size())
+            return NULL;
+        std::string token = tokens[pos++];
+        if (isdigit(token[0]) || token[0] == '.') {
+            formula_node* node = newNode(formula_node::Number, token);
+            node->value = strtod(token.c_str(), NULL);
+            return node;
+        }
+        if (token == "(") {
+            formula_node* node = parseBinary(0);
+            if (node != NULL && peek() != ")") {
+                deleteNode(node);
+                return NULL;
+            }
+            pos++;
+            return node;
+        }
+        if (!isalpha(token[0]) && token[0] != '_')
+            return NULL;
+        if (peek() != "(") {
+            formula_node* node = newNode(formula_node::Variable, token);
+            const char* variables[] = {"pt", "eta", "phi", "energy"};
+            for (int v = 0; v < 4; v++)
+                if (token == variables[v])
+                    node->variable = v;
+            return node;
+        }
+        pos++;
+        formula_node* node = newNode(formula_node::Call, token);
+        if (peek() == ")") {
+            pos++;
+            return node;
+        }
+        while (true) {
+            formula_node* arg = parseBinary(0);
+            if (arg == NULL) {
+                deleteNode(node);
+                return NULL;
+            }
+            node->args.push_back(arg);
+            std::string separator = peek();
+            pos++;
+            if (separator == ")")
+                return node;
+            if (separator != ",") {
+                deleteNode(node);
+                return NULL;
+            }
+        }
+    }
+};
+
+// Returns the variable of key nodes, i.e. a known variable or the absolute value of one
+static int keyVariable(formula_node* node, bool& absolute) {
+    absolute = false;
+    if (node->type == formula_node::Call && node->args.size() == 1 &&
+        (node->op == "abs" || node->op == "fabs" || node->op == "TMath::Abs")) {
+        absolute = true;
+        node = node->args[0];
+    }
+    if (node->type == formula_node::Variable)
+        return node->variable;
+    return -1;
+}
+
+// Numbers a key is compared with have to be plain literals
+static bool literalValue(formula_node* node, double& value) {
+    if (node->type == formula_node::Number) {
+        value = node->value;
+        return true;
+    }
+    if (node->type == formula_node::Unary && node->op == "-" &&
+        node->args[0]->type == formula_node::Number) {
+        value = -node->args[0]->value;
+        return true;
+    }
+    return false;
+}
+
+static bool addBound(std::vector<FormulaTable::table_key>& keys,
+                     int variable,
+                     bool absolute,
+                     double bound) {
+    for (int k = 0; k < keys.size(); k++) {
+        if (keys[k].variable != variable)
+            continue;
+        // the cells of eta and abs(eta) are not independent
+        if (keys[k].absolute != absolute)
+            return false;
+        keys[k].bounds.push_back(bound);
+        return true;
+    }
+    FormulaTable::table_key key;
+    key.variable = variable;
+    key.absolute = absolute;
+    key.bounds.push_back(bound);
+    key.stride = 0;
+    keys.push_back(key);
+    return true;
+}
+
+// True if every variable in node is compared with a literal
+static bool collectKeys(formula_node* node, std::vector<FormulaTable::table_key>& keys) {
+    if (node->type == formula_node::Variable)
+        return false;
+    if (node->type == formula_node::Binary &&
+        (node->op == "<" || node->op == "<=" || node->op == ">" || node->op == ">=" ||
+         node->op == "==" || node->op == "!=")) {
+        bool absolute;
+        double bound;
+        int variable = keyVariable(node->args[0], absolute);
+        if (variable >= 0 && literalValue(node->args[1], bound))
+            return addBound(keys, variable, absolute, bound);
+        variable = keyVariable(node->args[1], absolute);
+        if (variable >= 0 && literalValue(node->args[0], bound))
+            return addBound(keys, variable, absolute, bound);
+    }
+    for (int i = 0; i < node->args.size(); i++)
+        if (!collectKeys(node->args[i], keys))
+            return false;
+    return true;
+}
+
+FormulaTable::FormulaTable() {
+    formula = NULL;
+}
+
+bool FormulaTable::findKeys(std::string expression, std::vector<table_key>& keys) {
+    keys.clear();
+    std::vector<std::string> tokens;
+    if (!tokenize(expression, tokens) || tokens.empty())
+        return false;
+    FormulaParser parser(tokens);
+    formula_node* root = parser.parse();
+    if (root == NULL)
+        return false;
+    bool ok = collectKeys(root, keys);
+    deleteNode(root);
+    if (!ok)
+        return false;
+
+    long size = 1;
+    for (int k = 0; k < keys.size(); k++) {
+        std::vector<double>& bounds = keys[k].bounds;
+        std::sort(bounds.begin(), bounds.end());
+        bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+        keys[k].stride = size;
+        size *= 2*bounds.size()+1;
+        if (size > maxTableSize)
+            return false;
+    }
+    return true;
+}
+
+bool FormulaTable::tabulable(std::string expression) {
+    std::vector<table_key> keys;
+    return findKeys(expression, keys);
+}
+
+int FormulaTable::cell(const std::vector<double>& bounds, double x) {
+    int i = std::lower_bound(bounds.begin(), bounds.end(), x) - bounds.begin();
+    if (i < bounds.size() && bounds[i] == x)
+        return 2*i+1;
+    return 2*i;
+}
+
+double FormulaTable::representative(const table_key& key, int cell) {
+    const std::vector<double>& bounds = key.bounds;
+    int i = cell/2;
+    if (cell % 2 == 1)
+        return bounds[i];
+    if (i == 0)
+        return bounds[0] > 0 ? bounds[0]/2 : bounds[0]-1;
+    if (i == bounds.size())
+        return bounds[i-1]+fabs(bounds[i-1])+1;
+    return bounds[i-1]+(bounds[i]-bounds[i-1])/2;
+}
+
+bool FormulaTable::compile(std::string expression, DelphesFormula* delphesFormula) {
+    formula = delphesFormula;
+    values.clear();
+    if (!findKeys(expression, keys))
+        return false;
+    int size = 1;
+    for (int k = 0; k < keys.size(); k++)
+        size *= 2*keys[k].bounds.size()+1;
+    for (int index = 0; index < size; index++) {
+        double x[4] = {0, 0, 0, 0};
+        for (int k = 0; k < keys.size(); k++) {
+            int c = (index/keys[k].stride) % (2*keys[k].bounds.size()+1);
+            x[keys[k].variable] = representative(keys[k], c);
+            // negative values of an absolute key can never be looked up
+            if (keys[k].absolute && x[keys[k].variable] < 0)
+                continue;
+            // neighbouring bounds without a number in between
+            if (cell(keys[k].bounds, x[keys[k].variable]) != c) {
+                values.clear();
+                return false;
+            }
+        }
+        values.push_back(formula->Eval(x[0], x[1], x[2], x[3]));
+    }
+    return true;
+}
+
+double FormulaTable::eval(double pt, double eta, double phi, double energy) {
+    double x[4] = {pt, eta, phi, energy};
+    int index = 0;
+    for (int k = 0; k < keys.size(); k++) {
+        double v = keys[k].absolute ? fabs(x[keys[k].variable]) : x[keys[k].variable];
+        if (v != v)
+            return formula->Eval(pt, eta, phi, energy);
+        index += keys[k].stride*cell(keys[k].bounds, v);
+    }
+    return values[index];
+}
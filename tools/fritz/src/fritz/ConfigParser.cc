@@ -314,8 +314,6 @@ void Parser::errorLocation(std::stringstream& msg) {
 }
 
 Config parseConfigFile(std::string path) {
-	Config conf;
-
 	std::fstream file;
 	file.open(path.c_str(), std::fstream::in);
 	if (file.fail()) {
@@ -324,8 +322,13 @@ Config parseConfigFile(std::string path) {
 		Global::abort("ConfigParser", msg.str());
 	}
 
+        return parseConfigStream(file);
+}
+
+Config parseConfigStream(std::istream &in) {
+	Config conf;
         try {
-            Parser p(file);
+            Parser p(in);
             while (p.parseSection(conf) == Ok);
         } catch(std::string msg) {
             Global::abort("ConfigParser", msg);
@@ -10,12 +10,28 @@
 #include "FritzConfig.h"
 #include "ConfigParser.h"
 
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "TRandom.h"
+
 bool Fritz::interupted = false;
 
+static void unknownSections(Config conf);
+
 Fritz::Fritz() {
     haveNEvents = false;
     nEvents = 0;
     haveRandomSeed = false;
+    serveSocket = "";
+    stopCheck = 0;
+    stopMinEvents = 0;
+    stopPrecision = 0;
+    stopSigma = 0;
     signal(SIGINT, signalHandler);
 }
 
@@ -53,6 +69,175 @@ void Fritz::initialize(int argc, char* argv[]) {
 }
 
 void Fritz::processEventLoop() {
+    if (serveSocket != "") {
+        serve();
+        return;
+    }
+    runEventLoop();
+    runScanJobs(true);
+}
+
+void Fritz::runScanJobs(bool afterInitialRun) {
+    // scan jobs reuse the initialised handlers, in the order of their labels
+    std::map<std::string,std::pair<EventFile,std::string> >::iterator it;
+    for (it=scanJobs.begin(); it!=scanJobs.end() && !interupted; it++) {
+        if (afterInitialRun || it != scanJobs.begin()) {
+            std::map<std::string,AnalysisHandler*>::iterator ita;
+            for (ita=analysisHandler.begin(); ita!=analysisHandler.end(); ita++) {
+                ita->second->finishJob();
+            }
+        }
+        startScanJob(it->first);
+        runEventLoop();
+    }
+}
+
+void Fritz::startScanJob(std::string label) {
+    EventFile file = scanJobs[label].first;
+    std::string outputPrefix = scanJobs[label].second;
+    std::map<std::string,AnalysisHandler*>::iterator ita;
+    Global::print("Fritz", " >> Starting scan job " + label + " <<");
+    std::map<std::string,DelphesHandler*>::iterator itd;
+    for (itd=delphesHandler.begin(); itd!=delphesHandler.end(); itd++) {
+        itd->second->startJob(file);
+    }
+    for (ita=analysisHandler.begin(); ita!=analysisHandler.end(); ita++) {
+        ita->second->startJob(outputPrefix, file);
+    }
+}
+
+// Opens a listening unix socket at path
+static int listenSocket(std::string path) {
+    struct sockaddr_un address;
+    if (path.size() >= sizeof(address.sun_path))
+        Global::abort("Fritz", "Socket path "+path+" is too long");
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(fd, 16) < 0)
+        Global::abort("Fritz", "Can not listen on socket "+path+": "+strerror(errno));
+    return fd;
+}
+
+void Fritz::serve() {
+    // accept() has to return on SIGINT instead of being restarted
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = signalHandler;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    // finished jobs are reaped automatically
+    signal(SIGCHLD, SIG_IGN);
+
+    int listenFd = listenSocket(serveSocket);
+    Global::print("Fritz", " >> Waiting for jobs on " + serveSocket + " <<");
+    while (!interupted) {
+        int fd = accept(listenFd, NULL, NULL);
+        if (fd < 0)
+            continue;
+        std::cout.flush();
+        std::cerr.flush();
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(listenFd);
+            runServedJob(fd);
+        }
+        if (pid < 0)
+            Global::warn("Fritz", "Could not fork for a new job: "+std::string(strerror(errno)));
+        close(fd);
+    }
+    close(listenFd);
+    unlink(serveSocket.c_str());
+    Global::print("Fritz", " >> Stopped serving jobs <<");
+}
+
+// Seconds a client may take to send its job config
+static const int jobReadTimeout = 60;
+
+void Fritz::runServedJob(int fd) {
+    // the client sends a job config and closes its writing end
+    struct timeval timeout;
+    timeout.tv_sec = jobReadTimeout;
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    std::string job;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+        job.append(buffer, n);
+    if (n < 0) {
+        close(fd);
+        Global::abort("Fritz", "Could not read a job config: "+std::string(strerror(errno)));
+    }
+
+    // all output of the job goes back to the client
+    signal(SIGCHLD, SIG_DFL);
+    signal(SIGINT, signalHandler);
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+
+    std::istringstream stream(job);
+    Config conf = parseConfigStream(stream);
+    unknownSections(conf);
+    haveRandomSeed = false;
+    setupGlobal(conf);
+    // without an explicit seed, jobs must not repeat the random numbers of the daemon
+    if (!haveRandomSeed) {
+        randomSeed = time(0) ^ getpid();
+        srand(randomSeed);
+        Global::randomSeed = randomSeed;
+    }
+    gRandom->SetSeed(randomSeed);
+    setupEventFiles(conf);
+    scanJobs.clear();
+    setupScanJobs(conf);
+    if (scanJobs.empty())
+        Global::abort("Fritz", "A job needs at least one ScanJob section");
+    runScanJobs(false);
+    serveSocket = "";
+    finalize();
+    std::cout.flush();
+    exit(0);
+}
+
+// Sends the job config at jobFile to the fritz daemon at path and prints its output
+static int submitJob(std::string path, std::string jobFile) {
+    std::ifstream file(jobFile.c_str());
+    if (!file.is_open())
+        Global::abort("Fritz", "Can not read job config "+jobFile);
+    std::stringstream job;
+    job << file.rdbuf();
+
+    struct sockaddr_un address;
+    if (path.size() >= sizeof(address.sun_path))
+        Global::abort("Fritz", "Socket path "+path+" is too long");
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+        Global::abort("Fritz", "Can not connect to "+path+": "+strerror(errno));
+    std::string content = job.str();
+    for (size_t sent = 0; sent < content.size(); ) {
+        ssize_t n = write(fd, content.data()+sent, content.size()-sent);
+        if (n <= 0)
+            Global::abort("Fritz", "Can not send job to "+path);
+        sent += n;
+    }
+    shutdown(fd, SHUT_WR);
+    // progress and results are streamed back until the job has finished
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+        std::cout.write(buffer, n).flush();
+    close(fd);
+    return 0;
+}
+
+void Fritz::runEventLoop() {
     int iEvent = 0; // index of currently processed event
     std::string strEvent = "0"; // string version of iEvent
     std::string message = ""; // progress message to be printed
@@ -73,6 +258,9 @@ void Fritz::processEventLoop() {
 	message += strEvent + " Events";
       if (message != "Progress: ")
 	Global::print("Fritz", message);
+      if (stopCheck > 0 && iEvent >= stopMinEvents && iEvent % stopCheck == 0
+          && precisionReached())
+        break;
     }
     Global::unredirect_cout();
     Global::print("Fritz", " >> Finalising after " + strEvent + " events. <<");
@@ -100,7 +288,35 @@ bool Fritz::processEvent(int iEvent) {
     return running;
 }
 
+bool Fritz::precisionReached() {
+    AnalysisHandler::precision_status status;
+    status.precise = true;
+    status.excluded = false;
+    status.allowed = true;
+    status.haveR = false;
+    std::map<std::string,AnalysisHandler*>::iterator ita;
+    for (ita=analysisHandler.begin(); ita!=analysisHandler.end(); ita++) {
+        ita->second->checkPrecision(stopPrecision, stopSigma, status);
+    }
+    if (stopPrecision > 0 && status.precise) {
+        Global::print("Fritz", "All analyses reached the requested statistical precision");
+        return true;
+    }
+    if (stopSigma > 0 && status.haveR && status.excluded) {
+        Global::print("Fritz", "Model is excluded with the requested confidence");
+        return true;
+    }
+    if (stopSigma > 0 && status.haveR && status.allowed) {
+        Global::print("Fritz", "Model is allowed with the requested confidence");
+        return true;
+    }
+    return false;
+}
+
 void Fritz::finalize() {
+    // the handlers of a daemon are only templates for the served jobs
+    if (serveSocket != "")
+        return;
     // Finalisation in opposite order of creation
     std::map<std::string,AnalysisHandler*>::iterator ita;
     for (ita=analysisHandler.begin(); ita!=analysisHandler.end(); ita++) {
@@ -129,12 +345,14 @@ static void unknownSections(Config conf) {
     knownKeys.push_back(keyElectronIsoSection);
     knownKeys.push_back(keyMuonIsoSection);
     knownKeys.push_back(keyPhotonIsoSection);
+    knownKeys.push_back(keyEffUniverseSection);
     knownKeys.push_back(keyAnalysisSection);
     knownKeys.push_back(keyAnalysisHandlerSection);
     knownKeys.push_back(keyEventFileSection);
     knownKeys.push_back(keyPythiaHandlerSection);
     knownKeys.push_back(keyDelphesHandlerSection);
     knownKeys.push_back(keyAnalysisHandlerSection);
+    knownKeys.push_back(keyScanJobSection);
     warnUnknownKeys(conf, knownKeys, "Fritz", "Unknown section type in input file");
 }
 
@@ -229,13 +447,76 @@ void Fritz::setupAnalysisHandler(Config conf) {
     }
 }
 
+void Fritz::linkHandlers() {
+    // the analysis handlers decide which Delphes modules are needed
+    std::map<std::string,DelphesHandler*>::iterator itd;
+    for (itd=delphesHandler.begin(); itd!=delphesHandler.end(); itd++)
+        itd->second->initialiseModules();
+    std::map<std::string,AnalysisHandler*>::iterator ita;
+    for (ita=analysisHandler.begin(); ita!=analysisHandler.end(); ita++)
+        ita->second->linkDelphes();
+}
+
+static const std::string keyScanJobEventFile = "eventfile";
+static const std::string keyScanJobOutputPrefix = "outputprefix";
+
+void Fritz::setupScanJobs(Config conf) {
+    Sections sections = conf[keyScanJobSection];
+    std::map<std::string,Properties>::iterator it;
+    for (it=sections.begin(); it!=sections.end(); it++) {
+        std::string label = it->first;
+        Properties props = it->second;
+        std::vector<std::string> knownKeys;
+        knownKeys.push_back("name");
+        knownKeys.push_back(keyScanJobEventFile);
+        knownKeys.push_back(keyScanJobOutputPrefix);
+        warnUnknownKeys(props, knownKeys, props["name"], "Unknown key in ScanJob section");
+        std::string eventsLabel = lookupRequired(
+                props,
+                keyScanJobEventFile,
+                props["name"],
+                "ScanJob sections need an event file"
+                );
+        EventFile file = lookupRequired(
+                eventFiles,
+                eventsLabel,
+                props["name"],
+                "Can not find EventFile with label "+eventsLabel
+                );
+        std::string outputPrefix = lookupRequired(
+                props,
+                keyScanJobOutputPrefix,
+                props["name"],
+                "ScanJob sections need an output prefix"
+                );
+        scanJobs[label] = std::make_pair(file, outputPrefix);
+    }
+    if (scanJobs.empty())
+        return;
+    std::map<std::string,DelphesHandler*>::iterator itd;
+    for (itd=delphesHandler.begin(); itd!=delphesHandler.end(); itd++) {
+        if (!itd->second->readsEventFile())
+            Global::abort("Fritz", "Scan jobs can not be combined with "+itd->first
+                                   +", which reads its events from Pythia");
+    }
+    Global::print("Fritz", Global::intToStr(scanJobs.size())+" scan jobs follow the initial run");
+}
+
 static const std::string keyGlobalNEvents = "nevents";
 static const std::string keyGlobalRandomSeed = "randomseed";
+static const std::string keyGlobalStopCheck = "stopcheck";
+static const std::string keyGlobalStopMinEvents = "stopminevents";
+static const std::string keyGlobalStopPrecision = "stopprecision";
+static const std::string keyGlobalStopSigma = "stopsigma";
 
 static void unknownKeysGlobal(Properties props) {
     std::vector<std::string> knownKeys;
     knownKeys.push_back(keyGlobalNEvents);
     knownKeys.push_back(keyGlobalRandomSeed);
+    knownKeys.push_back(keyGlobalStopCheck);
+    knownKeys.push_back(keyGlobalStopMinEvents);
+    knownKeys.push_back(keyGlobalStopPrecision);
+    knownKeys.push_back(keyGlobalStopSigma);
     warnUnknownKeys(
             props,
             knownKeys,
@@ -271,6 +552,25 @@ void Fritz::setupGlobal(Config conf) {
     pair = maybeLookupInt(props, keyGlobalNEvents);
     haveNEvents = pair.first;
     nEvents = pair.second;
+
+    // adaptive termination of the event loop
+    stopCheck = lookupOrDefault(props, keyGlobalStopCheck, 0);
+    stopMinEvents = lookupOrDefault(props, keyGlobalStopMinEvents, 1000);
+    stopPrecision = lookupOrDefault(props, keyGlobalStopPrecision, 0.0);
+    stopSigma = lookupOrDefault(props, keyGlobalStopSigma, 0.0);
+    if (stopCheck > 0 && stopPrecision <= 0 && stopSigma <= 0) {
+        Global::abort("Fritz", keyGlobalStopCheck+" needs "+keyGlobalStopPrecision
+                               +" and/or "+keyGlobalStopSigma);
+    }
+    if (stopCheck > 0) {
+        Global::print("Fritz", "Checking the signal region statistics every "
+                               +Global::intToStr(stopCheck)+" events after the first "
+                               +Global::intToStr(stopMinEvents));
+        // stopping after a fluctuation biases that region, see Fritz.h
+        Global::warn("Fritz", "Stopping early biases the yield of the signal region"
+                              " which triggers the stop, increase "
+                              +keyGlobalStopMinEvents+" to reduce the bias");
+    }
 }
 
 void Fritz::readInputFile(std::string filepath) {
@@ -288,6 +588,8 @@ void Fritz::readInputFile(std::string filepath) {
 #endif
     setupDelphesHandler(conf);
     setupAnalysisHandler(conf);
+    linkHandlers();
+    setupScanJobs(conf);
 }
 
 void printUsageMessage() {
@@ -303,12 +605,28 @@ void printUsageMessage() {
     std::cout << "loading  pythia and delphes simultaneously will process the generated events "  << std::endl;
     std::cout << "from pythia with delphes without a .hepmc file stored on the computer." << std::endl;
     std::cout << std::endl;
+    std::cout << "Usage: fritz --serve socket configfile" << std::endl;
+    std::cout << "  initialises all handlers of configfile once and runs the ScanJob sections of" << std::endl;
+    std::cout << "  job configs sent to the unix socket, each in a forked copy of the handlers." << std::endl;
+    std::cout << "Usage: fritz --submit socket jobfile" << std::endl;
+    std::cout << "  sends jobfile to a fritz daemon and prints the output of the job." << std::endl;
+    std::cout << std::endl;
     std::cout << " Note that you will only have reduced functionality if you compiled " << std::endl;
     std::cout << " without Pythia or HePMC linking!" << std::endl;
     std::cout << std::endl;
 }
 
 void Fritz::readInput(int argc, char* argv[]) {
+    if (argc == 4 && std::string(argv[1]) == "--submit") {
+        exit(submitJob(argv[2], argv[3]));
+    }
+    if (argc == 4 && std::string(argv[1]) == "--serve") {
+        serveSocket = argv[2];
+        readInputFile(std::string(argv[3]));
+        Global::print("Fritz",
+                      "Fritz successfully loaded command line parameters!");
+        return;
+    }
     if (argc==1 || argc>2) {
         printUsageMessage();
         exit(1);
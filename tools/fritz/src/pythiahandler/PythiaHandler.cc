@@ -24,6 +24,8 @@ static const std::string keyMGrun = "mgruncard";
 static const std::string keyMGconfig = "mgconfigcard";
 static const std::string keyMGrunpath = "mgrunpath";
 static const std::string keyMGsourcepath = "mgsourcepath";
+static const std::string keyMGcachepath = "mgcachepath";
+static const std::string keyMGdoublebuffer = "mgdoublebuffer";
 
 PythiaHandler::PythiaHandler() {
     mainPythia = NULL;
@@ -70,6 +72,8 @@ static void unknownKeys(Properties props) {
     knownKeys.push_back(keyMGconfig);
     knownKeys.push_back(keyMGrunpath);
     knownKeys.push_back(keyMGsourcepath);
+    knownKeys.push_back(keyMGcachepath);
+    knownKeys.push_back(keyMGdoublebuffer);
     warnUnknownKeys(props, knownKeys, props["name"], "Unknown key for PythiaHandler section");
 }
 
@@ -201,11 +205,25 @@ void PythiaHandler::setup(Properties props) {
 				 keyMGconfig,
 				 ""
 				 );
+
+    mgCachePath =  lookupOrDefault(
+				 props,
+				 keyMGcachepath,
+				 ""
+				 );
+
+    mgDoubleBuffer = (lookupOrDefault(
+				 props,
+				 keyMGdoublebuffer,
+				 "false"
+				 ) == "true");
 	
     Global::print(name, "read mgProcCard ="+ mgProcCard);
     Global::print(name, "read mgParamCard ="+ mgParamCard);
     Global::print(name, "read mgRunCard ="+ mgRunCard);
     Global::print(name, "read mgConfigCard ="+ mgConfigCard);
+    if(mgCachePath != "")
+      Global::print(name, "caching MG5_aMC@NLO process directories in "+ mgCachePath);
     
   }  
     
@@ -233,6 +251,20 @@ void PythiaHandler::setup(Properties props) {
     if(mgParamCard != "") madgraph->addCard(mgParamCard,"param_card.dat");
     if(mgRunCard != "") madgraph->addCard(mgRunCard,"run_card.dat");
     if(mgConfigCard != "") madgraph->addCard(mgConfigCard,"me5_configuration.txt");
+    madgraph->setDoubleBuffer(mgDoubleBuffer);
+    if(mgCachePath != "") {
+      // process directories of different MadGraph versions must not be mixed
+      ifstream versionFile((mgSourcePath+"/VERSION").c_str(), ios::in);
+      std::stringstream version;
+      version << versionFile.rdbuf();
+      if(version.str() == "") {
+        Global::unredirect_cout();
+        Global::warn(name, "can not read "+mgSourcePath+"/VERSION, MG5_aMC@NLO process directories are not cached.");
+        Global::redirect_cout(pythiaLogFile);
+      }
+      else
+        madgraph->setCache(mgCachePath, version.str());
+    }
     mainPythia->setLHAupPtr(madgraph);
     
     // Set LHE file by hand
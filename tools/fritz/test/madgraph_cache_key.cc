@@ -0,0 +1,73 @@
+/* Checks the keys of the MadGraph process cache, see LHAupMadgraph::cacheKey().
+ * Scan points which only change the param or run card have to share the
+ * cached process, while a changed MadGraph configuration must not.
+ * Run via "make check", returns 0 if all checks pass.
+ */
+#include "MG5toPy8.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Gives access to the protected key of the cache
+class CacheKeyProbe : public Pythia8::LHAupMadgraph {
+public:
+    CacheKeyProbe(std::string dir) : LHAupMadgraph(NULL, true, dir, dir+"/bin/mg5_aMC") {
+        readString("import model sm");
+        readString("generate p p > t t~");
+    }
+    std::string key() { return cacheKey(); }
+};
+
+static void writeFile(std::string path, std::string content) {
+    std::ofstream file(path.c_str());
+    file << content;
+}
+
+static int failures = 0;
+
+static void check(bool condition, std::string message) {
+    if (!condition) {
+        std::cerr << "FAILED: " << message << std::endl;
+        failures++;
+    }
+}
+
+int main() {
+    char dirTemplate[] = "/tmp/madgraph_cache_key_XXXXXX";
+    if (mkdtemp(dirTemplate) == NULL) {
+        std::cerr << "Can not create a temporary directory" << std::endl;
+        return 1;
+    }
+    std::string dir = dirTemplate;
+    writeFile(dir+"/param_a.dat", "BLOCK MASS\n  1000006 500.0\n");
+    writeFile(dir+"/param_b.dat", "BLOCK MASS\n  1000006 800.0\n");
+    writeFile(dir+"/run_a.dat", "10000 = nevents\n");
+    writeFile(dir+"/run_b.dat", "20000 = nevents\n");
+    writeFile(dir+"/me5_a.txt", "nb_core = 1\n");
+    writeFile(dir+"/me5_b.txt", "nb_core = 4\n");
+
+    CacheKeyProbe a(dir+"/run_a"), b(dir+"/run_b"), c(dir+"/run_c");
+    a.addCard(dir+"/param_a.dat", "param_card.dat");
+    a.addCard(dir+"/run_a.dat", "run_card.dat");
+    a.addCard(dir+"/me5_a.txt", "me5_configuration.txt");
+    b.addCard(dir+"/param_b.dat", "param_card.dat");
+    b.addCard(dir+"/run_b.dat", "run_card.dat");
+    b.addCard(dir+"/me5_a.txt", "me5_configuration.txt");
+    c.addCard(dir+"/param_a.dat", "param_card.dat");
+    c.addCard(dir+"/run_a.dat", "run_card.dat");
+    c.addCard(dir+"/me5_b.txt", "me5_configuration.txt");
+
+    check(a.key() == b.key(), "keys differing only in the param and run cards are not equal");
+    check(a.key() != c.key(), "keys with different MadGraph configurations are equal");
+
+    CacheKeyProbe d(dir+"/run_d");
+    d.readString("generate p p > t t~ j");
+    check(a.key() != d.key(), "keys with different generate commands are equal");
+
+    system(("rm -rf "+dir).c_str());
+    if (failures == 0)
+        std::cout << "All MadGraph cache key checks passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
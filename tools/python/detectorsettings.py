@@ -238,6 +238,8 @@ def _config_experiment(config, experiment):
         section_name = _analysis_section_name(analysis)
         config.add_section(section_name)
         config.set(section_name, "analysishandler", experiment)
+        if os.path.isfile(Info.files["evaluation_reference"][analysis]):
+            config.set(section_name, "reffile", Info.files["evaluation_reference"][analysis])
     if not exists:
         # no analyses found.
         return
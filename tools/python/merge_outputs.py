@@ -0,0 +1,190 @@
+#!/usr/bin/env python
+
+"""Merges the analysis output files of several runs of the same process.
+
+Runs that analyse parts of the same event sample, e.g. in parallel jobs, each
+write their own files into the analysis output folder, distinguished by their
+prefix. This script combines files of one kind into a single file:
+  - _signal.dat, _cutflow.dat, _control.dat and .hist files: the sums of
+    weights of every region or bin and the event numbers of the header are
+    added up, Acc and N_Norm are evaluated again for the merged sums.
+  - .ntuple files: the rows are concatenated and the totals of the header
+    added up.
+Cross section and normalisation of the runs are averaged, weighted with
+their sums of weights.
+
+Usage: merge_outputs.py merged_file file1 file2 ...
+"""
+
+from __future__ import print_function
+import os, sys
+import struct
+
+ntuple_magic = b"CMNTUPLE"
+ntuple_version = 1
+# magic, version, columns, rows, sum of weights, normalisation
+ntuple_header = struct.Struct("=8siiqdd")
+
+
+def parse_table_file(filename):
+  """
+  Returns the information lines, the header entries as list of
+  (key, value string) pairs, the column names and the rows of a
+  region or histogram file written by the AnalysisBase.
+  """
+  information = []
+  header = []
+  columns = None
+  rows = []
+  with open(filename, "r") as f:
+    for line in f:
+      line = line.rstrip("\n")
+      if line.startswith("@"):
+        key, value = line.split(":", 1)
+        header.append((key, value.strip()))
+      elif columns is None and header == []:
+        information.append(line)
+      elif line.strip() == "":
+        continue
+      elif columns is None:
+        columns = line.split()
+      else:
+        rows.append(line.split())
+  if columns is None:
+    exit("File "+filename+" does not contain a table!")
+  return information, header, columns, rows
+
+
+def header_value(header, key):
+  for k, v in header:
+    if k.strip("@ ") == key:
+      return float(v.split()[0]) if v != "" else 0.0
+  return 0.0
+
+
+def merge_tables(target, sources):
+  information, first_header, columns, _ = parse_table_file(sources[0])
+  sum_columns = [c for c, name in enumerate(columns) if name.startswith("Sum_W")]
+  key_columns = [c for c, name in enumerate(columns) if not name.startswith("Sum_W") and name not in ["Acc", "N_Norm"]]
+
+  totals = {}
+  averages = {"XSect": 0.0, "Error": 0.0, "NormEvents": 0.0}
+  sums = dict()
+  order = []
+  for source in sources:
+    _, header, source_columns, rows = parse_table_file(source)
+    if source_columns != columns:
+      exit("Columns of "+source+" differ from those of "+sources[0]+"!")
+    weight = header_value(header, "SumOfWeights")
+    for key, value in header:
+      key = key.strip("@ ")
+      if key in averages:
+        averages[key] += weight*header_value(header, key)
+      elif key.startswith("MCEvents") or key.startswith("SumOfWeights"):
+        totals[key] = totals.get(key, 0.0)+float(value)
+    for row in rows:
+      key = tuple(row[c] for c in key_columns)
+      if key not in sums:
+        sums[key] = [0.0]*len(sum_columns)
+        order.append(key)
+      for i, c in enumerate(sum_columns):
+        sums[key][i] += float(row[c])
+
+  sum_of_weights = totals.get("SumOfWeights", 0.0)
+  for key in averages:
+    averages[key] = averages[key]/sum_of_weights if sum_of_weights != 0 else header_value(first_header, key)
+  norm_per_weight = averages["NormEvents"]/sum_of_weights if sum_of_weights != 0 else 0.0
+
+  with open(target, "w") as out:
+    for line in information:
+      out.write(line+"\n")
+    for key, value in first_header:
+      name = key.strip("@ ")
+      if name in averages:
+        unit = " fb" if name in ["XSect", "Error"] else ""
+        value = repr(averages[name])+unit
+      elif name in totals:
+        value = "%d" % totals[name] if name == "MCEvents" else repr(totals[name])
+      # values start in the same column as in the files of the AnalysisBase
+      out.write((key+":").ljust(max(18, len(key)+3))+value+"\n")
+    out.write("\n")
+    out.write("  ".join(columns)+"\n")
+    for key in order:
+      values = []
+      for c, name in enumerate(columns):
+        if c in key_columns:
+          values.append(key[key_columns.index(c)])
+        elif c in sum_columns:
+          values.append(repr(sums[key][sum_columns.index(c)]))
+        else:
+          sum_w = sums[key][sum_columns.index(columns.index("Sum_W"))]
+          if name == "Acc":
+            values.append(repr(sum_w/sum_of_weights if sum_of_weights != 0 else 0.0))
+          else:
+            values.append(repr(sum_w*norm_per_weight))
+      out.write("  ".join(values)+"\n")
+
+
+def read_ntuple_header(f, filename):
+  """ Returns the header fields and the column names of an ntuple """
+  fields = ntuple_header.unpack(f.read(ntuple_header.size))
+  if fields[0] != ntuple_magic or fields[1] != ntuple_version:
+    exit(filename+" is not an ntuple of version "+str(ntuple_version)+"!")
+  names = []
+  while len(names) < fields[2]:
+    name = b""
+    c = f.read(1)
+    while c not in [b"\0", b""]:
+      name += c
+      c = f.read(1)
+    names.append(name)
+  return fields, names
+
+
+def merge_ntuples(target, sources):
+  headers = []
+  for source in sources:
+    with open(source, "rb") as f:
+      fields, names = read_ntuple_header(f, source)
+      data_size = os.path.getsize(source)-f.tell()
+    if headers != [] and names != headers[0][1]:
+      exit("Columns of "+source+" differ from those of "+sources[0]+"!")
+    if data_size != fields[3]*fields[2]*8:
+      exit(source+" has an incomplete header or incomplete rows, the run probably did not finish!")
+    headers.append((fields, names))
+
+  rows = sum(fields[3] for fields, _ in headers)
+  sum_of_weights = sum(fields[4] for fields, _ in headers)
+  if sum_of_weights != 0:
+    normalisation = sum(fields[4]*fields[5] for fields, _ in headers)/sum_of_weights
+  else:
+    normalisation = headers[0][0][5]
+  names = headers[0][1]
+
+  with open(target, "wb") as out:
+    out.write(ntuple_header.pack(ntuple_magic, ntuple_version, len(names), rows, sum_of_weights, normalisation))
+    for name in names:
+      out.write(name+b"\0")
+    for source in sources:
+      with open(source, "rb") as f:
+        read_ntuple_header(f, source)
+        block = f.read(1 << 20)
+        while block:
+          out.write(block)
+          block = f.read(1 << 20)
+
+
+if __name__ == "__main__":
+  if len(sys.argv) < 3:
+    exit(__doc__)
+  target = sys.argv[1]
+  sources = sys.argv[2:]
+  if target in sources:
+    exit("The merged file must not be one of the input files!")
+  if all(s.endswith(".ntuple") for s in sources):
+    merge_ntuples(target, sources)
+  elif not any(s.endswith(".ntuple") for s in sources):
+    merge_tables(target, sources)
+  else:
+    exit("Ntuples cannot be merged with other files!")
+  print("Merged "+str(len(sources))+" files into "+target)